@@ -0,0 +1,297 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "EffectDispatcherSubsystem.h"
+#include "NiagaraComponent.h"
+#include "NiagaraSystem.h"
+#include "Components/AudioComponent.h"
+#include "Sound/SoundBase.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<int32> CVarEffectsSpawnBudget(
+	TEXT("Effects.SpawnBudget"),
+	16,
+	TEXT("Maximum number of effects and sounds started per frame. Requests over the budget are dropped."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarEffectsMergeDistance(
+	TEXT("Effects.MergeDistance"),
+	50.0f,
+	TEXT("Requests for the same effect closer than this to one already started in the same frame are merged into it."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarEffectsMaxComponentsPerAsset(
+	TEXT("Effects.MaxComponentsPerAsset"),
+	8,
+	TEXT("Maximum number of pooled components per effect or sound. Once reached, the oldest playing one is restarted."),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorldAndArgs EffectsStatsCommand(
+	TEXT("Effects.Stats"),
+	TEXT("Logs the effect pool sizes and dispatch totals."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UEffectDispatcherSubsystem::DumpStats)
+);
+
+void UEffectDispatcherSubsystem::PlayEffectAtLocation(UNiagaraSystem* System, USoundBase* Sound, FVector Location, FRotator Rotation)
+{
+	if (System)
+	{
+		QueueRequest(System, Location, Rotation, false);
+	}
+
+	if (Sound)
+	{
+		QueueRequest(Sound, Location, Rotation, false);
+	}
+}
+
+void UEffectDispatcherSubsystem::PlaySound2D(USoundBase* Sound)
+{
+	if (Sound)
+	{
+		QueueRequest(Sound, FVector::ZeroVector, FRotator::ZeroRotator, true);
+	}
+}
+
+void UEffectDispatcherSubsystem::DumpStats(const TArray<FString>& Args, UWorld* World)
+{
+	const UEffectDispatcherSubsystem* Effects = World ? World->GetSubsystem<UEffectDispatcherSubsystem>() : nullptr;
+
+	if (!Effects)
+	{
+		return;
+	}
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Effects: %d played, %d merged, %d dropped, %d components created"), Effects->NumPlayed, Effects->NumMerged, Effects->NumDropped, Effects->NumComponentsCreated);
+
+	for (const TPair<TObjectPtr<UObject>, FEffectComponentPool>& Pair : Effects->Pools)
+	{
+		UE_LOG(LogTriangleGameJam, Display, TEXT("%s: %d playing, %d free"), *GetNameSafe(Pair.Key), Pair.Value.ActiveComponents.Num(), Pair.Value.FreeComponents.Num());
+	}
+}
+
+void UEffectDispatcherSubsystem::QueueRequest(UObject* Asset, const FVector& Location, const FRotator& Rotation, bool b2D)
+{
+	FEffectRequest& Request = Requests.AddDefaulted_GetRef();
+	Request.Asset = Asset;
+	Request.Location = Location;
+	Request.Rotation = Rotation;
+	Request.b2D = b2D;
+}
+
+bool UEffectDispatcherSubsystem::IsDuplicate(const FEffectRequest& Request, float MergeDistanceSquared) const
+{
+	return DispatchedRequests.ContainsByPredicate([&Request, MergeDistanceSquared](const FEffectRequest& Dispatched)
+	{
+		// 2D sounds play from everywhere, so any two of the same sound are duplicates
+		return Dispatched.Asset == Request.Asset && Dispatched.b2D == Request.b2D
+			&& (Request.b2D || FVector::DistSquared(Dispatched.Location, Request.Location) < MergeDistanceSquared);
+	});
+}
+
+void UEffectDispatcherSubsystem::Dispatch(const FEffectRequest& Request, int32 MaxComponentsPerAsset)
+{
+	USceneComponent* Component = AcquireComponent(Request.Asset.Get(), MaxComponentsPerAsset);
+
+	if (!Component)
+	{
+		return;
+	}
+
+	Component->SetWorldLocationAndRotation(Request.Location, Request.Rotation);
+
+	if (UNiagaraComponent* NiagaraComponent = Cast<UNiagaraComponent>(Component))
+	{
+		// restart from the first frame, even if we stole it mid-playback
+		NiagaraComponent->Activate(true);
+	}
+	else if (UAudioComponent* AudioComponent = Cast<UAudioComponent>(Component))
+	{
+		AudioComponent->bAllowSpatialization = !Request.b2D;
+		AudioComponent->bIsUISound = Request.b2D;
+		AudioComponent->Play();
+	}
+
+	++NumPlayed;
+}
+
+USceneComponent* UEffectDispatcherSubsystem::AcquireComponent(UObject* Asset, int32 MaxComponentsPerAsset)
+{
+	FEffectComponentPool& Pool = Pools.FindOrAdd(Asset);
+
+	USceneComponent* Component = nullptr;
+
+	if (Pool.FreeComponents.Num() > 0)
+	{
+		// reuse a finished component
+		Component = Pool.FreeComponents.Pop(EAllowShrinking::No);
+	}
+	else if (Pool.ActiveComponents.Num() >= MaxComponentsPerAsset && Pool.ActiveComponents.Num() > 0)
+	{
+		// the pool is full, so steal the oldest playing component
+		Component = Pool.ActiveComponents[0];
+		Pool.ActiveComponents.RemoveAt(0, EAllowShrinking::No);
+	}
+	else
+	{
+		// create the host the first time we need a component
+		if (!ComponentHost)
+		{
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.ObjectFlags |= RF_Transient;
+
+			ComponentHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+			ComponentHost->SetRootComponent(NewObject<USceneComponent>(ComponentHost, TEXT("Root")));
+			ComponentHost->GetRootComponent()->RegisterComponent();
+		}
+
+		if (UNiagaraSystem* System = Cast<UNiagaraSystem>(Asset))
+		{
+			UNiagaraComponent* NiagaraComponent = NewObject<UNiagaraComponent>(ComponentHost);
+			NiagaraComponent->SetAsset(System);
+			NiagaraComponent->SetAutoActivate(false);
+			NiagaraComponent->SetAutoDestroy(false);
+
+			Component = NiagaraComponent;
+		}
+		else if (USoundBase* Sound = Cast<USoundBase>(Asset))
+		{
+			UAudioComponent* AudioComponent = NewObject<UAudioComponent>(ComponentHost);
+			AudioComponent->SetSound(Sound);
+			AudioComponent->bAutoActivate = false;
+			AudioComponent->bAutoDestroy = false;
+
+			Component = AudioComponent;
+		}
+		else
+		{
+			return nullptr;
+		}
+
+		// place the component in world space instead of following the host
+		Component->SetUsingAbsoluteLocation(true);
+		Component->SetUsingAbsoluteRotation(true);
+		Component->SetupAttachment(ComponentHost->GetRootComponent());
+		Component->RegisterComponent();
+
+		ComponentHost->AddInstanceComponent(Component);
+
+		++NumComponentsCreated;
+	}
+
+	Pool.ActiveComponents.Add(Component);
+
+	return Component;
+}
+
+void UEffectDispatcherSubsystem::ReclaimComponents()
+{
+	for (TPair<TObjectPtr<UObject>, FEffectComponentPool>& Pair : Pools)
+	{
+		FEffectComponentPool& Pool = Pair.Value;
+
+		// keep the active list ordered by age so stealing always picks the oldest
+		for (int32 ComponentIndex = Pool.ActiveComponents.Num() - 1; ComponentIndex >= 0; --ComponentIndex)
+		{
+			USceneComponent* Component = Pool.ActiveComponents[ComponentIndex];
+
+			if (!IsValid(Component))
+			{
+				Pool.ActiveComponents.RemoveAt(ComponentIndex, EAllowShrinking::No);
+			}
+			else if (!IsComponentPlaying(Component))
+			{
+				Pool.ActiveComponents.RemoveAt(ComponentIndex, EAllowShrinking::No);
+				Pool.FreeComponents.Add(Component);
+			}
+		}
+	}
+}
+
+bool UEffectDispatcherSubsystem::IsComponentPlaying(const USceneComponent* Component)
+{
+	if (const UAudioComponent* AudioComponent = Cast<UAudioComponent>(Component))
+	{
+		return AudioComponent->IsPlaying();
+	}
+
+	// Niagara components deactivate once their system completes
+	return Component->IsActive();
+}
+
+bool UEffectDispatcherSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UEffectDispatcherSubsystem::Deinitialize()
+{
+	if (IsValid(ComponentHost))
+	{
+		ComponentHost->Destroy();
+	}
+
+	ComponentHost = nullptr;
+	Pools.Reset();
+	Requests.Reset();
+
+	Super::Deinitialize();
+}
+
+void UEffectDispatcherSubsystem::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UEffectDispatcherSubsystem::Tick);
+
+	Super::Tick(DeltaTime);
+
+	ReclaimComponents();
+
+	if (Requests.Num() == 0)
+	{
+		return;
+	}
+
+	const int32 SpawnBudget = CVarEffectsSpawnBudget.GetValueOnGameThread();
+	const float MergeDistanceSquared = FMath::Square(CVarEffectsMergeDistance.GetValueOnGameThread());
+	const int32 MaxComponentsPerAsset = FMath::Max(1, CVarEffectsMaxComponentsPerAsset.GetValueOnGameThread());
+
+	DispatchedRequests.Reset();
+
+	for (const FEffectRequest& Request : Requests)
+	{
+		if (!Request.Asset.IsValid())
+		{
+			continue;
+		}
+
+		// one effect already covers this spot
+		if (IsDuplicate(Request, MergeDistanceSquared))
+		{
+			++NumMerged;
+			continue;
+		}
+
+		// impacts are only worth showing the frame they happen, so drop what's over the budget instead of delaying it
+		if (DispatchedRequests.Num() >= SpawnBudget)
+		{
+			++NumDropped;
+			continue;
+		}
+
+		Dispatch(Request, MaxComponentsPerAsset);
+
+		DispatchedRequests.Add(Request);
+	}
+
+	Requests.Reset();
+}
+
+TStatId UEffectDispatcherSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEffectDispatcherSubsystem, STATGROUP_Tickables);
+}
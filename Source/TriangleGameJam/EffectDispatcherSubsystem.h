@@ -0,0 +1,124 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EffectDispatcherSubsystem.generated.h"
+
+class UNiagaraSystem;
+class USoundBase;
+class USceneComponent;
+
+/**
+ *  A Niagara system or sound queued to play this frame
+ */
+struct FEffectRequest
+{
+	/** Niagara system or sound to play */
+	TWeakObjectPtr<UObject> Asset;
+
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	/** If true, the sound plays without spatialization */
+	bool b2D = false;
+};
+
+/**
+ *  Reusable components playing a single Niagara system or sound
+ */
+USTRUCT()
+struct FEffectComponentPool
+{
+	GENERATED_BODY()
+
+	/** Components ready to play */
+	UPROPERTY()
+	TArray<TObjectPtr<USceneComponent>> FreeComponents;
+
+	/** Components playing, oldest first */
+	UPROPERTY()
+	TArray<TObjectPtr<USceneComponent>> ActiveComponents;
+};
+
+/**
+ *  Plays impact effects and one-shot sounds from pooled Niagara and audio components instead of spawning new ones per hit.
+ *  Requests are queued and dispatched once per frame: duplicates of the same asset close to each other are merged,
+ *  and a spawn budget caps how many effects start in one frame.
+ *  Finished components are returned to a pool per asset, which steals its oldest playing component once it's full.
+ */
+UCLASS()
+class UEffectDispatcherSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Actor owning the pooled components */
+	UPROPERTY()
+	TObjectPtr<AActor> ComponentHost;
+
+	/** Component pools, per Niagara system or sound */
+	UPROPERTY()
+	TMap<TObjectPtr<UObject>, FEffectComponentPool> Pools;
+
+	/** Requests queued this frame */
+	TArray<FEffectRequest> Requests;
+
+	/** Requests dispatched this frame, to merge duplicates against */
+	TArray<FEffectRequest> DispatchedRequests;
+
+	/** Running totals for the stats command */
+	int32 NumPlayed = 0;
+	int32 NumMerged = 0;
+	int32 NumDropped = 0;
+	int32 NumComponentsCreated = 0;
+
+public:
+
+	/** Queues a Niagara system and a sound to play at a location. Either may be null */
+	UFUNCTION(BlueprintCallable, Category="Effects", meta = (AdvancedDisplay = "Rotation"))
+	void PlayEffectAtLocation(UNiagaraSystem* System, USoundBase* Sound, FVector Location, FRotator Rotation);
+
+	/** Queues a sound to play without spatialization */
+	UFUNCTION(BlueprintCallable, Category="Effects")
+	void PlaySound2D(USoundBase* Sound);
+
+	/** Logs the pool sizes and dispatch totals. Bound to the Effects.Stats console command */
+	static void DumpStats(const TArray<FString>& Args, UWorld* World);
+
+protected:
+
+	/** Adds a request to this frame's queue */
+	void QueueRequest(UObject* Asset, const FVector& Location, const FRotator& Rotation, bool b2D);
+
+	/** Returns true if an equivalent request has already been dispatched this frame */
+	bool IsDuplicate(const FEffectRequest& Request, float MergeDistanceSquared) const;
+
+	/** Starts a request on a pooled component */
+	void Dispatch(const FEffectRequest& Request, int32 MaxComponentsPerAsset);
+
+	/** Returns a component ready to play the given asset, reusing or stealing one from its pool when possible */
+	USceneComponent* AcquireComponent(UObject* Asset, int32 MaxComponentsPerAsset);
+
+	/** Returns finished components to their pools */
+	void ReclaimComponents();
+
+	/** Returns true if a pooled component is still playing */
+	static bool IsComponentPlaying(const USceneComponent* Component);
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Cleanup */
+	virtual void Deinitialize() override;
+
+public:
+
+	/** Reclaims finished components and dispatches the queued requests */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
@@ -0,0 +1,357 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "GhostPlaybackSubsystem.h"
+#include "GhostProxy.h"
+#include "GhostRecorderComponent.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Math/RandomStream.h"
+#include "Engine/World.h"
+#include "TriangleGameJam.h"
+
+static FAutoConsoleCommandWithWorldAndArgs GhostBenchmarkCommand(
+	TEXT("Ghost.Benchmark"),
+	TEXT("Measures ghost storage per minute and playback cost per ghost. Usage: Ghost.Benchmark [NumGhosts=32] [Seconds=60]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UGhostPlaybackSubsystem::RunBenchmark)
+);
+
+FGhostPlayback::FGhostPlayback() = default;
+FGhostPlayback::~FGhostPlayback() = default;
+FGhostPlayback::FGhostPlayback(FGhostPlayback&&) = default;
+FGhostPlayback& FGhostPlayback::operator=(FGhostPlayback&&) = default;
+
+bool FGhostPlayback::Open(const FString& Path)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	const uint8* StreamData = nullptr;
+	int64 StreamSize = 0;
+
+	// try to memory map the file so the OS pages the stream in as it's decoded
+	FOpenMappedResult MappedResult = PlatformFile.OpenMappedEx(*Path);
+
+	if (MappedResult.HasValue())
+	{
+		MappedHandle = MappedResult.StealValue();
+		MappedRegion.Reset(MappedHandle->MapRegion(0, MappedHandle->GetFileSize()));
+	}
+
+	if (MappedRegion.IsValid())
+	{
+		StreamData = MappedRegion->GetMappedPtr();
+		StreamSize = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(OwnedData, *Path))
+	{
+		// mapping is not supported on this platform, fall back to reading the whole file
+		StreamData = OwnedData.GetData();
+		StreamSize = OwnedData.Num();
+	}
+
+	if (!Reader.Initialize(StreamData, StreamSize))
+	{
+		UE_LOG(LogTriangleGameJam, Warning, TEXT("Invalid ghost file %s"), *Path);
+		return false;
+	}
+
+	Restart();
+
+	return true;
+}
+
+void FGhostPlayback::Restart()
+{
+	Reader.Rewind();
+	PlaybackTime = 0.0f;
+
+	// prime the first two poses
+	Reader.ReadNext(FromPose);
+	ToPose = FromPose;
+	ToIndex = 0;
+
+	if (Reader.ReadNext(ToPose))
+	{
+		ToIndex = 1;
+	}
+}
+
+void FGhostPlayback::Advance(float DeltaTime, FGhostPose& OutPose, float& OutSpeed)
+{
+	const FGhostStreamHeader& Header = Reader.GetHeader();
+
+	// clamp to the end of the recording so finished ghosts hold their last pose
+	PlaybackTime = FMath::Min(PlaybackTime + DeltaTime, Header.GetDuration());
+
+	const float SamplePosition = PlaybackTime * Header.SampleRate;
+
+	// decode forward until the next pose is ahead of the playback time
+	while (static_cast<float>(ToIndex) < SamplePosition)
+	{
+		FGhostPose NextPose;
+
+		if (!Reader.ReadNext(NextPose))
+		{
+			break;
+		}
+
+		FromPose = ToPose;
+		ToPose = NextPose;
+		++ToIndex;
+	}
+
+	// interpolate between the bracketing poses
+	const float Alpha = FMath::Clamp(SamplePosition - static_cast<float>(ToIndex) + 1.0f, 0.0f, 1.0f);
+
+	OutPose.Location = FMath::Lerp(FromPose.Location, ToPose.Location, Alpha);
+	OutPose.Yaw = FromPose.Yaw + FRotator::NormalizeAxis(ToPose.Yaw - FromPose.Yaw) * Alpha;
+	OutPose.Flags = Alpha < 0.5f ? FromPose.Flags : ToPose.Flags;
+
+	// finished ghosts hold their last pose, so they should idle instead of running in place
+	const bool bPastLastSample = SamplePosition >= static_cast<float>(ToIndex) && ToIndex + 1 >= Header.SampleCount;
+
+	OutSpeed = bPastLastSample ? 0.0f : FVector::Dist2D(FromPose.Location, ToPose.Location) * Header.SampleRate;
+}
+
+int32 UGhostPlaybackSubsystem::StartGhostPlayback(TSubclassOf<AGhostProxy> ProxyClass, int32 MaxGhosts)
+{
+	StopGhostPlayback();
+
+	// find all ghosts recorded for this level
+	const FString GhostDirectory = UGhostRecorderComponent::GetGhostDirectory(GetWorld());
+
+	TArray<FString> GhostFiles;
+	IFileManager::Get().FindFiles(GhostFiles, *FPaths::Combine(GhostDirectory, TEXT("*.ghost")), true, false);
+
+	// recordings are named by timestamp, so sort them to play the most recent first
+	GhostFiles.Sort([](const FString& A, const FString& B) { return A > B; });
+
+	Ghosts.Reserve(FMath::Min(GhostFiles.Num(), MaxGhosts));
+
+	for (const FString& GhostFile : GhostFiles)
+	{
+		if (Ghosts.Num() >= MaxGhosts)
+		{
+			break;
+		}
+
+		FGhostPlayback Playback;
+
+		if (!Playback.Open(FPaths::Combine(GhostDirectory, GhostFile)))
+		{
+			continue;
+		}
+
+		// spawn the pose-only proxy at the first recorded pose
+		if (IsValid(ProxyClass))
+		{
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+			Playback.Proxy = GetWorld()->SpawnActor<AGhostProxy>(ProxyClass, Playback.FromPose.Location, FRotator(0.0f, Playback.FromPose.Yaw, 0.0f), SpawnParams);
+		}
+
+		Ghosts.Add(MoveTemp(Playback));
+	}
+
+	return Ghosts.Num();
+}
+
+void UGhostPlaybackSubsystem::StopGhostPlayback()
+{
+	// remove the proxies
+	for (FGhostPlayback& Ghost : Ghosts)
+	{
+		if (AGhostProxy* Proxy = Ghost.Proxy.Get())
+		{
+			Proxy->Destroy();
+		}
+	}
+
+	// unmap the files
+	Ghosts.Reset();
+}
+
+void UGhostPlaybackSubsystem::RestartGhosts()
+{
+	for (FGhostPlayback& Ghost : Ghosts)
+	{
+		Ghost.Restart();
+	}
+}
+
+bool UGhostPlaybackSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UGhostPlaybackSubsystem::Deinitialize()
+{
+	// release the mapped files
+	Ghosts.Reset();
+
+	Super::Deinitialize();
+}
+
+void UGhostPlaybackSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UGhostPlaybackSubsystem::Tick);
+
+	FGhostPose Pose;
+	float Speed;
+
+	for (FGhostPlayback& Ghost : Ghosts)
+	{
+		Ghost.Advance(DeltaTime, Pose, Speed);
+
+		if (AGhostProxy* Proxy = Ghost.Proxy.Get())
+		{
+			Proxy->ApplyPose(Pose, Speed);
+		}
+	}
+}
+
+TStatId UGhostPlaybackSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGhostPlaybackSubsystem, STATGROUP_Tickables);
+}
+
+void UGhostPlaybackSubsystem::RunBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	const int32 NumGhosts = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 32;
+	const float Seconds = Args.Num() > 1 ? FMath::Max(1.0f, FCString::Atof(*Args[1])) : 60.0f;
+
+	// synthesize a deterministic platforming run: running with turns, jumps and dashes
+	FRandomStream Random(1234);
+	FGhostStreamWriter Writer;
+
+	const float SampleStep = 1.0f / Writer.GetHeader().SampleRate;
+	const int32 NumSamples = FMath::CeilToInt(Seconds * Writer.GetHeader().SampleRate);
+
+	FVector Location(0.0f, 0.0f, 90.0f);
+	float Yaw = 0.0f;
+	float JumpTime = -1.0f;
+	float DashTime = -1.0f;
+
+	for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+	{
+		EGhostAbilityFlags Flags = EGhostAbilityFlags::None;
+
+		// occasionally turn
+		if (Random.FRand() < 0.05f)
+		{
+			Yaw = FRotator::ClampAxis(Yaw + Random.FRandRange(-90.0f, 90.0f));
+		}
+
+		// occasionally jump or dash
+		if (JumpTime < 0.0f && Random.FRand() < 0.02f)
+		{
+			JumpTime = 0.0f;
+		}
+
+		if (DashTime < 0.0f && Random.FRand() < 0.01f)
+		{
+			DashTime = 0.0f;
+		}
+
+		float Speed = 750.0f;
+
+		if (DashTime >= 0.0f)
+		{
+			Speed = 2000.0f;
+			Flags |= EGhostAbilityFlags::Dashing;
+			DashTime += SampleStep;
+
+			if (DashTime > 0.3f)
+			{
+				DashTime = -1.0f;
+			}
+		}
+
+		if (JumpTime >= 0.0f)
+		{
+			Flags |= EGhostAbilityFlags::Falling;
+			Location.Z = 90.0f + 700.0f * JumpTime - 0.5f * 2450.0f * JumpTime * JumpTime;
+			JumpTime += SampleStep;
+
+			if (Location.Z <= 90.0f)
+			{
+				Location.Z = 90.0f;
+				JumpTime = -1.0f;
+			}
+		}
+
+		Location += FRotator(0.0f, Yaw, 0.0f).Vector() * Speed * SampleStep;
+
+		FGhostPose Pose;
+		Pose.Location = Location;
+		Pose.Yaw = Yaw;
+		Pose.Flags = static_cast<uint8>(Flags);
+
+		Writer.AddSample(Pose);
+	}
+
+	// save the stream so playback goes through the real memory mapped path
+	const TArray<uint8> Stream = Writer.Finalize();
+	const FString BenchmarkPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Ghosts"), TEXT("Benchmark"), TEXT("Benchmark.ghost"));
+
+	if (!FFileHelper::SaveArrayToFile(Stream, *BenchmarkPath))
+	{
+		UE_LOG(LogTriangleGameJam, Error, TEXT("Ghost.Benchmark: could not write %s"), *BenchmarkPath);
+		return;
+	}
+
+	const double BytesPerMinute = Stream.Num() * (60.0 / Seconds);
+
+	// open every ghost from the same file
+	TArray<FGhostPlayback> Playbacks;
+	Playbacks.SetNum(NumGhosts);
+
+	const double OpenStart = FPlatformTime::Seconds();
+
+	for (FGhostPlayback& Playback : Playbacks)
+	{
+		if (!Playback.Open(BenchmarkPath))
+		{
+			return;
+		}
+	}
+
+	const double OpenTime = FPlatformTime::Seconds() - OpenStart;
+
+	// play back the whole recording at 60 fps
+	const float FrameStep = 1.0f / 60.0f;
+	const int32 NumFrames = FMath::CeilToInt(Seconds / FrameStep);
+
+	FGhostPose Pose;
+	float Speed;
+	FVector Checksum = FVector::ZeroVector;
+
+	const double PlaybackStart = FPlatformTime::Seconds();
+
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		for (FGhostPlayback& Playback : Playbacks)
+		{
+			Playback.Advance(FrameStep, Pose, Speed);
+			Checksum += Pose.Location;
+		}
+	}
+
+	const double PlaybackTime = FPlatformTime::Seconds() - PlaybackStart;
+	const double NanosecondsPerGhostFrame = PlaybackTime * 1.0e9 / (double(NumFrames) * NumGhosts);
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Ghost.Benchmark: %d samples, %d bytes, %.2f KB per ghost minute (%.2f bytes per sample)"),
+		NumSamples, Stream.Num(), BytesPerMinute / 1024.0, double(Stream.Num() - FGhostStreamHeader::SerializedSize) / NumSamples);
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Ghost.Benchmark: %d ghosts x %d frames, %.1f ns per ghost per frame, %.3f ms per frame for all ghosts, %.3f ms to open (checksum %s)"),
+		NumGhosts, NumFrames, NanosecondsPerGhostFrame, PlaybackTime * 1000.0 / NumFrames, OpenTime * 1000.0, *Checksum.ToString());
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Ghost.Benchmark: %d bytes of decoder state per ghost, excluding mapped pages"), static_cast<int32>(sizeof(FGhostPlayback)));
+}
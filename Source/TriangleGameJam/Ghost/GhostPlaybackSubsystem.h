@@ -0,0 +1,109 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GhostTypes.h"
+#include "GhostPlaybackSubsystem.generated.h"
+
+class AGhostProxy;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ *  Playback state for a single ghost.
+ *  The stream is decoded incrementally straight out of a memory mapped file, so only two poses are resident per ghost.
+ */
+struct FGhostPlayback
+{
+	/** Memory mapped ghost file */
+	TUniquePtr<IMappedFileHandle> MappedHandle;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	/** Fallback storage for platforms that can't memory map files */
+	TArray<uint8> OwnedData;
+
+	/** Incremental stream decoder */
+	FGhostStreamReader Reader;
+
+	/** Decoded poses bracketing the current playback time */
+	FGhostPose FromPose;
+	FGhostPose ToPose;
+
+	/** Sample index of ToPose */
+	uint32 ToIndex = 0;
+
+	/** Elapsed playback time */
+	float PlaybackTime = 0.0f;
+
+	/** Proxy actor displaying this ghost, if any */
+	TWeakObjectPtr<AGhostProxy> Proxy;
+
+	/** Constructor and destructor are out of line so the mapped file types can stay forward declared */
+	FGhostPlayback();
+	~FGhostPlayback();
+	FGhostPlayback(FGhostPlayback&&);
+	FGhostPlayback& operator=(FGhostPlayback&&);
+
+	/** Maps the ghost file and primes the first two poses. Returns false if the file is not a valid ghost */
+	bool Open(const FString& Path);
+
+	/** Resets playback to the start of the recording */
+	void Restart();
+
+	/** Advances playback and returns the interpolated pose and ground speed */
+	void Advance(float DeltaTime, FGhostPose& OutPose, float& OutSpeed);
+};
+
+/**
+ *  Plays back recorded time trial ghosts for the current level.
+ *  Dozens of ghosts can run at once: each one is a memory mapped stream plus a pose-only proxy actor.
+ */
+UCLASS()
+class UGhostPlaybackSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Ghosts currently playing */
+	TArray<FGhostPlayback> Ghosts;
+
+public:
+
+	/** Loads the most recent ghosts recorded for this level and spawns a proxy for each. Returns the number of ghosts started */
+	UFUNCTION(BlueprintCallable, Category="Ghost")
+	int32 StartGhostPlayback(TSubclassOf<AGhostProxy> ProxyClass, int32 MaxGhosts = 32);
+
+	/** Stops all ghosts and removes their proxies */
+	UFUNCTION(BlueprintCallable, Category="Ghost")
+	void StopGhostPlayback();
+
+	/** Restarts all ghosts from the beginning of their recordings */
+	UFUNCTION(BlueprintCallable, Category="Ghost")
+	void RestartGhosts();
+
+	/** Returns the number of ghosts currently playing */
+	UFUNCTION(BlueprintPure, Category="Ghost")
+	int32 GetNumGhosts() const { return Ghosts.Num(); }
+
+	/** Measures ghost storage per minute and playback cost per ghost. Bound to the Ghost.Benchmark console command */
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World);
+
+protected:
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Cleanup */
+	virtual void Deinitialize() override;
+
+public:
+
+	/** Advances all ghosts */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
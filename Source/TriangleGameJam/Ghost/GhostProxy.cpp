@@ -0,0 +1,66 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "GhostProxy.h"
+#include "Components/SceneComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+
+AGhostProxy::AGhostProxy()
+{
+	// the playback subsystem moves the proxy, so it never needs to tick
+	PrimaryActorTick.bCanEverTick = false;
+
+	// create the root
+	RootComponent = Root = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	// create the mesh
+	Mesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Mesh"));
+	Mesh->SetupAttachment(RootComponent);
+
+	// ghosts are purely visual
+	Mesh->SetCollisionProfileName(FName("NoCollision"));
+	Mesh->SetGenerateOverlapEvents(false);
+	Mesh->SetCastShadow(false);
+	Mesh->bReceivesDecals = false;
+
+	// only animate ghosts that are on screen
+	Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+	Mesh->bEnableUpdateRateOptimizations = true;
+
+	// set the mesh offset to match a default character capsule
+	Mesh->SetRelativeLocationAndRotation(FVector(0.0f, 0.0f, -90.0f), FRotator(0.0f, -90.0f, 0.0f));
+
+	SetActorEnableCollision(false);
+}
+
+void AGhostProxy::ApplyPose(const FGhostPose& Pose, float InSpeed)
+{
+	// move without sweeping or updating overlaps
+	SetActorLocationAndRotation(Pose.Location, FRotator(0.0f, Pose.Yaw, 0.0f), false, nullptr, ETeleportType::TeleportPhysics);
+
+	Speed = InSpeed;
+
+	// notify BP only when the flags actually change
+	if (Pose.Flags != AbilityFlags)
+	{
+		const uint8 OldFlags = AbilityFlags;
+		AbilityFlags = Pose.Flags;
+
+		OnAbilityFlagsChanged(OldFlags, AbilityFlags);
+	}
+}
+
+bool AGhostProxy::IsDashing() const
+{
+	return EnumHasAnyFlags(static_cast<EGhostAbilityFlags>(AbilityFlags), EGhostAbilityFlags::Dashing);
+}
+
+bool AGhostProxy::HasDoubleJumped() const
+{
+	return EnumHasAnyFlags(static_cast<EGhostAbilityFlags>(AbilityFlags), EGhostAbilityFlags::DoubleJumped);
+}
+
+bool AGhostProxy::IsFalling() const
+{
+	return EnumHasAnyFlags(static_cast<EGhostAbilityFlags>(AbilityFlags), EGhostAbilityFlags::Falling);
+}
@@ -0,0 +1,65 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "GhostTypes.h"
+#include "GhostProxy.generated.h"
+
+class USkeletalMeshComponent;
+
+/**
+ *  A lightweight pose-only stand-in for a recorded character.
+ *  Has no movement component, collision or tick of its own; the ghost playback subsystem drives its transform.
+ *  The Animation Blueprint can read the replayed speed and ability flags to pick a locomotion pose.
+ */
+UCLASS(abstract)
+class AGhostProxy : public AActor
+{
+	GENERATED_BODY()
+
+	/** Root component, placed at the recorded capsule center */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	USceneComponent* Root;
+
+	/** Ghost mesh */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	USkeletalMeshComponent* Mesh;
+
+protected:
+
+	/** Current replayed ground speed */
+	UPROPERTY(BlueprintReadOnly, Category="Ghost")
+	float Speed = 0.0f;
+
+	/** Current replayed ability flags */
+	UPROPERTY(BlueprintReadOnly, Category="Ghost", meta = (Bitmask, BitmaskEnum = "/Script/TriangleGameJam.EGhostAbilityFlags"))
+	uint8 AbilityFlags = 0;
+
+public:
+
+	/** Constructor */
+	AGhostProxy();
+
+	/** Applies an interpolated pose from the playback subsystem */
+	void ApplyPose(const FGhostPose& Pose, float InSpeed);
+
+	/** Returns true if the replayed character was dashing */
+	UFUNCTION(BlueprintPure, Category="Ghost")
+	bool IsDashing() const;
+
+	/** Returns true if the replayed character had double jumped */
+	UFUNCTION(BlueprintPure, Category="Ghost")
+	bool HasDoubleJumped() const;
+
+	/** Returns true if the replayed character was in the air */
+	UFUNCTION(BlueprintPure, Category="Ghost")
+	bool IsFalling() const;
+
+protected:
+
+	/** Blueprint handler to play effects when the replayed ability flags change */
+	UFUNCTION(BlueprintImplementableEvent, Category="Ghost")
+	void OnAbilityFlagsChanged(uint8 OldFlags, uint8 NewFlags);
+};
@@ -0,0 +1,28 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "GhostTypes.h"
+#include "GhostRecordable.generated.h"
+
+/**
+ *  GhostRecordable interface
+ *  Lets the ghost recorder query ability state flags from characters without depending on their concrete class
+ */
+UINTERFACE(MinimalAPI, NotBlueprintable)
+class UGhostRecordable : public UInterface
+{
+	GENERATED_BODY()
+};
+
+class IGhostRecordable
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Returns the ability flags that should be recorded for the current frame */
+	virtual EGhostAbilityFlags GetGhostAbilityFlags() const = 0;
+};
@@ -0,0 +1,200 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "GhostRecorderComponent.h"
+#include "GhostRecordable.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "TriangleGameJam.h"
+
+UGhostRecorderComponent::UGhostRecorderComponent()
+{
+	// only tick while recording
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// sample after movement has been resolved for the frame
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void UGhostRecorderComponent::StartRecording()
+{
+	// create a fresh stream
+	Writer = MakeUnique<FGhostStreamWriter>(static_cast<uint16>(SampleRate), PositionQuantum, static_cast<uint16>(KeyframeInterval));
+
+	// record the first sample right away so the ghost starts at the correct location
+	Writer->AddSample(CapturePose());
+	SampleAccumulator = 0.0f;
+
+	SetComponentTickEnabled(true);
+}
+
+FString UGhostRecorderComponent::StopRecording(bool bSave)
+{
+	SetComponentTickEnabled(false);
+
+	// ignore if we're not recording
+	if (!Writer.IsValid())
+	{
+		return FString();
+	}
+
+	FString SavedPath;
+
+	// only save recordings with at least a second of data
+	if (bSave && Writer->GetSampleCount() > static_cast<uint32>(SampleRate))
+	{
+		const FString GhostDirectory = GetGhostDirectory(this);
+		SavedPath = FPaths::Combine(GhostDirectory, FDateTime::Now().ToString() + TEXT(".ghost"));
+
+		if (FFileHelper::SaveArrayToFile(Writer->Finalize(), *SavedPath))
+		{
+			// keep the directory from growing with every session
+			PruneGhosts(GhostDirectory);
+		}
+		else
+		{
+			UE_LOG(LogTriangleGameJam, Warning, TEXT("Could not save ghost recording to %s"), *SavedPath);
+			SavedPath.Reset();
+		}
+	}
+
+	Writer.Reset();
+
+	return SavedPath;
+}
+
+FString UGhostRecorderComponent::GetGhostDirectory(const UObject* WorldContextObject)
+{
+	// ghosts are grouped per level so each time trial only loads its own
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Ghosts"), UGameplayStatics::GetCurrentLevelName(WorldContextObject, true));
+}
+
+void UGhostRecorderComponent::PruneGhosts(const FString& GhostDirectory) const
+{
+	TArray<FString> GhostFiles;
+	IFileManager::Get().FindFiles(GhostFiles, *FPaths::Combine(GhostDirectory, TEXT("*.ghost")), true, false);
+
+	if (GhostFiles.Num() <= MaxSavedGhosts)
+	{
+		return;
+	}
+
+	// recordings are named by timestamp, so sort them most recent first, same as playback
+	GhostFiles.Sort([](const FString& A, const FString& B) { return A > B; });
+
+	for (int32 FileIndex = MaxSavedGhosts; FileIndex < GhostFiles.Num(); ++FileIndex)
+	{
+		IFileManager::Get().Delete(*FPaths::Combine(GhostDirectory, GhostFiles[FileIndex]), false, false, true);
+	}
+}
+
+FGhostPose UGhostRecorderComponent::CapturePose() const
+{
+	FGhostPose Pose;
+
+	const AActor* Owner = GetOwner();
+	Pose.Location = Owner->GetActorLocation();
+	Pose.Yaw = Owner->GetActorRotation().Yaw;
+
+	EGhostAbilityFlags Flags = EGhostAbilityFlags::None;
+
+	// query the character's ability state
+	if (const IGhostRecordable* Recordable = Cast<IGhostRecordable>(Owner))
+	{
+		Flags |= Recordable->GetGhostAbilityFlags();
+	}
+
+	// falling state is common to all pawns
+	if (const APawn* Pawn = Cast<APawn>(Owner))
+	{
+		if (Pawn->GetMovementComponent() && Pawn->GetMovementComponent()->IsFalling())
+		{
+			Flags |= EGhostAbilityFlags::Falling;
+		}
+	}
+
+	Pose.Flags = static_cast<uint8>(Flags);
+
+	return Pose;
+}
+
+void UGhostRecorderComponent::OnOwnerControllerChanged(APawn* Pawn, AController* OldController, AController* NewController)
+{
+	const bool bLocallyControlled = Pawn && Pawn->IsLocallyControlled();
+
+	if (bLocallyControlled && !IsRecording())
+	{
+		StartRecording();
+	}
+	else if (!bLocallyControlled && IsRecording())
+	{
+		// save what we have, e.g. when the player unpossesses the character
+		StopRecording(true);
+	}
+}
+
+void UGhostRecorderComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	APawn* Pawn = Cast<APawn>(GetOwner());
+
+	if (!bRecordOnBeginPlay || !Pawn)
+	{
+		return;
+	}
+
+	// the controller may only be assigned or replicated after begin play, so follow possession changes
+	Pawn->ReceiveControllerChangedDelegate.AddDynamic(this, &UGhostRecorderComponent::OnOwnerControllerChanged);
+
+	// only record locally controlled characters
+	if (Pawn->IsLocallyControlled())
+	{
+		StartRecording();
+	}
+}
+
+void UGhostRecorderComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (APawn* Pawn = Cast<APawn>(GetOwner()))
+	{
+		Pawn->ReceiveControllerChangedDelegate.RemoveDynamic(this, &UGhostRecorderComponent::OnOwnerControllerChanged);
+	}
+
+	// save any recording in progress
+	StopRecording(true);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UGhostRecorderComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!Writer.IsValid())
+	{
+		return;
+	}
+
+	// emit as many samples as the elapsed time requires so the stream keeps a fixed rate
+	const float SampleStep = 1.0f / SampleRate;
+	SampleAccumulator += DeltaTime;
+
+	if (SampleAccumulator >= SampleStep)
+	{
+		const FGhostPose Pose = CapturePose();
+
+		while (SampleAccumulator >= SampleStep)
+		{
+			Writer->AddSample(Pose);
+			SampleAccumulator -= SampleStep;
+		}
+	}
+}
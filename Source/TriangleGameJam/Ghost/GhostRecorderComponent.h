@@ -0,0 +1,93 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GhostTypes.h"
+#include "GhostRecorderComponent.generated.h"
+
+class APawn;
+class AController;
+
+/**
+ *  Records the owning character's pose into a compact ghost stream for time trial playback.
+ *  Samples are taken at a fixed rate regardless of frame rate and saved per level under Saved/Ghosts.
+ *  Only the most recent recordings per level are kept, matching the ghosts playback picks.
+ */
+UCLASS(ClassGroup=(Ghost), meta=(BlueprintSpawnableComponent))
+class UGhostRecorderComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** If true, recording starts automatically once the owner is locally controlled, whether at begin play or when it's possessed later */
+	UPROPERTY(EditAnywhere, Category="Ghost")
+	bool bRecordOnBeginPlay = true;
+
+	/** Number of pose samples recorded per second */
+	UPROPERTY(EditAnywhere, Category="Ghost", meta = (ClampMin = 5, ClampMax = 60, Units = "Hz"))
+	int32 SampleRate = 30;
+
+	/** Size of a position quantization step */
+	UPROPERTY(EditAnywhere, Category="Ghost", meta = (ClampMin = 0.1, ClampMax = 10, Units = "cm"))
+	float PositionQuantum = 1.0f;
+
+	/** Number of samples between absolute keyframes */
+	UPROPERTY(EditAnywhere, Category="Ghost", meta = (ClampMin = 1, ClampMax = 600))
+	int32 KeyframeInterval = 60;
+
+	/** Number of recordings kept per level. Older ones are deleted when a new one is saved */
+	UPROPERTY(EditAnywhere, Category="Ghost", meta = (ClampMin = 1, ClampMax = 256))
+	int32 MaxSavedGhosts = 32;
+
+	/** Stream writer for the current recording */
+	TUniquePtr<FGhostStreamWriter> Writer;
+
+	/** Time accumulated since the last recorded sample */
+	float SampleAccumulator = 0.0f;
+
+public:
+
+	/** Constructor */
+	UGhostRecorderComponent();
+
+	/** Starts a new recording, discarding any recording in progress */
+	UFUNCTION(BlueprintCallable, Category="Ghost")
+	void StartRecording();
+
+	/** Stops the current recording. If requested, saves it and returns the saved file path */
+	UFUNCTION(BlueprintCallable, Category="Ghost")
+	FString StopRecording(bool bSave = true);
+
+	/** Returns true if a recording is in progress */
+	UFUNCTION(BlueprintPure, Category="Ghost")
+	bool IsRecording() const { return Writer.IsValid(); }
+
+	/** Returns the directory ghosts for the given world are saved to */
+	static FString GetGhostDirectory(const UObject* WorldContextObject);
+
+protected:
+
+	/** Samples the owner's current pose */
+	FGhostPose CapturePose() const;
+
+	/** Deletes the oldest recordings in a ghost directory until at most MaxSavedGhosts remain */
+	void PruneGhosts(const FString& GhostDirectory) const;
+
+	/** Starts or stops recording as the owning pawn gains or loses local control */
+	UFUNCTION()
+	void OnOwnerControllerChanged(APawn* Pawn, AController* OldController, AController* NewController);
+
+	/** Initialization */
+	virtual void BeginPlay() override;
+
+	/** Cleanup */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+
+	/** Records pose samples at the fixed sample rate */
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+};
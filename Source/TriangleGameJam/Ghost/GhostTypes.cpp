@@ -0,0 +1,311 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "GhostTypes.h"
+
+namespace GhostStream
+{
+	/** Control byte bits */
+	constexpr uint8 KeyframeBit = 1 << 0;
+	constexpr uint8 FlagsBit = 1 << 1;
+
+	/** Maps signed values to unsigned so small magnitudes encode into few varint bytes */
+	FORCEINLINE uint32 ZigZagEncode(int32 Value)
+	{
+		return (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+	}
+
+	FORCEINLINE int32 ZigZagDecode(uint32 Value)
+	{
+		return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1);
+	}
+
+	void WriteVarInt(TArray<uint8>& Out, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Out.Add(static_cast<uint8>(Value | 0x80));
+			Value >>= 7;
+		}
+
+		Out.Add(static_cast<uint8>(Value));
+	}
+
+	bool ReadVarInt(const uint8* Data, int64 Size, int64& Cursor, uint32& OutValue)
+	{
+		OutValue = 0;
+
+		// a 32 bit value never takes more than 5 bytes
+		for (int32 Shift = 0; Shift < 35; Shift += 7)
+		{
+			if (Cursor >= Size)
+			{
+				return false;
+			}
+
+			const uint8 Byte = Data[Cursor++];
+			OutValue |= static_cast<uint32>(Byte & 0x7F) << Shift;
+
+			if ((Byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/** Little endian fixed size writers, so streams are portable between platforms */
+	void WriteU16(TArray<uint8>& Out, uint16 Value)
+	{
+		Out.Add(static_cast<uint8>(Value));
+		Out.Add(static_cast<uint8>(Value >> 8));
+	}
+
+	void WriteU32(TArray<uint8>& Out, uint32 Value)
+	{
+		WriteU16(Out, static_cast<uint16>(Value));
+		WriteU16(Out, static_cast<uint16>(Value >> 16));
+	}
+
+	FORCEINLINE uint16 ReadU16(const uint8* Data)
+	{
+		return static_cast<uint16>(Data[0] | (Data[1] << 8));
+	}
+
+	FORCEINLINE uint32 ReadU32(const uint8* Data)
+	{
+		return static_cast<uint32>(ReadU16(Data)) | (static_cast<uint32>(ReadU16(Data + 2)) << 16);
+	}
+
+	/** Yaw is stored as a 16 bit binary angle */
+	FORCEINLINE uint16 QuantizeYaw(float Yaw)
+	{
+		return static_cast<uint16>(FMath::RoundToInt(FRotator::ClampAxis(Yaw) * (65536.0f / 360.0f)) & 0xFFFF);
+	}
+
+	FORCEINLINE float DequantizeYaw(uint16 Yaw)
+	{
+		return static_cast<float>(Yaw) * (360.0f / 65536.0f);
+	}
+}
+
+FGhostStreamWriter::FGhostStreamWriter(uint16 InSampleRate, float InPositionQuantum, uint16 InKeyframeInterval)
+{
+	Header.SampleRate = FMath::Max<uint16>(InSampleRate, 1);
+	Header.PositionQuantum = FMath::Max(InPositionQuantum, KINDA_SMALL_NUMBER);
+	Header.KeyframeInterval = FMath::Max<uint16>(InKeyframeInterval, 1);
+
+	// a 30Hz minute of movement fits comfortably in a few kilobytes
+	Data.Reserve(Header.SampleRate * 60 * 4);
+}
+
+void FGhostStreamWriter::AddSample(const FGhostPose& Pose)
+{
+	using namespace GhostStream;
+
+	// quantize the pose
+	const FIntVector Position(
+		FMath::RoundToInt(Pose.Location.X / Header.PositionQuantum),
+		FMath::RoundToInt(Pose.Location.Y / Header.PositionQuantum),
+		FMath::RoundToInt(Pose.Location.Z / Header.PositionQuantum));
+
+	const uint16 Yaw = QuantizeYaw(Pose.Yaw);
+
+	// is this a keyframe?
+	const bool bKeyframe = (Header.SampleCount % Header.KeyframeInterval) == 0;
+
+	// keyframes always carry the flags so playback can start from any of them
+	const bool bWriteFlags = bKeyframe || Pose.Flags != LastFlags;
+
+	Data.Add((bKeyframe ? KeyframeBit : 0) | (bWriteFlags ? FlagsBit : 0));
+
+	if (bKeyframe)
+	{
+		// store the absolute quantized pose
+		WriteU32(Data, static_cast<uint32>(Position.X));
+		WriteU32(Data, static_cast<uint32>(Position.Y));
+		WriteU32(Data, static_cast<uint32>(Position.Z));
+		WriteU16(Data, Yaw);
+
+		// reset the predictor
+		PrevPosition = Position;
+	}
+	else
+	{
+		// predict the position assuming constant velocity and store only the error
+		const FIntVector Predicted = LastPosition + (LastPosition - PrevPosition);
+		const FIntVector Error = Position - Predicted;
+
+		WriteVarInt(Data, ZigZagEncode(Error.X));
+		WriteVarInt(Data, ZigZagEncode(Error.Y));
+		WriteVarInt(Data, ZigZagEncode(Error.Z));
+
+		// store the shortest signed yaw delta
+		WriteVarInt(Data, ZigZagEncode(static_cast<int16>(Yaw - LastYaw)));
+
+		PrevPosition = LastPosition;
+	}
+
+	if (bWriteFlags)
+	{
+		Data.Add(Pose.Flags);
+	}
+
+	LastPosition = Position;
+	LastYaw = Yaw;
+	LastFlags = Pose.Flags;
+
+	++Header.SampleCount;
+	Header.DataSize = Data.Num();
+}
+
+TArray<uint8> FGhostStreamWriter::Finalize() const
+{
+	using namespace GhostStream;
+
+	TArray<uint8> Stream;
+	Stream.Reserve(FGhostStreamHeader::SerializedSize + Data.Num());
+
+	// write the header
+	WriteU32(Stream, FGhostStreamHeader::StreamMagic);
+	WriteU16(Stream, FGhostStreamHeader::StreamVersion);
+	WriteU16(Stream, Header.SampleRate);
+	WriteU16(Stream, Header.KeyframeInterval);
+	WriteU16(Stream, 0);
+
+	uint32 QuantumBits;
+	FMemory::Memcpy(&QuantumBits, &Header.PositionQuantum, sizeof(QuantumBits));
+	WriteU32(Stream, QuantumBits);
+
+	WriteU32(Stream, Header.SampleCount);
+	WriteU32(Stream, Header.DataSize);
+
+	check(Stream.Num() == FGhostStreamHeader::SerializedSize);
+
+	// append the sample data
+	Stream.Append(Data);
+
+	return Stream;
+}
+
+bool FGhostStreamReader::Initialize(const uint8* InStreamData, int64 InStreamSize)
+{
+	using namespace GhostStream;
+
+	SampleData = nullptr;
+
+	// validate the header
+	if (!InStreamData || InStreamSize < FGhostStreamHeader::SerializedSize)
+	{
+		return false;
+	}
+
+	if (ReadU32(InStreamData) != FGhostStreamHeader::StreamMagic || ReadU16(InStreamData + 4) != FGhostStreamHeader::StreamVersion)
+	{
+		return false;
+	}
+
+	Header.SampleRate = ReadU16(InStreamData + 6);
+	Header.KeyframeInterval = ReadU16(InStreamData + 8);
+
+	const uint32 QuantumBits = ReadU32(InStreamData + 12);
+	FMemory::Memcpy(&Header.PositionQuantum, &QuantumBits, sizeof(QuantumBits));
+
+	Header.SampleCount = ReadU32(InStreamData + 16);
+	Header.DataSize = ReadU32(InStreamData + 20);
+
+	// ensure the sample data fits in the provided memory
+	if (Header.SampleRate == 0 || Header.KeyframeInterval == 0 || Header.DataSize > InStreamSize - FGhostStreamHeader::SerializedSize)
+	{
+		return false;
+	}
+
+	SampleData = InStreamData + FGhostStreamHeader::SerializedSize;
+	SampleDataSize = Header.DataSize;
+
+	Rewind();
+
+	return true;
+}
+
+bool FGhostStreamReader::ReadNext(FGhostPose& OutPose)
+{
+	using namespace GhostStream;
+
+	if (!SampleData || NextSample >= Header.SampleCount || Cursor >= SampleDataSize)
+	{
+		return false;
+	}
+
+	const uint8 Control = SampleData[Cursor++];
+
+	FIntVector Position;
+	uint16 Yaw;
+
+	if (Control & KeyframeBit)
+	{
+		// absolute pose: 3 x int32 + uint16
+		if (Cursor + 14 > SampleDataSize)
+		{
+			return false;
+		}
+
+		Position.X = static_cast<int32>(ReadU32(SampleData + Cursor));
+		Position.Y = static_cast<int32>(ReadU32(SampleData + Cursor + 4));
+		Position.Z = static_cast<int32>(ReadU32(SampleData + Cursor + 8));
+		Yaw = ReadU16(SampleData + Cursor + 12);
+		Cursor += 14;
+
+		PrevPosition = Position;
+	}
+	else
+	{
+		uint32 ErrorX, ErrorY, ErrorZ, YawDelta;
+
+		if (!ReadVarInt(SampleData, SampleDataSize, Cursor, ErrorX)
+			|| !ReadVarInt(SampleData, SampleDataSize, Cursor, ErrorY)
+			|| !ReadVarInt(SampleData, SampleDataSize, Cursor, ErrorZ)
+			|| !ReadVarInt(SampleData, SampleDataSize, Cursor, YawDelta))
+		{
+			return false;
+		}
+
+		// apply the stored error to the same prediction the writer made
+		const FIntVector Predicted = LastPosition + (LastPosition - PrevPosition);
+		Position = Predicted + FIntVector(ZigZagDecode(ErrorX), ZigZagDecode(ErrorY), ZigZagDecode(ErrorZ));
+		Yaw = static_cast<uint16>(LastYaw + ZigZagDecode(YawDelta));
+
+		PrevPosition = LastPosition;
+	}
+
+	if (Control & FlagsBit)
+	{
+		if (Cursor >= SampleDataSize)
+		{
+			return false;
+		}
+
+		LastFlags = SampleData[Cursor++];
+	}
+
+	LastPosition = Position;
+	LastYaw = Yaw;
+	++NextSample;
+
+	// dequantize
+	OutPose.Location = FVector(Position) * Header.PositionQuantum;
+	OutPose.Yaw = DequantizeYaw(Yaw);
+	OutPose.Flags = LastFlags;
+
+	return true;
+}
+
+void FGhostStreamReader::Rewind()
+{
+	Cursor = 0;
+	NextSample = 0;
+	LastPosition = PrevPosition = FIntVector::ZeroValue;
+	LastYaw = 0;
+	LastFlags = 0;
+}
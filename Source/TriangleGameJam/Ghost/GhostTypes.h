@@ -0,0 +1,172 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GhostTypes.generated.h"
+
+/**
+ *  Ability state flags recorded alongside the ghost pose
+ */
+UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EGhostAbilityFlags : uint8
+{
+	None			= 0 UMETA(Hidden),
+	Falling			= 1 << 0,
+	Dashing			= 1 << 1,
+	DoubleJumped	= 1 << 2,
+	WallJumped		= 1 << 3,
+	Mantled			= 1 << 4
+};
+ENUM_CLASS_FLAGS(EGhostAbilityFlags);
+
+/**
+ *  A single decoded ghost pose sample
+ */
+USTRUCT(BlueprintType)
+struct FGhostPose
+{
+	GENERATED_BODY()
+
+	/** World location of the recorded character */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Ghost")
+	FVector Location = FVector::ZeroVector;
+
+	/** World yaw of the recorded character, in degrees */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Ghost")
+	float Yaw = 0.0f;
+
+	/** Ability flags active at the time of the sample */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Ghost", meta = (Bitmask, BitmaskEnum = "/Script/TriangleGameJam.EGhostAbilityFlags"))
+	uint8 Flags = 0;
+
+	/** Returns true if the provided flag was set when this pose was recorded */
+	bool HasFlag(EGhostAbilityFlags Flag) const { return EnumHasAnyFlags(static_cast<EGhostAbilityFlags>(Flags), Flag); }
+};
+
+/**
+ *  Fixed size header at the start of every ghost stream.
+ *  Everything after the header is a sequence of variable length samples:
+ *  - a control byte (keyframe and flags-changed bits)
+ *  - keyframes store absolute quantized position and yaw
+ *  - every other sample stores the zigzag varint error against a linear prediction from the previous two samples
+ *  - the ability flags byte is only stored when it changes
+ */
+struct FGhostStreamHeader
+{
+	/** Magic identifier for ghost streams ('GHST') */
+	static constexpr uint32 StreamMagic = 0x54534847;
+
+	/** Current stream format version */
+	static constexpr uint16 StreamVersion = 1;
+
+	/** Serialized size of the header, in bytes */
+	static constexpr int32 SerializedSize = 24;
+
+	/** Number of samples recorded per second */
+	uint16 SampleRate = 30;
+
+	/** Number of samples between absolute keyframes */
+	uint16 KeyframeInterval = 60;
+
+	/** Size of a position quantization step, in cm */
+	float PositionQuantum = 1.0f;
+
+	/** Total number of samples in the stream */
+	uint32 SampleCount = 0;
+
+	/** Total encoded size of the sample data, in bytes */
+	uint32 DataSize = 0;
+
+	/** Returns the duration of the recording, in seconds */
+	float GetDuration() const { return SampleRate > 0 ? float(SampleCount) / float(SampleRate) : 0.0f; }
+};
+
+/**
+ *  Encodes ghost poses into a compact, quantized, delta-encoded byte stream
+ */
+class FGhostStreamWriter
+{
+public:
+
+	/** Constructor */
+	FGhostStreamWriter(uint16 InSampleRate = 30, float InPositionQuantum = 1.0f, uint16 InKeyframeInterval = 60);
+
+	/** Encodes a pose and appends it to the stream */
+	void AddSample(const FGhostPose& Pose);
+
+	/** Returns the complete stream, including the header */
+	TArray<uint8> Finalize() const;
+
+	/** Returns the number of samples written so far */
+	uint32 GetSampleCount() const { return Header.SampleCount; }
+
+	/** Returns the header describing this stream */
+	const FGhostStreamHeader& GetHeader() const { return Header; }
+
+private:
+
+	/** Stream header, updated as samples are added */
+	FGhostStreamHeader Header;
+
+	/** Encoded sample data */
+	TArray<uint8> Data;
+
+	/** Quantized position of the last two samples, for prediction */
+	FIntVector LastPosition = FIntVector::ZeroValue;
+	FIntVector PrevPosition = FIntVector::ZeroValue;
+
+	/** Quantized yaw of the last sample */
+	uint16 LastYaw = 0;
+
+	/** Flags of the last sample */
+	uint8 LastFlags = 0;
+};
+
+/**
+ *  Decodes ghost poses from a byte stream, usually backed by a memory mapped file.
+ *  The reader does not own the memory it decodes from.
+ */
+class FGhostStreamReader
+{
+public:
+
+	/** Binds the reader to a stream. Returns false if the stream is invalid */
+	bool Initialize(const uint8* InStreamData, int64 InStreamSize);
+
+	/** Decodes the next pose. Returns false at the end of the stream */
+	bool ReadNext(FGhostPose& OutPose);
+
+	/** Moves the read cursor back to the first sample */
+	void Rewind();
+
+	/** Returns true if the reader is bound to a valid stream */
+	bool IsValid() const { return SampleData != nullptr; }
+
+	/** Returns the header of the bound stream */
+	const FGhostStreamHeader& GetHeader() const { return Header; }
+
+	/** Returns the index of the next sample to be decoded */
+	uint32 GetNextSampleIndex() const { return NextSample; }
+
+private:
+
+	/** Stream header */
+	FGhostStreamHeader Header;
+
+	/** Start and size of the sample data */
+	const uint8* SampleData = nullptr;
+	int64 SampleDataSize = 0;
+
+	/** Read cursor into the sample data */
+	int64 Cursor = 0;
+
+	/** Index of the next sample to decode */
+	uint32 NextSample = 0;
+
+	/** Decoder state mirroring the writer's prediction state */
+	FIntVector LastPosition = FIntVector::ZeroValue;
+	FIntVector PrevPosition = FIntVector::ZeroValue;
+	uint16 LastYaw = 0;
+	uint8 LastFlags = 0;
+};
@@ -12,9 +12,14 @@ public class TriangleGameJam : ModuleRules
 			"Core",
 			"CoreUObject",
 			"Engine",
+			"NetCore",
+			"ReplicationGraph",
+			"Niagara",
 			"InputCore",
 			"EnhancedInput",
+			"AnimationBudgetAllocator",
 			"AIModule",
+			"NavigationSystem",
 			"StateTreeModule",
 			"GameplayStateTreeModule",
 			"UMG",
@@ -25,6 +30,7 @@ public class TriangleGameJam : ModuleRules
 
 		PublicIncludePaths.AddRange(new string[] {
 			"TriangleGameJam",
+			"TriangleGameJam/Ghost",
 			"TriangleGameJam/Variant_Platforming",
 			"TriangleGameJam/Variant_Platforming/Animation",
 			"TriangleGameJam/Variant_Combat",
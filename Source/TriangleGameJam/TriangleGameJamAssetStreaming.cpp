@@ -0,0 +1,36 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "TriangleGameJamAssetStreaming.h"
+#include "Engine/AssetManager.h"
+
+TSharedPtr<FStreamableHandle> TriangleGameJamAssetStreaming::RequestAssets(TConstArrayView<FSoftObjectPath> AssetPaths, FStreamableDelegate OnLoaded)
+{
+	TArray<FSoftObjectPath> PathsToLoad;
+
+	for (const FSoftObjectPath& AssetPath : AssetPaths)
+	{
+		if (!AssetPath.IsNull())
+		{
+			PathsToLoad.Add(AssetPath);
+		}
+	}
+
+	// nothing to wait for
+	if (PathsToLoad.Num() == 0)
+	{
+		OnLoaded.ExecuteIfBound();
+		return nullptr;
+	}
+
+	return UAssetManager::GetStreamableManager().RequestAsyncLoad(MoveTemp(PathsToLoad), MoveTemp(OnLoaded));
+}
+
+void TriangleGameJamAssetStreaming::ReleaseAssets(TSharedPtr<FStreamableHandle>& Handle)
+{
+	if (Handle.IsValid())
+	{
+		Handle->ReleaseHandle();
+		Handle.Reset();
+	}
+}
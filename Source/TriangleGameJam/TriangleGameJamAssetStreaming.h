@@ -0,0 +1,19 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+
+namespace TriangleGameJamAssetStreaming
+{
+	/**
+	 *  Starts streaming in a character's soft asset references through the asset manager, skipping unset ones.
+	 *  Keep the returned handle for as long as the assets should stay resident, and release it on EndPlay.
+	 *  OnLoaded runs once every asset is in memory, or right away if there's nothing to load.
+	 */
+	TSharedPtr<FStreamableHandle> RequestAssets(TConstArrayView<FSoftObjectPath> AssetPaths, FStreamableDelegate OnLoaded = FStreamableDelegate());
+
+	/** Releases a handle returned by RequestAssets so its assets can unload once nothing else uses them */
+	void ReleaseAssets(TSharedPtr<FStreamableHandle>& Handle);
+}
@@ -0,0 +1,261 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "TriangleGameJamReplicationGraph.h"
+#include "Engine/Engine.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/Pawn.h"
+#include "CombatEnemy.h"
+#include "CombatLavaFloor.h"
+#include "CombatDamageableBox.h"
+#include "SideScrollingPickup.h"
+#include "SideScrollingJumpPad.h"
+#include "SideScrollingSoftPlatform.h"
+#include "SideScrollingMovingPlatform.h"
+#include "TriangleGameJam.h"
+
+static FAutoConsoleCommandWithWorldAndArgs NetStatsCommand(
+	TEXT("Combat.Net.Stats"),
+	TEXT("Logs server replication time, outgoing bandwidth and combat enemy dormancy since the last call. Run on a listen or dedicated server with the replication graph enabled."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UTriangleGameJamReplicationGraph::DumpNetStats)
+);
+
+static FAutoConsoleCommandWithWorldAndArgs NetProfileCommand(
+	TEXT("Combat.Net.Profile"),
+	TEXT("Starts or stops a network profiler capture. Open the .nprof file from Saved/Profiling in the Network Profiler to see bytes and replication time per actor and per class."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UTriangleGameJamReplicationGraph::ToggleNetProfile)
+);
+
+void UTriangleGameJamReplicationGraph::NotifyNetUpdateFrequencyChanged(AActor* Actor)
+{
+	UNetDriver* NetDriver = Actor ? Actor->GetNetDriver() : nullptr;
+	UTriangleGameJamReplicationGraph* Graph = NetDriver ? NetDriver->GetReplicationDriver<UTriangleGameJamReplicationGraph>() : nullptr;
+
+	if (!Graph)
+	{
+		return;
+	}
+
+	// the graph replicates on its own period instead of reading the actor's frequency
+	if (FGlobalActorReplicationInfo* GlobalInfo = Graph->GlobalActorReplicationInfoMap.Find(Actor))
+	{
+		GlobalInfo->Settings.ReplicationPeriodFrame = Graph->GetReplicationPeriodFrameForFrequency(Actor->GetNetUpdateFrequency());
+	}
+}
+
+void UTriangleGameJamReplicationGraph::DumpNetStats(const TArray<FString>& Args, UWorld* World)
+{
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	UTriangleGameJamReplicationGraph* Graph = NetDriver ? NetDriver->GetReplicationDriver<UTriangleGameJamReplicationGraph>() : nullptr;
+
+	if (!Graph || !NetDriver->IsServer())
+	{
+		UE_LOG(LogTriangleGameJam, Warning, TEXT("Combat.Net.Stats must be run on a server using the replication graph"));
+		return;
+	}
+
+	// count the enemies that are still replicating
+	int32 NumEnemies = 0;
+	int32 NumDormant = 0;
+
+	for (TActorIterator<ACombatEnemy> It(World); It; ++It)
+	{
+		++NumEnemies;
+
+		if (It->NetDormancy > DORM_Awake)
+		{
+			++NumDormant;
+		}
+	}
+
+	// outgoing bandwidth over every client connection, for every actor.
+	// The per-enemy share comes from a Combat.Net.Profile capture instead of being averaged out of this
+	const int32 NumClients = NetDriver->ClientConnections.Num();
+	int64 OutBytesPerSecond = 0;
+
+	for (const UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection)
+		{
+			OutBytesPerSecond += Connection->OutBytesPerSecond;
+		}
+	}
+
+	const double ReplicationMs = Graph->ReplicationFrames > 0 ? Graph->ReplicationSeconds * 1000.0 / Graph->ReplicationFrames : 0.0;
+
+	UE_LOG(LogTriangleGameJam, Log, TEXT("Combat net: %d clients, %d enemies (%d dormant), %lld bytes/s out in total, %.3f ms/frame replicating over %d frames"),
+		NumClients, NumEnemies, NumDormant, OutBytesPerSecond, ReplicationMs, Graph->ReplicationFrames);
+
+	Graph->ReplicationSeconds = 0.0;
+	Graph->ReplicationFrames = 0;
+}
+
+void UTriangleGameJamReplicationGraph::ToggleNetProfile(const TArray<FString>& Args, UWorld* World)
+{
+	static bool bProfiling = false;
+
+	if (!GEngine)
+	{
+		return;
+	}
+
+	// the network profiler records the bits written for every replicated actor and property
+	bProfiling = !bProfiling;
+	GEngine->Exec(World, bProfiling ? TEXT("netprofile enable") : TEXT("netprofile disable"));
+
+	UE_LOG(LogTriangleGameJam, Log, TEXT("Combat net profile %s"), bProfiling ? TEXT("started") : TEXT("stopped, open the capture from Saved/Profiling in the Network Profiler"));
+}
+
+ETriangleGameJamClassRouting UTriangleGameJamReplicationGraph::GetRouting(const AActor* Actor)
+{
+	// per-instance relevancy flags take priority over the class routing
+	if (Actor->bAlwaysRelevant)
+	{
+		return ETriangleGameJamClassRouting::AlwaysRelevant;
+	}
+
+	if (Actor->bOnlyRelevantToOwner)
+	{
+		return ETriangleGameJamClassRouting::OwnerRelevant;
+	}
+
+	const UClass* ActorClass = Actor->GetClass();
+
+	if (const ETriangleGameJamClassRouting* Routing = ClassRouting.Get(ActorClass))
+	{
+		return *Routing;
+	}
+
+	// unknown classes are treated as possibly moving while awake, like the basic graph does
+	ClassRouting.Set(ActorClass, ETriangleGameJamClassRouting::Dormancy);
+
+	return ETriangleGameJamClassRouting::Dormancy;
+}
+
+void UTriangleGameJamReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// the graph debug actor is replicated by the graph itself
+	ClassRouting.Set(AReplicationGraphDebugActor::StaticClass(), ETriangleGameJamClassRouting::NotRouted);
+
+	// game state, player states and world settings
+	ClassRouting.Set(AInfo::StaticClass(), ETriangleGameJamClassRouting::AlwaysRelevant);
+
+	// player characters move every frame
+	ClassRouting.Set(APawn::StaticClass(), ETriangleGameJamClassRouting::Dynamic);
+	ClassRouting.Set(ASideScrollingMovingPlatform::StaticClass(), ETriangleGameJamClassRouting::Dynamic);
+
+	// enemies sleep, die and wait in the pool as dormant, so they only move cells while awake
+	ClassRouting.Set(ACombatEnemy::StaticClass(), ETriangleGameJamClassRouting::Dormancy);
+
+	// pickups and props sit still until something happens to them
+	ClassRouting.Set(ASideScrollingPickup::StaticClass(), ETriangleGameJamClassRouting::Dormancy);
+	ClassRouting.Set(ACombatDamageableBox::StaticClass(), ETriangleGameJamClassRouting::Dormancy);
+
+	// hazards never move
+	ClassRouting.Set(ACombatLavaFloor::StaticClass(), ETriangleGameJamClassRouting::Static);
+	ClassRouting.Set(ASideScrollingJumpPad::StaticClass(), ETriangleGameJamClassRouting::Static);
+	ClassRouting.Set(ASideScrollingSoftPlatform::StaticClass(), ETriangleGameJamClassRouting::Static);
+
+	// enemies only matter to players within fighting range
+	FClassReplicationInfo EnemyInfo = GlobalActorReplicationInfoMap.GetClassInfo(ACombatEnemy::StaticClass());
+	EnemyInfo.SetCullDistanceSquared(FMath::Square(EnemyCullDistance));
+
+	GlobalActorReplicationInfoMap.SetClassInfo(ACombatEnemy::StaticClass(), EnemyInfo);
+}
+
+void UTriangleGameJamReplicationGraph::InitGlobalGraphNodes()
+{
+	Super::InitGlobalGraphNodes();
+
+	// set the cell size before any actors are routed into the grid
+	GridNode->CellSize = GridCellSize;
+}
+
+void UTriangleGameJamReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetRouting(ActorInfo.GetActor()))
+	{
+	case ETriangleGameJamClassRouting::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	case ETriangleGameJamClassRouting::OwnerRelevant:
+		// moved to the owner's connection node once it has a connection
+		ActorsWithoutNetConnection.Add(ActorInfo.Actor);
+		break;
+
+	case ETriangleGameJamClassRouting::Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+
+	case ETriangleGameJamClassRouting::Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+
+	case ETriangleGameJamClassRouting::Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UTriangleGameJamReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	AActor* Actor = ActorInfo.GetActor();
+
+	switch (GetRouting(Actor))
+	{
+	case ETriangleGameJamClassRouting::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		SetActorDestructionInfoToIgnoreDistanceCulling(Actor);
+		break;
+
+	case ETriangleGameJamClassRouting::OwnerRelevant:
+		ActorsWithoutNetConnection.Remove(Actor);
+
+		if (UNetConnection* Connection = Actor->GetNetConnection())
+		{
+			if (UReplicationGraphNode_AlwaysRelevant_ForConnection* ConnectionNode = GetAlwaysRelevantNodeForConnection(Connection))
+			{
+				ConnectionNode->NotifyRemoveNetworkActor(ActorInfo);
+			}
+		}
+		break;
+
+	case ETriangleGameJamClassRouting::Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+
+	case ETriangleGameJamClassRouting::Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+
+	case ETriangleGameJamClassRouting::Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+int32 UTriangleGameJamReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	// time the replication pass itself, so other net driver work doesn't count towards it
+	const double StartTime = FPlatformTime::Seconds();
+
+	const int32 Result = Super::ServerReplicateActors(DeltaSeconds);
+
+	ReplicationSeconds += FPlatformTime::Seconds() - StartTime;
+	++ReplicationFrames;
+
+	return Result;
+}
@@ -0,0 +1,96 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BasicReplicationGraph.h"
+#include "TriangleGameJamReplicationGraph.generated.h"
+
+/**
+ *  How the replication graph routes the actors of a class
+ */
+enum class ETriangleGameJamClassRouting : uint8
+{
+	/** Not added to any node */
+	NotRouted,
+
+	/** Replicated to every connection, e.g. game and player state */
+	AlwaysRelevant,
+
+	/** Replicated only to the owning connection */
+	OwnerRelevant,
+
+	/** Spatialized once where it was placed, e.g. hazards that never move */
+	Static,
+
+	/** Spatialized as moving while awake and as static while dormant, e.g. pickups and enemies */
+	Dormancy,
+
+	/** Spatialized and re-bucketed every frame, e.g. player characters and moving platforms */
+	Dynamic
+};
+
+/**
+ *  Replication graph shared by all gameplay variants.
+ *  Game state goes through the always relevant node, while gameplay actors are bucketed into a spatial grid
+ *  so each connection only considers the actors in the cells around its viewers.
+ *  Hazards, pickups and enemies use the static and dormancy-aware grid paths so idle ones cost nothing to gather.
+ *  Enabled through ReplicationDriverClassName in DefaultEngine.ini.
+ *  Compare server replication time with and without it through Combat.Net.Stats while running many PIE clients in one process.
+ *  Per-actor bandwidth, e.g. bytes per combat enemy, comes from the network profiler capture started with Combat.Net.Profile.
+ */
+UCLASS(transient, config=Engine)
+class UTriangleGameJamReplicationGraph : public UBasicReplicationGraph
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Edge length of the spatial grid cells */
+	UPROPERTY(config)
+	float GridCellSize = 10000.0f;
+
+	/** Cull distance for combat enemies */
+	UPROPERTY(config)
+	float EnemyCullDistance = 15000.0f;
+
+	/** Routing for each class. Classes without an explicit entry fall back to their default object's relevancy flags */
+	TClassMap<ETriangleGameJamClassRouting> ClassRouting;
+
+	/** Time spent replicating and number of frames replicated, since the last stats dump */
+	double ReplicationSeconds = 0.0;
+	int32 ReplicationFrames = 0;
+
+public:
+
+	/** Applies an actor's current net update frequency to its replication period. Call after changing it at runtime */
+	static void NotifyNetUpdateFrequencyChanged(AActor* Actor);
+
+	/** Logs server replication time and enemy dormancy. Bound to the Combat.Net.Stats console command */
+	static void DumpNetStats(const TArray<FString>& Args, UWorld* World);
+
+	/** Starts or stops a per-actor network profiler capture. Bound to the Combat.Net.Profile console command */
+	static void ToggleNetProfile(const TArray<FString>& Args, UWorld* World);
+
+protected:
+
+	/** Returns how an actor should be routed */
+	ETriangleGameJamClassRouting GetRouting(const AActor* Actor);
+
+public:
+
+	/** Sets up the per-class routing and cull distances */
+	virtual void InitGlobalActorClassSettings() override;
+
+	/** Sets up the grid and always relevant nodes */
+	virtual void InitGlobalGraphNodes() override;
+
+	/** Adds an actor to the nodes for its class */
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+
+	/** Removes an actor from the nodes for its class */
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	/** Replicates to every connection, timing the whole pass */
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+};
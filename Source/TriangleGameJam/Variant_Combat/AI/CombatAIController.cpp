@@ -2,9 +2,13 @@
 
 
 #include "CombatAIController.h"
+#include "CombatPathFollowingComponent.h"
 #include "Components/StateTreeAIComponent.h"
+#include "NavigationData.h"
+#include "GameFramework/Pawn.h"
 
-ACombatAIController::ACombatAIController()
+ACombatAIController::ACombatAIController(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UCombatPathFollowingComponent>(TEXT("PathFollowingComponent")))
 {
 	// create the StateTree AI Component
 	StateTreeAI = CreateDefaultSubobject<UStateTreeAIComponent>(TEXT("StateTreeAI"));
@@ -17,3 +21,19 @@ ACombatAIController::ACombatAIController()
 	// this is necessary for EnvQueries to work correctly
 	bAttachToPawn = true;
 }
+
+void ACombatAIController::FindPathForMoveRequest(const FAIMoveRequest& MoveRequest, FPathFindingQuery& Query, FNavPathSharedPtr& OutPath) const
+{
+	const APawn* MyPawn = GetPawn();
+	const AActor* Goal = MoveRequest.IsMoveToActorRequest() ? MoveRequest.GetGoalActor() : nullptr;
+
+	// chasing a player covered by the flow field doesn't need a path query.
+	// The path only holds the start and goal, since the path following component steers along the field
+	if (MyPawn && Goal && UCombatPathFollowingComponent::CanFollowFlowField(GetWorld(), Goal, MyPawn->GetNavAgentLocation()))
+	{
+		OutPath = MakeShared<FNavigationPath, ESPMode::ThreadSafe>(TArray<FVector>{ MyPawn->GetNavAgentLocation(), Goal->GetActorLocation() });
+		return;
+	}
+
+	Super::FindPathForMoveRequest(MoveRequest, Query, OutPath);
+}
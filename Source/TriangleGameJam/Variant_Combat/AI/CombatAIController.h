@@ -9,7 +9,9 @@
 class UStateTreeAIComponent;
 
 /**
- *	A basic AI Controller capable of running StateTree
+ *	A basic AI Controller capable of running StateTree.
+ *	Moves towards players covered by the combat flow field skip the path query and are steered along the field
+ *	by the path following component instead.
  */
 UCLASS(abstract)
 class ACombatAIController : public AAIController
@@ -23,5 +25,10 @@ class ACombatAIController : public AAIController
 public:
 
 	/** Constructor */
-	ACombatAIController();
+	ACombatAIController(const FObjectInitializer& ObjectInitializer);
+
+protected:
+
+	/** Uses a direct path for moves the flow field can steer, and a regular path query otherwise */
+	virtual void FindPathForMoveRequest(const FAIMoveRequest& MoveRequest, FPathFindingQuery& Query, FNavPathSharedPtr& OutPath) const override;
 };
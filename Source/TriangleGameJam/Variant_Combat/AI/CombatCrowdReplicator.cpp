@@ -0,0 +1,141 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatCrowdReplicator.h"
+#include "CombatCrowdSubsystem.h"
+#include "CombatEnemy.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+static TAutoConsoleVariable<float> CVarCrowdNetMinMove(
+	TEXT("Combat.Crowd.NetMinMove"),
+	25.0f,
+	TEXT("Crowd entities are only sent to clients again once they've moved further than this."),
+	ECVF_Default
+);
+
+void FCombatCrowdNetEntities::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	if (Owner)
+	{
+		Owner->NotifyEntitiesReceived();
+	}
+}
+
+ACombatCrowdReplicator::ACombatCrowdReplicator()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	bReplicates = true;
+	bAlwaysRelevant = true;
+
+	// crowd entities are far from every player, so a few updates a second are enough
+	SetNetUpdateFrequency(5.0f);
+}
+
+void ACombatCrowdReplicator::SetEntities(const TArray<TSubclassOf<ACombatEnemy>>& InArchetypeClasses, TConstArrayView<FVector> Positions, TConstArrayView<float> Yaws, TConstArrayView<int32> ArchetypeIndices)
+{
+	if (ArchetypeClasses != InArchetypeClasses)
+	{
+		ArchetypeClasses = InArchetypeClasses;
+		MARK_PROPERTY_DIRTY_FROM_NAME(ACombatCrowdReplicator, ArchetypeClasses, this);
+	}
+
+	const float MinMoveSquared = FMath::Square(CVarCrowdNetMinMove.GetValueOnGameThread());
+	bool bChanged = false;
+
+	// entities are removed by swapping, so just match them up by index
+	if (Entities.Items.Num() != Positions.Num())
+	{
+		Entities.Items.SetNum(Positions.Num());
+		Entities.MarkArrayDirty();
+		bChanged = true;
+	}
+
+	for (int32 EntityIndex = 0; EntityIndex < Positions.Num(); ++EntityIndex)
+	{
+		FCombatCrowdNetEntity& Item = Entities.Items[EntityIndex];
+
+		const uint8 Yaw = FRotator::CompressAxisToByte(Yaws[EntityIndex]);
+		const uint8 ArchetypeIndex = static_cast<uint8>(ArchetypeIndices[EntityIndex]);
+
+		// skip entities that haven't visibly changed
+		if (Item.ReplicationID != INDEX_NONE && Item.Yaw == Yaw && Item.ArchetypeIndex == ArchetypeIndex && FVector::DistSquared(Item.Position, Positions[EntityIndex]) < MinMoveSquared)
+		{
+			continue;
+		}
+
+		Item.Position = Positions[EntityIndex];
+		Item.Yaw = Yaw;
+		Item.ArchetypeIndex = ArchetypeIndex;
+
+		Entities.MarkItemDirty(Item);
+		bChanged = true;
+	}
+
+	if (bChanged)
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(ACombatCrowdReplicator, Entities, this);
+	}
+}
+
+bool ACombatCrowdReplicator::ConsumeEntitiesChanged()
+{
+	const bool bChanged = bEntitiesChanged;
+	bEntitiesChanged = false;
+
+	return bChanged;
+}
+
+void ACombatCrowdReplicator::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	Entities.Owner = this;
+}
+
+void ACombatCrowdReplicator::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// the server's crowd subsystem already knows about us
+	if (HasAuthority())
+	{
+		return;
+	}
+
+	if (UCombatCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UCombatCrowdSubsystem>())
+	{
+		Crowd->SetReplicator(this);
+	}
+
+	// draw whatever arrived with the initial bunch
+	bEntitiesChanged = true;
+}
+
+void ACombatCrowdReplicator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	if (!HasAuthority())
+	{
+		if (UCombatCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UCombatCrowdSubsystem>())
+		{
+			Crowd->SetReplicator(nullptr);
+		}
+	}
+}
+
+void ACombatCrowdReplicator::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// only compared when the crowd subsystem marks them dirty
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACombatCrowdReplicator, ArchetypeClasses, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACombatCrowdReplicator, Entities, Params);
+}
@@ -0,0 +1,126 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "CombatCrowdReplicator.generated.h"
+
+class ACombatEnemy;
+class ACombatCrowdReplicator;
+
+/**
+ *  Quantized state of one crowd entity, as seen by clients
+ */
+USTRUCT()
+struct FCombatCrowdNetEntity : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	/** Entity location, rounded to the centimeter */
+	UPROPERTY()
+	FVector_NetQuantize Position;
+
+	/** Entity yaw, compressed to a byte */
+	UPROPERTY()
+	uint8 Yaw = 0;
+
+	/** Index of the entity's class in the replicator's archetype classes */
+	UPROPERTY()
+	uint8 ArchetypeIndex = 0;
+};
+
+/**
+ *  Delta replicated list of crowd entities
+ */
+USTRUCT()
+struct FCombatCrowdNetEntities : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	/** Entities, in the same order as the server's crowd */
+	UPROPERTY()
+	TArray<FCombatCrowdNetEntity> Items;
+
+	/** Replicator owning the list, told when a replication update has been received */
+	ACombatCrowdReplicator* Owner = nullptr;
+
+	/** Marks the owner's renderers for update */
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+
+	/** Delta serialization */
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FCombatCrowdNetEntity, FCombatCrowdNetEntities>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FCombatCrowdNetEntities> : public TStructOpsTypeTraitsBase2<FCombatCrowdNetEntities>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ *  Replicates the combat crowd's entities to clients, so they can draw the crowd the server simulates.
+ *  Spawned by the crowd subsystem on servers. Clients only render the entities; rehydrated enemies replicate as regular actors.
+ *  Entities are quantized and only sent when they've moved noticeably, at a low update rate, since they're all far from the players.
+ */
+UCLASS(NotPlaceable, Transient)
+class ACombatCrowdReplicator : public AInfo
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Enemy classes of the crowd, indexed by the entities' archetype index */
+	UPROPERTY(Replicated)
+	TArray<TSubclassOf<ACombatEnemy>> ArchetypeClasses;
+
+	/** Crowd entities */
+	UPROPERTY(Replicated)
+	FCombatCrowdNetEntities Entities;
+
+	/** If true, entities changed since the client's renderers were last updated */
+	bool bEntitiesChanged = false;
+
+public:
+
+	/** Constructor */
+	ACombatCrowdReplicator();
+
+	/** Copies the server's crowd state, only dirtying entities that changed enough to be noticed */
+	void SetEntities(const TArray<TSubclassOf<ACombatEnemy>>& InArchetypeClasses, TConstArrayView<FVector> Positions, TConstArrayView<float> Yaws, TConstArrayView<int32> ArchetypeIndices);
+
+	/** Returns the replicated archetype classes */
+	const TArray<TSubclassOf<ACombatEnemy>>& GetArchetypeClasses() const { return ArchetypeClasses; }
+
+	/** Returns the replicated entities */
+	const TArray<FCombatCrowdNetEntity>& GetEntities() const { return Entities.Items; }
+
+	/** Returns true if the entities changed since the last call, and clears the flag */
+	bool ConsumeEntitiesChanged();
+
+	/** Flags the entities as changed. Called when a replication update is received */
+	void NotifyEntitiesReceived() { bEntitiesChanged = true; }
+
+protected:
+
+	/** Sets up the entity list's owner */
+	virtual void PostInitializeComponents() override;
+
+	/** Hands ourselves to the client's crowd subsystem */
+	virtual void BeginPlay() override;
+
+	/** Leaves the client's crowd subsystem */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+
+	/** Sets up replication */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+};
@@ -0,0 +1,609 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatCrowdSubsystem.h"
+#include "CombatCrowdReplicator.h"
+#include "CombatEnemyPool.h"
+#include "CombatTargetCache.h"
+#include "CombatFlowFieldSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "NavigationSystem.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<float> CVarCrowdRehydrateRadius(
+	TEXT("Combat.Crowd.RehydrateRadius"),
+	3000.0f,
+	TEXT("Crowd entities closer than this to a player are turned into full enemy actors."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarCrowdDehydrateRadius(
+	TEXT("Combat.Crowd.DehydrateRadius"),
+	4000.0f,
+	TEXT("Idle crowd actors further than this from every player are turned back into entities. Should be larger than the rehydrate radius."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarCrowdAggroRadius(
+	TEXT("Combat.Crowd.AggroRadius"),
+	10000.0f,
+	TEXT("Crowd entities closer than this to a player move towards it."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarCrowdMaxActors(
+	TEXT("Combat.Crowd.MaxActors"),
+	40,
+	TEXT("Maximum number of full enemy actors owned by the crowd."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarCrowdMaxRehydrationsPerFrame(
+	TEXT("Combat.Crowd.MaxRehydrationsPerFrame"),
+	2,
+	TEXT("Maximum number of crowd entities turned into full actors each frame."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarCrowdGroundingsPerFrame(
+	TEXT("Combat.Crowd.GroundingsPerFrame"),
+	32,
+	TEXT("Maximum number of crowd entities outside the flow field projected onto the nav mesh each frame."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarCrowdNetUpdateInterval(
+	TEXT("Combat.Crowd.NetUpdateInterval"),
+	0.2f,
+	TEXT("Seconds between copies of the crowd entities to the replicator sent to clients."),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorldAndArgs CrowdStatsCommand(
+	TEXT("Combat.Crowd.Stats"),
+	TEXT("Logs the number of crowd entities and full actors."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UCombatCrowdSubsystem::DumpStats)
+);
+
+void UCombatCrowdSubsystem::AddEnemy(TSubclassOf<ACombatEnemy> EnemyClass, const FTransform& Transform, FName SquadName, const FOnEnemyDied& OnDied)
+{
+	// the crowd is simulated on the server, which spawns the rehydrated enemies for everyone
+	if (GetWorld()->IsNetMode(NM_Client))
+	{
+		return;
+	}
+
+	const int32 ArchetypeIndex = FindOrAddArchetype(EnemyClass);
+
+	if (ArchetypeIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	Positions.Add(Transform.GetLocation());
+	Yaws.Add(Transform.Rotator().Yaw);
+	HP.Add(Archetypes[ArchetypeIndex].MaxHP);
+	ArchetypeIndices.Add(ArchetypeIndex);
+	SquadNames.Add(SquadName);
+	DeathListeners.Add(OnDied);
+	NeedsGrounding.Add(false);
+	NearestTargetDistancesSquared.Add(UE_BIG_NUMBER);
+}
+
+void UCombatCrowdSubsystem::DumpStats(const TArray<FString>& Args, UWorld* World)
+{
+	const UCombatCrowdSubsystem* Crowd = World ? World->GetSubsystem<UCombatCrowdSubsystem>() : nullptr;
+
+	if (!Crowd)
+	{
+		return;
+	}
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Crowd: %d entities, %d actors"), Crowd->GetNumEntities(), Crowd->GetNumActors());
+}
+
+void UCombatCrowdSubsystem::SetReplicator(ACombatCrowdReplicator* InReplicator)
+{
+	Replicator = InReplicator;
+
+	// clear the entities drawn for the previous replicator
+	if (!Replicator)
+	{
+		for (FCombatCrowdArchetype& Archetype : Archetypes)
+		{
+			Archetype.InstanceTransforms.Reset();
+		}
+
+		UploadInstances();
+	}
+}
+
+int32 UCombatCrowdSubsystem::FindOrAddArchetype(TSubclassOf<ACombatEnemy> EnemyClass)
+{
+	if (!IsValid(EnemyClass))
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 ExistingIndex = Archetypes.IndexOfByPredicate([EnemyClass](const FCombatCrowdArchetype& Archetype) { return Archetype.EnemyClass == EnemyClass; });
+
+	if (ExistingIndex != INDEX_NONE)
+	{
+		return ExistingIndex;
+	}
+
+	const ACombatEnemy* EnemyCDO = EnemyClass->GetDefaultObject<ACombatEnemy>();
+
+	// create the actor holding the renderers on first use
+	if (!RendererHost)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+
+		RendererHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+		RendererHost->SetRootComponent(NewObject<USceneComponent>(RendererHost, TEXT("Root")));
+		RendererHost->GetRootComponent()->RegisterComponent();
+	}
+
+	FCombatCrowdArchetype& Archetype = Archetypes.AddDefaulted_GetRef();
+	Archetype.EnemyClass = EnemyClass;
+	Archetype.MoveSpeed = EnemyCDO->GetCrowdMoveSpeed();
+	Archetype.HalfHeight = EnemyCDO->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	Archetype.MaxHP = EnemyCDO->GetMaxHP();
+
+	// draw the proxy where the skeletal mesh would be
+	Archetype.MeshTransform = EnemyCDO->GetMesh()->GetRelativeTransform();
+
+	// create the instanced renderer for this class
+	UInstancedStaticMeshComponent* Renderer = NewObject<UInstancedStaticMeshComponent>(RendererHost);
+	Renderer->SetStaticMesh(EnemyCDO->GetCrowdProxyMesh());
+	Renderer->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Renderer->SetCanEverAffectNavigation(false);
+	Renderer->SetupAttachment(RendererHost->GetRootComponent());
+	Renderer->RegisterComponent();
+
+	RendererHost->AddInstanceComponent(Renderer);
+
+	Archetype.Renderer = Renderer;
+
+	return Archetypes.Num() - 1;
+}
+
+void UCombatCrowdSubsystem::RemoveEntity(int32 EntityIndex)
+{
+	Positions.RemoveAtSwap(EntityIndex, EAllowShrinking::No);
+	Yaws.RemoveAtSwap(EntityIndex, EAllowShrinking::No);
+	HP.RemoveAtSwap(EntityIndex, EAllowShrinking::No);
+	ArchetypeIndices.RemoveAtSwap(EntityIndex, EAllowShrinking::No);
+	SquadNames.RemoveAtSwap(EntityIndex, EAllowShrinking::No);
+	DeathListeners.RemoveAtSwap(EntityIndex, EAllowShrinking::No);
+	NeedsGrounding.RemoveAtSwap(EntityIndex, EAllowShrinking::No);
+	NearestTargetDistancesSquared.RemoveAtSwap(EntityIndex, EAllowShrinking::No);
+}
+
+void UCombatCrowdSubsystem::MoveEntities(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatCrowdSubsystem::MoveEntities);
+
+	UCombatTargetCache* TargetCache = GetWorld()->GetSubsystem<UCombatTargetCache>();
+	check(TargetCache);
+
+	const TArray<FVector>& TargetLocations = TargetCache->GetTargetLocations();
+	const float AggroRadiusSquared = FMath::Square(CVarCrowdAggroRadius.GetValueOnGameThread());
+	const float StopRadius = CVarCrowdRehydrateRadius.GetValueOnGameThread() * 0.5f;
+
+	// the flow field is only read here, so it's safe to sample from the worker threads
+	const UCombatFlowFieldSubsystem* FlowField = GetWorld()->GetSubsystem<UCombatFlowFieldSubsystem>();
+	const bool bUseFlowField = FlowField && UCombatFlowFieldSubsystem::IsFlowFieldEnabled();
+
+	// each iteration only touches its own entity's fragments
+	ParallelFor(TEXT("CombatCrowdMove"), Positions.Num(), 64,
+		[&](int32 EntityIndex)
+		{
+			FVector& Position = Positions[EntityIndex];
+
+			// find the nearest player
+			FVector NearestTarget = FVector::ZeroVector;
+			float NearestDistanceSquared = UE_BIG_NUMBER;
+
+			for (const FVector& TargetLocation : TargetLocations)
+			{
+				const float DistanceSquared = FVector::DistSquared2D(Position, TargetLocation);
+
+				if (DistanceSquared < NearestDistanceSquared)
+				{
+					NearestDistanceSquared = DistanceSquared;
+					NearestTarget = TargetLocation;
+				}
+			}
+
+			NearestTargetDistancesSquared[EntityIndex] = NearestDistanceSquared;
+
+			// simplified movement: follow the flow field if it covers us, or walk straight towards the player on the horizontal plane
+			if (NearestDistanceSquared < AggroRadiusSquared)
+			{
+				FVector ToTarget;
+				float FlowDistance;
+
+				if (!bUseFlowField || !FlowField->SampleDirection(Position, ToTarget, FlowDistance))
+				{
+					ToTarget = (NearestTarget - Position).GetSafeNormal2D();
+				}
+
+				const FCombatCrowdArchetype& Archetype = Archetypes[ArchetypeIndices[EntityIndex]];
+				const float Distance = FMath::Sqrt(NearestDistanceSquared);
+				const float Step = FMath::Min(Archetype.MoveSpeed * DeltaTime, FMath::Max(0.0f, Distance - StopRadius));
+
+				if (Step <= 0.0f)
+				{
+					return;
+				}
+
+				Position += ToTarget * Step;
+				Yaws[EntityIndex] = ToTarget.Rotation().Yaw;
+
+				// follow the ground from the flow field's nav heights, or queue a nav mesh projection off the grid
+				float GroundHeight;
+
+				if (FlowField && FlowField->SampleHeight(Position, GroundHeight))
+				{
+					Position.Z = GroundHeight + Archetype.HalfHeight;
+					NeedsGrounding[EntityIndex] = false;
+				}
+				else
+				{
+					NeedsGrounding[EntityIndex] = true;
+				}
+			}
+		});
+}
+
+void UCombatCrowdSubsystem::GroundEntities()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatCrowdSubsystem::GroundEntities);
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	if (!NavSys || Positions.Num() == 0)
+	{
+		return;
+	}
+
+	int32 GroundingsLeft = CVarCrowdGroundingsPerFrame.GetValueOnGameThread();
+
+	// visit every entity at most once per frame, carrying on from where the last frame stopped
+	for (int32 Visited = 0; Visited < Positions.Num() && GroundingsLeft > 0; ++Visited)
+	{
+		const int32 EntityIndex = NextGroundingIndex++ % Positions.Num();
+
+		if (!NeedsGrounding[EntityIndex])
+		{
+			continue;
+		}
+
+		--GroundingsLeft;
+		NeedsGrounding[EntityIndex] = false;
+
+		// look for the nav mesh within a capsule height above or below the feet
+		const float HalfHeight = Archetypes[ArchetypeIndices[EntityIndex]].HalfHeight;
+		const FVector Feet = Positions[EntityIndex] - FVector(0.0f, 0.0f, HalfHeight);
+
+		FNavLocation NavLocation;
+
+		if (NavSys->ProjectPointToNavigation(Feet, NavLocation, FVector(50.0f, 50.0f, HalfHeight * 2.0f)))
+		{
+			Positions[EntityIndex].Z = NavLocation.Location.Z + HalfHeight;
+		}
+	}
+
+	NextGroundingIndex %= Positions.Num();
+}
+
+void UCombatCrowdSubsystem::RehydrateEntities()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatCrowdSubsystem::RehydrateEntities);
+
+	const int32 MaxRehydrations = FMath::Min(CVarCrowdMaxRehydrationsPerFrame.GetValueOnGameThread(), CVarCrowdMaxActors.GetValueOnGameThread() - CrowdActors.Num());
+
+	if (MaxRehydrations <= 0)
+	{
+		return;
+	}
+
+	const float RehydrateRadiusSquared = FMath::Square(CVarCrowdRehydrateRadius.GetValueOnGameThread());
+
+	// find the closest entities in range
+	TArray<int32, TInlineAllocator<64>> Candidates;
+
+	for (int32 EntityIndex = 0; EntityIndex < Positions.Num(); ++EntityIndex)
+	{
+		if (NearestTargetDistancesSquared[EntityIndex] < RehydrateRadiusSquared)
+		{
+			Candidates.Add(EntityIndex);
+		}
+	}
+
+	if (Candidates.Num() > MaxRehydrations)
+	{
+		Candidates.Sort([this](int32 A, int32 B) { return NearestTargetDistancesSquared[A] < NearestTargetDistancesSquared[B]; });
+		Candidates.SetNum(MaxRehydrations);
+	}
+
+	// remove from the back so swapped entities don't invalidate the remaining indices
+	Candidates.Sort(TGreater<int32>());
+
+	UCombatEnemyPool* EnemyPool = GetWorld()->GetSubsystem<UCombatEnemyPool>();
+	check(EnemyPool);
+
+	for (int32 EntityIndex : Candidates)
+	{
+		const int32 ArchetypeIndex = ArchetypeIndices[EntityIndex];
+		const FTransform SpawnTransform(FRotator(0.0f, Yaws[EntityIndex], 0.0f), Positions[EntityIndex]);
+
+		ACombatEnemy* Enemy = EnemyPool->Acquire(Archetypes[ArchetypeIndex].EnemyClass, SpawnTransform);
+
+		if (!Enemy)
+		{
+			continue;
+		}
+
+		// carry the entity's state over to the actor
+		Enemy->RestoreHP(HP[EntityIndex]);
+		Enemy->SetSquadName(SquadNames[EntityIndex]);
+		Enemy->OnEnemyDied = DeathListeners[EntityIndex];
+
+		FCombatCrowdActor& CrowdActor = CrowdActors.AddDefaulted_GetRef();
+		CrowdActor.Enemy = Enemy;
+		CrowdActor.ArchetypeIndex = ArchetypeIndex;
+
+		RemoveEntity(EntityIndex);
+	}
+}
+
+void UCombatCrowdSubsystem::DehydrateActors()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatCrowdSubsystem::DehydrateActors);
+
+	UCombatTargetCache* TargetCache = GetWorld()->GetSubsystem<UCombatTargetCache>();
+	check(TargetCache);
+
+	UCombatEnemyPool* EnemyPool = GetWorld()->GetSubsystem<UCombatEnemyPool>();
+	check(EnemyPool);
+
+	const float DehydrateRadiusSquared = FMath::Square(CVarCrowdDehydrateRadius.GetValueOnGameThread());
+
+	for (int32 ActorIndex = CrowdActors.Num() - 1; ActorIndex >= 0; --ActorIndex)
+	{
+		const FCombatCrowdActor& CrowdActor = CrowdActors[ActorIndex];
+		ACombatEnemy* Enemy = CrowdActor.Enemy.Get();
+
+		// forget actors that died and went back to the pool, or were destroyed
+		if (!IsValid(Enemy) || Enemy->IsInactiveInPool() || Enemy->CurrentHP <= 0.0f)
+		{
+			CrowdActors.RemoveAtSwap(ActorIndex, EAllowShrinking::No);
+			continue;
+		}
+
+		// only dehydrate idle enemies standing on the ground
+		if (Enemy->IsEngagedInCombat() || !Enemy->GetCharacterMovement()->IsMovingOnGround())
+		{
+			continue;
+		}
+
+		FCombatTargetInfo Target;
+
+		if (TargetCache->FindNearestTarget(Enemy->GetActorLocation(), Target) && Target.DistanceSquared < DehydrateRadiusSquared)
+		{
+			continue;
+		}
+
+		// turn the actor back into an entity
+		const int32 ArchetypeIndex = CrowdActor.ArchetypeIndex;
+		const FOnEnemyDied OnDied = Enemy->OnEnemyDied;
+
+		AddEnemy(Archetypes[ArchetypeIndex].EnemyClass, Enemy->GetActorTransform(), Enemy->GetSquadName(), OnDied);
+		HP.Last() = Enemy->CurrentHP;
+
+		CrowdActors.RemoveAtSwap(ActorIndex, EAllowShrinking::No);
+
+		if (!EnemyPool->Release(Enemy))
+		{
+			Enemy->Destroy();
+		}
+	}
+}
+
+void UCombatCrowdSubsystem::UpdateRenderers()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatCrowdSubsystem::UpdateRenderers);
+
+	for (FCombatCrowdArchetype& Archetype : Archetypes)
+	{
+		Archetype.InstanceTransforms.Reset();
+	}
+
+	// gather the instance transforms per class
+	for (int32 EntityIndex = 0; EntityIndex < Positions.Num(); ++EntityIndex)
+	{
+		FCombatCrowdArchetype& Archetype = Archetypes[ArchetypeIndices[EntityIndex]];
+
+		const FTransform EntityTransform(FRotator(0.0f, Yaws[EntityIndex], 0.0f), Positions[EntityIndex]);
+		Archetype.InstanceTransforms.Add(Archetype.MeshTransform * EntityTransform);
+	}
+
+	UploadInstances();
+}
+
+void UCombatCrowdSubsystem::UpdateReplicator(float DeltaTime)
+{
+	// nobody to send the crowd to
+	if (GetWorld()->GetNetMode() == NM_Standalone)
+	{
+		return;
+	}
+
+	ReplicatorUpdateTimeLeft -= DeltaTime;
+
+	if (ReplicatorUpdateTimeLeft > 0.0f)
+	{
+		return;
+	}
+
+	ReplicatorUpdateTimeLeft = CVarCrowdNetUpdateInterval.GetValueOnGameThread();
+
+	// spawn the replicator once there's something to send
+	if (!Replicator)
+	{
+		if (Positions.Num() == 0)
+		{
+			return;
+		}
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+
+		Replicator = GetWorld()->SpawnActor<ACombatCrowdReplicator>(ACombatCrowdReplicator::StaticClass(), FTransform::Identity, SpawnParams);
+
+		if (!Replicator)
+		{
+			return;
+		}
+	}
+
+	TArray<TSubclassOf<ACombatEnemy>> ArchetypeClasses;
+	ArchetypeClasses.Reserve(Archetypes.Num());
+
+	for (const FCombatCrowdArchetype& Archetype : Archetypes)
+	{
+		ArchetypeClasses.Add(Archetype.EnemyClass);
+	}
+
+	Replicator->SetEntities(ArchetypeClasses, Positions, Yaws, ArchetypeIndices);
+}
+
+void UCombatCrowdSubsystem::UpdateRemoteRenderers()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatCrowdSubsystem::UpdateRemoteRenderers);
+
+	// only redraw when the server sent new entities
+	if (!Replicator || !Replicator->ConsumeEntitiesChanged())
+	{
+		return;
+	}
+
+	// map the server's archetypes to ours
+	TArray<int32, TInlineAllocator<8>> LocalArchetypeIndices;
+
+	for (const TSubclassOf<ACombatEnemy>& EnemyClass : Replicator->GetArchetypeClasses())
+	{
+		LocalArchetypeIndices.Add(FindOrAddArchetype(EnemyClass));
+	}
+
+	for (FCombatCrowdArchetype& Archetype : Archetypes)
+	{
+		Archetype.InstanceTransforms.Reset();
+	}
+
+	// gather the instance transforms per class
+	for (const FCombatCrowdNetEntity& Entity : Replicator->GetEntities())
+	{
+		if (!LocalArchetypeIndices.IsValidIndex(Entity.ArchetypeIndex) || LocalArchetypeIndices[Entity.ArchetypeIndex] == INDEX_NONE)
+		{
+			continue;
+		}
+
+		FCombatCrowdArchetype& Archetype = Archetypes[LocalArchetypeIndices[Entity.ArchetypeIndex]];
+
+		const FTransform EntityTransform(FRotator(0.0f, FRotator::DecompressAxisFromByte(Entity.Yaw), 0.0f), Entity.Position);
+		Archetype.InstanceTransforms.Add(Archetype.MeshTransform * EntityTransform);
+	}
+
+	UploadInstances();
+}
+
+void UCombatCrowdSubsystem::UploadInstances()
+{
+	for (FCombatCrowdArchetype& Archetype : Archetypes)
+	{
+		UInstancedStaticMeshComponent* Renderer = Archetype.Renderer;
+
+		if (!Renderer)
+		{
+			continue;
+		}
+
+		// rebuild the instances if the count changed, otherwise just move them
+		if (Renderer->GetInstanceCount() != Archetype.InstanceTransforms.Num())
+		{
+			Renderer->ClearInstances();
+			Renderer->AddInstances(Archetype.InstanceTransforms, false, true, false);
+		}
+		else if (Archetype.InstanceTransforms.Num() > 0)
+		{
+			Renderer->BatchUpdateInstancesTransforms(0, Archetype.InstanceTransforms, true, true, false);
+		}
+	}
+}
+
+bool UCombatCrowdSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatCrowdSubsystem::Deinitialize()
+{
+	if (IsValid(RendererHost))
+	{
+		RendererHost->Destroy();
+	}
+
+	RendererHost = nullptr;
+	Archetypes.Reset();
+
+	// the server owns the replicator, clients just let go of it
+	if (IsValid(Replicator) && Replicator->HasAuthority())
+	{
+		Replicator->Destroy();
+	}
+
+	Replicator = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UCombatCrowdSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// clients only draw what the server sends
+	if (GetWorld()->IsNetMode(NM_Client))
+	{
+		UpdateRemoteRenderers();
+		return;
+	}
+
+	// keep the replicator in sync even after the crowd empties, so clients stop drawing it
+	UpdateReplicator(DeltaTime);
+
+	if (Positions.Num() == 0 && CrowdActors.Num() == 0)
+	{
+		return;
+	}
+
+	MoveEntities(DeltaTime);
+	GroundEntities();
+	RehydrateEntities();
+	DehydrateActors();
+	UpdateRenderers();
+}
+
+TStatId UCombatCrowdSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatCrowdSubsystem, STATGROUP_Tickables);
+}
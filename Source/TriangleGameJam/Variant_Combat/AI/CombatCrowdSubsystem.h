@@ -0,0 +1,167 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatEnemy.h"
+#include "CombatCrowdSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+class ACombatCrowdReplicator;
+
+/**
+ *  Shared data and renderer for all crowd entities of one enemy class
+ */
+USTRUCT()
+struct FCombatCrowdArchetype
+{
+	GENERATED_BODY()
+
+	/** Enemy class entities are rehydrated into */
+	UPROPERTY()
+	TSubclassOf<ACombatEnemy> EnemyClass;
+
+	/** Instanced renderer for the class's proxy mesh */
+	UPROPERTY()
+	TObjectPtr<UInstancedStaticMeshComponent> Renderer;
+
+	/** Proxy mesh transform relative to the entity, copied from the enemy's skeletal mesh */
+	FTransform MeshTransform;
+
+	/** Simplified movement speed */
+	float MoveSpeed = 0.0f;
+
+	/** Height of the entity location above the ground, from the enemy's capsule */
+	float HalfHeight = 0.0f;
+
+	/** Max HP of the enemy class */
+	float MaxHP = 0.0f;
+
+	/** Instance transforms for this frame */
+	TArray<FTransform> InstanceTransforms;
+};
+
+/**
+ *  A full enemy actor owned by the crowd, which can be dehydrated back into an entity
+ */
+struct FCombatCrowdActor
+{
+	TWeakObjectPtr<ACombatEnemy> Enemy;
+	int32 ArchetypeIndex = INDEX_NONE;
+};
+
+/**
+ *  Keeps distant combat enemies as lightweight entities in packed arrays instead of full actors.
+ *  Entities chase the nearest player with simplified movement that follows the nav mesh height,
+ *  and are drawn through one instanced mesh per enemy class.
+ *  Entities that come within the rehydration radius are swapped for pooled ACombatEnemy actors,
+ *  and idle actors beyond the dehydration radius are turned back into entities.
+ *  The crowd is simulated on the server. In multiplayer, its entities are sent to clients through a replicator actor,
+ *  which clients only draw.
+ */
+UCLASS()
+class UCombatCrowdSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Enemy classes used by the crowd */
+	UPROPERTY()
+	TArray<FCombatCrowdArchetype> Archetypes;
+
+	/** Actor holding the instanced renderers */
+	UPROPERTY()
+	TObjectPtr<AActor> RendererHost;
+
+	/** Actor replicating the entities. Spawned by the server in multiplayer, received by clients */
+	UPROPERTY()
+	TObjectPtr<ACombatCrowdReplicator> Replicator;
+
+	/** Time left until the entities are copied to the replicator again */
+	float ReplicatorUpdateTimeLeft = 0.0f;
+
+	/** Entity fragments, one element per entity */
+	TArray<FVector> Positions;
+	TArray<float> Yaws;
+	TArray<float> HP;
+	TArray<int32> ArchetypeIndices;
+	TArray<FName> SquadNames;
+	TArray<FOnEnemyDied> DeathListeners;
+
+	/** If true, the entity moved off the flow field this frame and its height must be projected onto the nav mesh */
+	TArray<bool> NeedsGrounding;
+
+	/** Squared distance from each entity to its nearest player, this frame */
+	TArray<float> NearestTargetDistancesSquared;
+
+	/** Full actors owned by the crowd */
+	TArray<FCombatCrowdActor> CrowdActors;
+
+	/** Entity the next nav mesh height projection starts from, so the budget is shared round robin */
+	int32 NextGroundingIndex = 0;
+
+public:
+
+	/** Adds an enemy to the crowd as an entity. The squad name and death listeners are given to the actor once it's rehydrated. Ignored on clients */
+	void AddEnemy(TSubclassOf<ACombatEnemy> EnemyClass, const FTransform& Transform, FName SquadName, const FOnEnemyDied& OnDied);
+
+	/** Returns the number of entities */
+	int32 GetNumEntities() const { return Positions.Num(); }
+
+	/** Returns the number of full actors owned by the crowd */
+	int32 GetNumActors() const { return CrowdActors.Num(); }
+
+	/** Sets the replicated entities drawn by a client. Called by the replicator */
+	void SetReplicator(ACombatCrowdReplicator* InReplicator);
+
+	/** Logs the crowd size. Bound to the Combat.Crowd.Stats console command */
+	static void DumpStats(const TArray<FString>& Args, UWorld* World);
+
+protected:
+
+	/** Returns the archetype index for an enemy class, creating it if needed */
+	int32 FindOrAddArchetype(TSubclassOf<ACombatEnemy> EnemyClass);
+
+	/** Removes an entity by swapping the last one into its place */
+	void RemoveEntity(int32 EntityIndex);
+
+	/** Moves every entity towards its nearest player, following the flow field height where it covers the entity */
+	void MoveEntities(float DeltaTime);
+
+	/** Projects a budgeted number of entities that moved off the flow field onto the nav mesh */
+	void GroundEntities();
+
+	/** Swaps the closest entities within range for full actors */
+	void RehydrateEntities();
+
+	/** Swaps idle, distant crowd actors back into entities */
+	void DehydrateActors();
+
+	/** Uploads the entity transforms to the instanced renderers */
+	void UpdateRenderers();
+
+	/** Copies the entities to the replicator at a throttled rate, spawning it if needed. Server only */
+	void UpdateReplicator(float DeltaTime);
+
+	/** Draws the entities received from the server. Client only */
+	void UpdateRemoteRenderers();
+
+	/** Uploads each archetype's gathered instance transforms to its renderer */
+	void UploadInstances();
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Cleanup */
+	virtual void Deinitialize() override;
+
+public:
+
+	/** Runs the crowd update */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
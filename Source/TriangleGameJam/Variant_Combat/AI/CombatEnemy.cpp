@@ -5,14 +5,30 @@
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "CombatAIController.h"
-#include "Components/WidgetComponent.h"
 #include "Engine/DamageEvents.h"
-#include "CombatLifeBar.h"
+#include "CombatLifeBarSubsystem.h"
 #include "TimerManager.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Animation/AnimInstance.h"
-
-ACombatEnemy::ACombatEnemy()
+#include "BrainComponent.h"
+#include "CombatEnemyPool.h"
+#include "CombatSignificanceSubsystem.h"
+#include "CombatPerceptionSubsystem.h"
+#include "CombatAnimSharingSubsystem.h"
+#include "CombatMeleeSubsystem.h"
+#include "CombatRagdollSubsystem.h"
+#include "CombatHitReactionComponent.h"
+#include "UObject/ObjectSaveContext.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "TriangleGameJamReplicationGraph.h"
+#include "TriangleGameJamAssetStreaming.h"
+#include "EffectDispatcherSubsystem.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "IAnimationBudgetAllocator.h"
+
+ACombatEnemy::ACombatEnemy(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<USkeletalMeshComponentBudgeted>(ACharacter::MeshComponentName))
 {
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -28,9 +44,8 @@ ACombatEnemy::ACombatEnemy()
 	// ignore the controller's yaw rotation
 	bUseControllerRotationYaw = false;
 
-	// create the life bar
-	LifeBar = CreateDefaultSubobject<UWidgetComponent>(TEXT("LifeBar"));
-	LifeBar->SetupAttachment(RootComponent);
+	// create the hit reaction
+	HitReaction = CreateDefaultSubobject<UCombatHitReactionComponent>(TEXT("HitReaction"));
 
 	// set the collision capsule size
 	GetCapsuleComponent()->SetCapsuleSize(35.0f, 90.0f);
@@ -38,6 +53,22 @@ ACombatEnemy::ACombatEnemy()
 	// set the character movement properties
 	GetCharacterMovement()->bUseControllerDesiredRotation = true;
 
+	// avoid other enemies locally, since flow field movement doesn't go through path following
+	GetCharacterMovement()->bUseRVOAvoidance = true;
+
+	// let the mesh skip animation updates based on screen size and significance
+	GetMesh()->bEnableUpdateRateOptimizations = true;
+
+	// only meshes evaluating their own pose go through the animation budget, so we register with it ourselves
+	if (USkeletalMeshComponentBudgeted* BudgetedMesh = Cast<USkeletalMeshComponentBudgeted>(GetMesh()))
+	{
+		BudgetedMesh->SetAutoRegisterWithBudgetAllocator(false);
+	}
+
+	// replicate at the engaged rate until the first significance pass adapts it
+	SetNetUpdateFrequency(EngagedNetUpdateFrequency);
+	SetMinNetUpdateFrequency(IdleNetUpdateFrequency);
+
 	// reset HP to maximum
 	CurrentHP = MaxHP;
 }
@@ -51,10 +82,16 @@ void ACombatEnemy::DoAIComboAttack()
 	}
 
 	// raise the attacking flag
-	bIsAttacking = true;
+	SetIsAttacking(true);
+
+	// evaluate our own pose so the montage plays on us
+	if (UCombatAnimSharingSubsystem* AnimSharing = GetWorld()->GetSubsystem<UCombatAnimSharingSubsystem>())
+	{
+		AnimSharing->StopSharing(AnimSharingHandle);
+	}
 
 	// choose how many times we're going to attack
-	TargetComboCount = FMath::RandRange(1, ComboSectionNames.Num() - 1);
+	TargetComboCount = AttackRandom.RandRange(1, ComboSectionNames.Num() - 1);
 
 	// reset the attack counter
 	CurrentComboAttack = 0;
@@ -62,15 +99,27 @@ void ACombatEnemy::DoAIComboAttack()
 	// play the attack montage
 	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 	{
-		const float MontageLength = AnimInstance->Montage_Play(ComboAttackMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
+		// start a new swing
+		++MeleeSwingId;
+
+		// the montage is normally streamed in by now, but load it if we attack before it's done
+		UAnimMontage* AttackMontage = ComboAttackMontage.LoadSynchronous();
 
-		// subscribe to montage completed and interrupted events
-		if (MontageLength > 0.0f)
+		const float MontageLength = AnimInstance->Montage_Play(AttackMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
+
+		// subscribe to montage completed and interrupted events, unless the attack timeline ends the attack
+		if (MontageLength > 0.0f && !UsesAttackTimeline())
 		{
 			// set the end delegate for the montage
-			AnimInstance->Montage_SetEndDelegate(OnAttackMontageEnded, ComboAttackMontage);
+			AnimInstance->Montage_SetEndDelegate(OnAttackMontageEnded, AttackMontage);
 		}
 	}
+
+	// run the attack on the gameplay clock
+	if (UsesAttackTimeline())
+	{
+		AttackClock.Start(ComboAttackTimeline);
+	}
 }
 
 void ACombatEnemy::DoAIChargedAttack()
@@ -82,10 +131,16 @@ void ACombatEnemy::DoAIChargedAttack()
 	}
 
 	// raise the attacking flag
-	bIsAttacking = true;
+	SetIsAttacking(true);
+
+	// evaluate our own pose so the montage plays on us
+	if (UCombatAnimSharingSubsystem* AnimSharing = GetWorld()->GetSubsystem<UCombatAnimSharingSubsystem>())
+	{
+		AnimSharing->StopSharing(AnimSharingHandle);
+	}
 
 	// choose how many loops are we going to charge for
-	TargetChargeLoops = FMath::RandRange(MinChargeLoops, MaxChargeLoops);
+	TargetChargeLoops = AttackRandom.RandRange(MinChargeLoops, MaxChargeLoops);
 
 	// reset the charge loop counter
 	CurrentChargeLoop = 0;
@@ -93,21 +148,33 @@ void ACombatEnemy::DoAIChargedAttack()
 	// play the attack montage
 	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 	{
-		const float MontageLength = AnimInstance->Montage_Play(ChargedAttackMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
+		// start a new swing
+		++MeleeSwingId;
+
+		// the montage is normally streamed in by now, but load it if we attack before it's done
+		UAnimMontage* AttackMontage = ChargedAttackMontage.LoadSynchronous();
+
+		const float MontageLength = AnimInstance->Montage_Play(AttackMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
 
-		// subscribe to montage completed and interrupted events
-		if (MontageLength > 0.0f)
+		// subscribe to montage completed and interrupted events, unless the attack timeline ends the attack
+		if (MontageLength > 0.0f && !UsesAttackTimeline())
 		{
 			// set the end delegate for the montage
-			AnimInstance->Montage_SetEndDelegate(OnAttackMontageEnded, ChargedAttackMontage);
+			AnimInstance->Montage_SetEndDelegate(OnAttackMontageEnded, AttackMontage);
 		}
 	}
+
+	// run the attack on the gameplay clock
+	if (UsesAttackTimeline())
+	{
+		AttackClock.Start(ChargedAttackTimeline);
+	}
 }
 
 void ACombatEnemy::AttackMontageEnded(UAnimMontage* Montage, bool bInterrupted)
 {
 	// reset the attacking flag
-	bIsAttacking = false;
+	SetIsAttacking(false);
 
 	// call the attack completed delegate so the StateTree can continue execution
 	OnAttackCompleted.ExecuteIfBound();
@@ -115,47 +182,30 @@ void ACombatEnemy::AttackMontageEnded(UAnimMontage* Montage, bool bInterrupted)
 
 void ACombatEnemy::DoAttackTrace(FName DamageSourceBone)
 {
-	// sweep for objects in front of the character to be hit by the attack
-	TArray<FHitResult> OutHits;
+	// sweep for objects in front of the character to be hit by the attack.
+	// The sweep is batched with every other attack this frame and each victim is only damaged once per swing
+	FCombatMeleeSweep Sweep;
+	Sweep.Attacker = this;
+	Sweep.SwingId = MeleeSwingId;
 
 	// start at the provided socket location, sweep forward
-	const FVector TraceStart = GetMesh()->GetSocketLocation(DamageSourceBone);
-	const FVector TraceEnd = TraceStart + (GetActorForwardVector() * MeleeTraceDistance);
+	Sweep.Start = GetMesh()->GetSocketLocation(DamageSourceBone);
+	Sweep.End = Sweep.Start + (GetActorForwardVector() * MeleeTraceDistance);
+	Sweep.Radius = MeleeTraceRadius;
 
 	// enemies only affect Pawn collision objects; they don't knock back boxes
-	FCollisionObjectQueryParams ObjectParams;
-	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
+	Sweep.ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
 
-	// use a sphere shape for the sweep
-	FCollisionShape CollisionShape;
-	CollisionShape.SetSphere(MeleeTraceRadius);
+	// only damage the player
+	Sweep.RequiredVictimTag = FName("Player");
 
-	// ignore self
-	FCollisionQueryParams QueryParams;
-	QueryParams.AddIgnoredActor(this);
+	Sweep.Damage = MeleeDamage;
+	Sweep.KnockbackImpulse = MeleeKnockbackImpulse;
+	Sweep.LaunchImpulse = MeleeLaunchImpulse;
 
-	if (GetWorld()->SweepMultiByObjectType(OutHits, TraceStart, TraceEnd, FQuat::Identity, ObjectParams, CollisionShape, QueryParams))
+	if (UCombatMeleeSubsystem* MeleeSubsystem = GetWorld()->GetSubsystem<UCombatMeleeSubsystem>())
 	{
-		// iterate over each object hit
-		for (const FHitResult& CurrentHit : OutHits)
-		{
-			/** does the actor have the player tag? */
-			if (CurrentHit.GetActor()->ActorHasTag(FName("Player")))
-			{
-				// check if the actor is damageable
-				ICombatDamageable* Damageable = Cast<ICombatDamageable>(CurrentHit.GetActor());
-
-				if (Damageable)
-				{
-					// knock upwards and away from the impact normal
-					const FVector Impulse = (CurrentHit.ImpactNormal * -MeleeKnockbackImpulse) + (FVector::UpVector * MeleeLaunchImpulse);
-
-					// pass the damage event to the actor
-					Damageable->ApplyDamage(MeleeDamage, this, CurrentHit.ImpactPoint, Impulse);
-
-				}
-			}
-		}
+		MeleeSubsystem->QueueSweep(MoveTemp(Sweep));
 	}
 }
 
@@ -167,11 +217,16 @@ void ACombatEnemy::CheckCombo()
 	// do we still have attacks to play in this string?
 	if (CurrentComboAttack < TargetComboCount)
 	{
+		// start a new swing
+		++MeleeSwingId;
+
 		// jump to the next attack section
 		if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 		{
-			AnimInstance->Montage_JumpToSection(ComboSectionNames[CurrentComboAttack], ComboAttackMontage);
+			AnimInstance->Montage_JumpToSection(ComboSectionNames[CurrentComboAttack], ComboAttackMontage.Get());
 		}
+
+		AttackClock.JumpToSection(ComboSectionNames[CurrentComboAttack]);
 	}
 }
 
@@ -180,16 +235,39 @@ void ACombatEnemy::CheckChargedAttack()
 	// increase the charge loop counter
 	++CurrentChargeLoop;
 
+	// start a new swing
+	++MeleeSwingId;
+
 	// jump to either the loop or attack section of the montage depending on whether we hit the loop target
+	const FName NextSection = CurrentChargeLoop >= TargetChargeLoops ? ChargeAttackSection : ChargeLoopSection;
+
 	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 	{
-		AnimInstance->Montage_JumpToSection(CurrentChargeLoop >= TargetChargeLoops ? ChargeAttackSection : ChargeLoopSection, ChargedAttackMontage);
+		AnimInstance->Montage_JumpToSection(NextSection, ChargedAttackMontage.Get());
 	}
+
+	AttackClock.JumpToSection(NextSection);
+}
+
+bool ACombatEnemy::UsesAttackTimeline() const
+{
+	return bUseAttackTimeline && ComboAttackTimeline.IsValid() && ChargedAttackTimeline.IsValid();
 }
 
 void ACombatEnemy::ApplyDamage(float Damage, AActor* DamageCauser, const FVector& DamageLocation, const FVector& DamageImpulse)
 {
-	
+	// wake up if we were sleeping so we can react
+	if (Significance == ECombatSignificance::Sleeping)
+	{
+		ApplySignificance(ECombatSignificance::High);
+	}
+
+	// evaluate our own pose so the hit reaction applies to us
+	if (UCombatAnimSharingSubsystem* AnimSharing = GetWorld()->GetSubsystem<UCombatAnimSharingSubsystem>())
+	{
+		AnimSharing->StopSharing(AnimSharingHandle);
+	}
+
 	// pass the damage event to the actor
 	FDamageEvent DamageEvent;
 	const float ActualDamage = TakeDamage(Damage, DamageEvent, nullptr, DamageCauser);
@@ -197,6 +275,14 @@ void ACombatEnemy::ApplyDamage(float Damage, AActor* DamageCauser, const FVector
 	// only process knockback and effects if we received nonzero damage
 	if (ActualDamage > 0.0f)
 	{
+		// play a procedural hit reaction while alive. Only heavy hits fall back to partial ragdoll physics
+		if (CurrentHP > 0.0f && HitReaction->ReactToHit(DamageImpulse))
+		{
+			// enable partial ragdoll physics, but keep the pelvis vertical
+			GetMesh()->SetPhysicsBlendWeight(0.5f);
+			GetMesh()->SetBodySimulatePhysics(PelvisBoneName, false);
+		}
+
 		// apply the knockback impulse
 		GetCharacterMovement()->AddImpulse(DamageImpulse, true);
 
@@ -207,11 +293,37 @@ void ACombatEnemy::ApplyDamage(float Damage, AActor* DamageCauser, const FVector
 			GetMesh()->AddImpulseAtLocation(DamageImpulse * GetMesh()->GetMass(), DamageLocation);
 		}
 
-		// stop the attack montages to interrupt the attack
+		// stop the attack montages to interrupt the attack. A null montage would stop every montage, so skip any that haven't loaded
 		if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 		{
-			AnimInstance->Montage_Stop(0.1f, ComboAttackMontage);
-			AnimInstance->Montage_Stop(0.1f, ChargedAttackMontage);
+			if (UAnimMontage* ComboMontage = ComboAttackMontage.Get())
+			{
+				AnimInstance->Montage_Stop(0.1f, ComboMontage);
+			}
+
+			if (UAnimMontage* ChargedMontage = ChargedAttackMontage.Get())
+			{
+				AnimInstance->Montage_Stop(0.1f, ChargedMontage);
+			}
+		}
+
+		// the montage end delegate isn't bound for timeline attacks, so end the attack here
+		if (AttackClock.IsRunning())
+		{
+			AttackClock.Stop();
+			AttackMontageEnded(nullptr, true);
+		}
+
+		// play the pooled impact effects
+		if (UEffectDispatcherSubsystem* EffectDispatcher = GetWorld()->GetSubsystem<UEffectDispatcherSubsystem>())
+		{
+			EffectDispatcher->PlayEffectAtLocation(HitEffect, HitSound, DamageLocation, DamageImpulse.Rotation());
+		}
+
+		// getting hit gives the attacker away to us and anyone else close enough to hear it
+		if (UCombatPerceptionSubsystem* Perception = GetWorld()->GetSubsystem<UCombatPerceptionSubsystem>())
+		{
+			Perception->ReportNoise(DamageLocation, 1.0f, DamageCauser);
 		}
 
 		// pass control to BP to play effects, etc.
@@ -221,8 +333,14 @@ void ACombatEnemy::ApplyDamage(float Damage, AActor* DamageCauser, const FVector
 
 void ACombatEnemy::HandleDeath()
 {
+	// raise the death flag for clients
+	SetIsDead(true);
+
 	// hide the life bar
-	LifeBar->SetHiddenInGame(true);
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifeBarVisible(LifeBarHandle, false);
+	}
 
 	// disable the collision capsule to avoid being hit again while dead
 	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
@@ -230,14 +348,29 @@ void ACombatEnemy::HandleDeath()
 	// disable character movement
 	GetCharacterMovement()->DisableMovement();
 
-	// enable full ragdoll physics
-	GetMesh()->SetSimulatePhysics(true);
+	// stop sharing our pose so the ragdoll applies to us
+	if (UCombatAnimSharingSubsystem* AnimSharing = GetWorld()->GetSubsystem<UCombatAnimSharingSubsystem>())
+	{
+		AnimSharing->StopSharing(AnimSharingHandle);
+	}
+
+	// dead meshes leave the animation budget, so it can't turn the tick back on once the ragdoll freezes
+	ApplyAnimationSettings();
+
+	// enable full ragdoll physics. The ragdoll budget freezes it once it comes to rest
+	if (UCombatRagdollSubsystem* RagdollSubsystem = GetWorld()->GetSubsystem<UCombatRagdollSubsystem>())
+	{
+		RagdollSubsystem->StartRagdoll(GetMesh());
+	}
 
 	// call the died delegate to notify any subscribers
 	OnEnemyDied.Broadcast();
 
 	// set up the death timer
 	GetWorld()->GetTimerManager().SetTimer(DeathTimer, this, &ACombatEnemy::RemoveFromLevel, DeathRemovalTime);
+
+	// nothing we replicate changes while we wait to be removed, so stop replicating once the death state has been sent
+	SetNetDormancy(DORM_DormantAll);
 }
 
 void ACombatEnemy::ApplyHealing(float Healing, AActor* Healer)
@@ -247,10 +380,430 @@ void ACombatEnemy::ApplyHealing(float Healing, AActor* Healer)
 
 void ACombatEnemy::RemoveFromLevel()
 {
+	// return to the enemy pool if possible so we can be reused
+	if (UCombatEnemyPool* EnemyPool = GetWorld()->GetSubsystem<UCombatEnemyPool>())
+	{
+		if (EnemyPool->Release(this))
+		{
+			return;
+		}
+	}
+
 	// destroy this actor
 	Destroy();
 }
 
+void ACombatEnemy::BuildAttackTimelines()
+{
+	ComboAttackTimeline.Build(ComboAttackMontage.LoadSynchronous());
+	ChargedAttackTimeline.Build(ChargedAttackMontage.LoadSynchronous());
+}
+
+void ACombatEnemy::PreloadAttackAssets()
+{
+	AttackAssetsHandle = TriangleGameJamAssetStreaming::RequestAssets(GetAttackAssetPaths(),
+		FStreamableDelegate::CreateUObject(this, &ACombatEnemy::OnAttackAssetsLoaded));
+}
+
+void ACombatEnemy::OnAttackAssetsLoaded()
+{
+	// extract the attack timelines if this class hasn't been saved since they were added.
+	// Attacks fall back to the montage notifies until then
+	if (bUseAttackTimeline && (!ComboAttackTimeline.IsValid() || !ChargedAttackTimeline.IsValid()))
+	{
+		ComboAttackTimeline.Build(ComboAttackMontage.Get());
+		ChargedAttackTimeline.Build(ChargedAttackMontage.Get());
+
+		// attacks now run on game time, so the pose no longer needs to tick while off screen
+		ApplyAnimationSettings();
+	}
+}
+
+void ACombatEnemy::HandleAttackEvent(const FCombatAttackTimelineEvent& Event)
+{
+	switch (Event.Type)
+	{
+	case ECombatAttackEvent::AttackTrace:
+		DoAttackTrace(Event.BoneName);
+		break;
+
+	case ECombatAttackEvent::CheckCombo:
+		CheckCombo();
+		break;
+
+	case ECombatAttackEvent::CheckChargedAttack:
+		CheckChargedAttack();
+		break;
+	}
+}
+
+void ACombatEnemy::DeactivateForPool()
+{
+	bInPool = true;
+
+	// we're usually still dormant from our death, so send clients the hide and the reset state before going dormant again
+	FlushNetDormancy();
+
+	// clear any pending death removal
+	GetWorld()->GetTimerManager().ClearTimer(DeathTimer);
+
+	// stop the StateTree
+	if (AAIController* AIController = Cast<AAIController>(GetController()))
+	{
+		if (UBrainComponent* Brain = AIController->GetBrainComponent())
+		{
+			Brain->StopLogic(TEXT("Pooled"));
+		}
+	}
+
+	// unsubscribe any listeners from our previous life
+	OnEnemyDied.Clear();
+	OnAttackCompleted.Unbind();
+	OnEnemyLanded.Unbind();
+
+	// stop any attacks in progress
+	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
+	{
+		AnimInstance->StopAllMontages(0.0f);
+	}
+
+	SetIsAttacking(false);
+	AttackClock.Stop();
+
+	// stop sharing our pose
+	if (UCombatAnimSharingSubsystem* AnimSharing = GetWorld()->GetSubsystem<UCombatAnimSharingSubsystem>())
+	{
+		AnimSharing->StopSharing(AnimSharingHandle);
+	}
+
+	// forget our previous targets, and leave our squad so whoever acquires us next can put us in theirs
+	if (UCombatPerceptionSubsystem* Perception = GetWorld()->GetSubsystem<UCombatPerceptionSubsystem>())
+	{
+		Perception->ForgetTargets(PerceptionHandle);
+	}
+	SquadName = GetDefault<ACombatEnemy>(GetClass())->SquadName;
+
+	// stop any hit reaction in progress
+	HitReaction->ResetReaction();
+
+	// stop the ragdoll and put the mesh back in place
+	if (UCombatRagdollSubsystem* RagdollSubsystem = GetWorld()->GetSubsystem<UCombatRagdollSubsystem>())
+	{
+		RagdollSubsystem->StopRagdoll(GetMesh());
+	}
+	GetMesh()->SetSimulatePhysics(false);
+	GetMesh()->SetPhysicsBlendWeight(0.0f);
+	GetMesh()->AttachToComponent(GetCapsuleComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+	GetMesh()->SetRelativeTransform(MeshStartingTransform);
+
+	// hide and disable the actor
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifeBarVisible(LifeBarHandle, false);
+	}
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+
+	// leave the animation budget before we stop the mesh tick, or it would turn it back on
+	ApplyAnimationSettings();
+
+	GetMesh()->SetComponentTickEnabled(false);
+	GetCharacterMovement()->SetComponentTickEnabled(false);
+
+	// stay dormant while waiting in the pool
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void ACombatEnemy::ActivateFromPool(const FTransform& SpawnTransform)
+{
+	// resume replication before changing anything, so clients see the respawn
+	SetNetDormancy(DORM_Awake);
+
+	bInPool = false;
+
+	// move to the spawn location
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+
+	// reset HP to maximum before the StateTree restarts so it picks it up at the right value
+	SetCurrentHP(MaxHP);
+	SetIsDead(false);
+
+	// re-enable the actor
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(true);
+	GetMesh()->SetComponentTickEnabled(true);
+	GetCharacterMovement()->SetComponentTickEnabled(true);
+
+	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+	GetCharacterMovement()->SetDefaultMovementMode();
+
+	// refill the life bar
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifePercentage(LifeBarHandle, 1.0f);
+	}
+
+	// start at full update rate until the next significance pass, which also shows the life bar
+	// and puts the mesh back in the animation budget now that we're alive
+	LastDamageTime = -1000.0f;
+	ApplySignificance(ECombatSignificance::High, true);
+
+	// restart the StateTree from its root
+	if (AAIController* AIController = Cast<AAIController>(GetController()))
+	{
+		if (UBrainComponent* Brain = AIController->GetBrainComponent())
+		{
+			Brain->RestartLogic();
+		}
+	}
+}
+
+void ACombatEnemy::RestoreHP(float HP)
+{
+	SetCurrentHP(FMath::Clamp(HP, 0.0f, MaxHP));
+
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifePercentage(LifeBarHandle, CurrentHP / MaxHP);
+	}
+}
+
+void ACombatEnemy::ApplySignificance(ECombatSignificance NewSignificance, bool bForce)
+{
+	// ignore if the tier hasn't changed
+	if (NewSignificance == Significance && !bForce)
+	{
+		return;
+	}
+
+	const bool bWasSleeping = Significance == ECombatSignificance::Sleeping;
+
+	Significance = NewSignificance;
+
+	AAIController* AIController = Cast<AAIController>(GetController());
+	UBrainComponent* Brain = AIController ? AIController->GetBrainComponent() : nullptr;
+
+	if (Significance == ECombatSignificance::Sleeping)
+	{
+		// pause the StateTree and stop ticking altogether
+		if (Brain)
+		{
+			Brain->PauseLogic(TEXT("Sleeping"));
+		}
+
+		SetActorTickEnabled(false);
+
+		// leave the animation budget before we stop the mesh tick, or it would turn it back on
+		ApplyAnimationSettings();
+
+		GetMesh()->SetComponentTickEnabled(false);
+		GetCharacterMovement()->SetComponentTickEnabled(false);
+
+		if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+		{
+			LifeBars->SetLifeBarVisible(LifeBarHandle, false);
+		}
+
+		// idle enemies don't change, so stop replicating them until they wake up
+		if (HasAuthority())
+		{
+			SetNetDormancy(DORM_DormantAll);
+		}
+
+		return;
+	}
+
+	if (bWasSleeping)
+	{
+		// wake up where we left off
+		SleepTimer = 0.0f;
+
+		if (HasAuthority())
+		{
+			SetNetDormancy(DORM_Awake);
+		}
+
+		SetActorTickEnabled(true);
+		GetMesh()->SetComponentTickEnabled(true);
+		GetCharacterMovement()->SetComponentTickEnabled(true);
+
+		if (Brain)
+		{
+			Brain->ResumeLogic(TEXT("Woken up"));
+		}
+	}
+
+	const float TickInterval = GetSignificanceTickInterval();
+
+	// throttle the actor and animation updates
+	SetActorTickInterval(TickInterval);
+	ApplyAnimationSettings();
+
+	// only throttle movement when nobody can see it
+	GetCharacterMovement()->SetComponentTickInterval(Significance == ECombatSignificance::Minimal ? TickInterval : 0.0f);
+
+	// throttle the StateTree
+	if (Brain)
+	{
+		Brain->SetComponentTickInterval(TickInterval);
+	}
+
+	// only show the life bar for nearby, living enemies
+	const bool bShowLifeBar = CurrentHP > 0.0f && (Significance == ECombatSignificance::High || Significance == ECombatSignificance::Medium);
+
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifeBarVisible(LifeBarHandle, bShowLifeBar);
+	}
+
+	// clients only use the tiers to throttle what they draw
+	if (HasAuthority())
+	{
+		UpdateNetUpdateFrequency();
+	}
+}
+
+float ACombatEnemy::GetSignificanceTickInterval() const
+{
+	switch (Significance)
+	{
+	case ECombatSignificance::Medium:
+		return MediumTickInterval;
+
+	case ECombatSignificance::Low:
+		return LowTickInterval;
+
+	case ECombatSignificance::Minimal:
+		return MinimalTickInterval;
+
+	default:
+		return 0.0f;
+	}
+}
+
+void ACombatEnemy::ApplyAnimationSettings()
+{
+	// followers copy their leader's pose, and sleeping, dead or pooled enemies don't animate, so only the rest evaluate a pose
+	const bool bEvaluatesPose = AnimSharingRole != ECombatAnimSharingRole::Follower && Significance != ECombatSignificance::Sleeping && !IsInactiveInPool() && !IsDead();
+
+	// leaders are copied by followers that may be on screen even when the leader isn't
+	const bool bTickWhenOffscreen = Significance == ECombatSignificance::High || AnimSharingRole == ECombatAnimSharingRole::Leader;
+
+	USkeletalMeshComponentBudgeted* BudgetedMesh = Cast<USkeletalMeshComponentBudgeted>(GetMesh());
+	IAnimationBudgetAllocator* AnimationBudget = BudgetedMesh ? IAnimationBudgetAllocator::Get(GetWorld()) : nullptr;
+
+	const bool bUseBudget = AnimationBudget && AnimationBudget->GetEnabled() && bEvaluatesPose;
+
+	if (AnimationBudget)
+	{
+		const bool bRegistered = BudgetedMesh->GetAnimationBudgetHandle() != INDEX_NONE;
+
+		if (bUseBudget && !bRegistered)
+		{
+			AnimationBudget->RegisterComponent(BudgetedMesh);
+		}
+		else if (!bUseBudget && bRegistered)
+		{
+			AnimationBudget->UnregisterComponent(BudgetedMesh);
+		}
+	}
+
+	if (bUseBudget)
+	{
+		float BudgetSignificance = 0.1f;
+
+		switch (Significance)
+		{
+		case ECombatSignificance::High:
+			BudgetSignificance = 1.0f;
+			break;
+
+		case ECombatSignificance::Medium:
+			BudgetSignificance = 0.5f;
+			break;
+
+		case ECombatSignificance::Low:
+			BudgetSignificance = 0.25f;
+			break;
+
+		default:
+			break;
+		}
+
+		// a leader's pose stands in for its whole group, so it's budgeted as fully significant.
+		// Engaged enemies are never skipped, so attacks and hit reactions stay smooth under load
+		if (AnimSharingRole == ECombatAnimSharingRole::Leader)
+		{
+			BudgetSignificance = 1.0f;
+		}
+
+		AnimationBudget->SetComponentSignificance(BudgetedMesh, BudgetSignificance, IsEngagedInCombat(), bTickWhenOffscreen);
+	}
+
+	// the budget throttles the meshes registered with it. Everyone else is throttled by tier
+	GetMesh()->SetComponentTickInterval(bUseBudget ? 0.0f : GetSignificanceTickInterval());
+
+	// below full significance, skip the pose when offscreen. Attacks on the attack timeline don't depend on animation at all,
+	// otherwise keep ticking montages so attack notifies still fire
+	GetMesh()->VisibilityBasedAnimTickOption = bTickWhenOffscreen
+		? EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones
+		: UsesAttackTimeline() ? EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered : EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+}
+
+void ACombatEnemy::SetAnimSharingRole(ECombatAnimSharingRole NewRole)
+{
+	if (NewRole != AnimSharingRole)
+	{
+		AnimSharingRole = NewRole;
+
+		ApplyAnimationSettings();
+	}
+}
+
+void ACombatEnemy::UpdateNetUpdateFrequency()
+{
+	float NetFrequency = IdleNetUpdateFrequency;
+
+	if (IsEngagedInCombat())
+	{
+		NetFrequency = EngagedNetUpdateFrequency;
+	}
+	else if (Significance == ECombatSignificance::High)
+	{
+		NetFrequency = NearNetUpdateFrequency;
+	}
+
+	if (GetNetUpdateFrequency() != NetFrequency)
+	{
+		SetNetUpdateFrequency(NetFrequency);
+		UTriangleGameJamReplicationGraph::NotifyNetUpdateFrequencyChanged(this);
+	}
+}
+
+bool ACombatEnemy::IsEngagedInCombat() const
+{
+	return bIsAttacking || GetWorld()->TimeSince(LastDamageTime) < EngagementTime;
+}
+
+bool ACombatEnemy::CanSleep() const
+{
+	// only sleep while alive, idle and standing on the ground
+	return CurrentHP > 0.0f && !bIsAttacking && !IsInactiveInPool() && GetCharacterMovement()->IsMovingOnGround();
+}
+
+float ACombatEnemy::UpdateSleepTimer(bool bCanSleep, float DeltaTime)
+{
+	SleepTimer = bCanSleep ? SleepTimer + DeltaTime : 0.0f;
+
+	return SleepTimer;
+}
+
 float ACombatEnemy::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
 	// only process damage if the character is still alive
@@ -260,7 +813,12 @@ float ACombatEnemy::TakeDamage(float Damage, struct FDamageEvent const& DamageEv
 	}
 
 	// reduce the current HP
-	CurrentHP -= Damage;
+	SetCurrentHP(CurrentHP - Damage);
+
+	// count as engaged so we update at full rate, and send the hit right away instead of waiting for our next net update
+	LastDamageTime = GetWorld()->GetTimeSeconds();
+	UpdateNetUpdateFrequency();
+	ForceNetUpdate();
 
 	// have we run out of HP?
 	if (CurrentHP <= 0.0f)
@@ -271,17 +829,69 @@ float ACombatEnemy::TakeDamage(float Damage, struct FDamageEvent const& DamageEv
 	else
 	{
 		// update the life bar
-		LifeBarWidget->SetLifePercentage(CurrentHP / MaxHP);
-
-		// enable partial ragdoll physics, but keep the pelvis vertical
-		GetMesh()->SetPhysicsBlendWeight(0.5f);
-		GetMesh()->SetBodySimulatePhysics(PelvisBoneName, false);
+		if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+		{
+			LifeBars->SetLifePercentage(LifeBarHandle, CurrentHP / MaxHP);
+		}
 	}
 
 	// return the received damage amount
 	return Damage;
 }
 
+void ACombatEnemy::SetCurrentHP(float HP)
+{
+	CurrentHP = HP;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ACombatEnemy, CurrentHP, this);
+
+	// sleeping, dead and pooled enemies are dormant, so make sure the change still reaches clients
+	FlushNetDormancy();
+}
+
+void ACombatEnemy::SetIsAttacking(bool bAttacking)
+{
+	bIsAttacking = bAttacking;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ACombatEnemy, bIsAttacking, this);
+	FlushNetDormancy();
+}
+
+void ACombatEnemy::SetIsDead(bool bDead)
+{
+	bIsDead = bDead;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ACombatEnemy, bIsDead, this);
+	FlushNetDormancy();
+}
+
+void ACombatEnemy::OnRep_CurrentHP()
+{
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifePercentage(LifeBarHandle, CurrentHP / MaxHP);
+	}
+}
+
+void ACombatEnemy::OnRep_IsDead()
+{
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifeBarVisible(LifeBarHandle, !bIsDead);
+	}
+	GetCapsuleComponent()->SetCollisionEnabled(bIsDead ? ECollisionEnabled::NoCollision : ECollisionEnabled::QueryAndPhysics);
+}
+
+void ACombatEnemy::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// these only change on hits, attacks and death, so only compare them when they're marked dirty
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACombatEnemy, CurrentHP, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACombatEnemy, bIsAttacking, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ACombatEnemy, bIsDead, Params);
+}
+
 void ACombatEnemy::Landed(const FHitResult& Hit)
 {
 	Super::Landed(Hit);
@@ -300,17 +910,52 @@ void ACombatEnemy::Landed(const FHitResult& Hit)
 void ACombatEnemy::BeginPlay()
 {
 	// reset HP to maximum
-	CurrentHP = MaxHP;
+	SetCurrentHP(MaxHP);
 
 	// we top the HP before BeginPlay so StateTree picks it up at the right value
 	Super::BeginPlay();
 
-	// get the life bar widget from the widget comp
-	LifeBarWidget = Cast<UCombatLifeBar>(LifeBar->GetUserWidgetObject());
-	check(LifeBarWidget);
+	// save the relative mesh transform so it can be restored when we're reused
+	MeshStartingTransform = GetMesh()->GetRelativeTransform();
+
+	// seed the attack choices from our name so each enemy gets its own deterministic sequence
+	AttackRandom.Initialize(GetTypeHash(GetFName()));
+
+	// add our life bar to the batched renderer. It starts full
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBarHandle = LifeBars->RegisterLifeBar(this, LifeBarOffset, LifeBarColor);
+	}
 
-	// fill the life bar
-	LifeBarWidget->SetLifePercentage(1.0f);
+	// register for update throttling
+	if (UCombatSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UCombatSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->RegisterEnemy(this);
+	}
+
+	// start sensing targets. AI only runs on the server, so clients don't need to trace or hear anything
+	if (HasAuthority())
+	{
+		if (UCombatPerceptionSubsystem* Perception = GetWorld()->GetSubsystem<UCombatPerceptionSubsystem>())
+		{
+			PerceptionHandle = Perception->RegisterListener(this, PerceptionParams);
+		}
+	}
+
+	// share our pose with identical enemies
+	if (bShareAnimation)
+	{
+		if (UCombatAnimSharingSubsystem* AnimSharing = GetWorld()->GetSubsystem<UCombatAnimSharingSubsystem>())
+		{
+			AnimSharingHandle = AnimSharing->RegisterEnemy(this);
+		}
+	}
+
+	// start out evaluating our own pose through the animation budget
+	ApplyAnimationSettings();
+
+	// stream in the attack montages ahead of the first attack, and build any missing timelines once they're in
+	PreloadAttackAssets();
 }
 
 void ACombatEnemy::EndPlay(EEndPlayReason::Type EndPlayReason)
@@ -319,4 +964,60 @@ void ACombatEnemy::EndPlay(EEndPlayReason::Type EndPlayReason)
 
 	// clear the death timer
 	GetWorld()->GetTimerManager().ClearTimer(DeathTimer);
+
+	// stop update throttling
+	if (UCombatSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UCombatSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->UnregisterEnemy(this);
+	}
+
+	// stop sensing targets
+	if (UCombatPerceptionSubsystem* Perception = GetWorld()->GetSubsystem<UCombatPerceptionSubsystem>())
+	{
+		Perception->UnregisterListener(PerceptionHandle);
+	}
+
+	PerceptionHandle = INDEX_NONE;
+
+	// stop sharing our pose
+	if (UCombatAnimSharingSubsystem* AnimSharing = GetWorld()->GetSubsystem<UCombatAnimSharingSubsystem>())
+	{
+		AnimSharing->UnregisterEnemy(AnimSharingHandle);
+	}
+
+	AnimSharingHandle = INDEX_NONE;
+
+	// remove the life bar
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->UnregisterLifeBar(LifeBarHandle);
+	}
+
+	LifeBarHandle = INDEX_NONE;
+
+	// let the attack montages unload once nothing else uses them
+	TriangleGameJamAssetStreaming::ReleaseAssets(AttackAssetsHandle);
+}
+
+void ACombatEnemy::PreSave(FObjectPreSaveContext ObjectSaveContext)
+{
+	Super::PreSave(ObjectSaveContext);
+
+	// bake the montage notifies and sections into the attack timelines
+	BuildAttackTimelines();
+}
+
+void ACombatEnemy::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// advance the attack on game time, independent of animation updates
+	if (AttackClock.IsRunning())
+	{
+		if (!AttackClock.Advance(DeltaSeconds, [this](const FCombatAttackTimelineEvent& Event) { HandleAttackEvent(Event); }))
+		{
+			// the attack timeline has ended
+			AttackMontageEnded(nullptr, false);
+		}
+	}
 }
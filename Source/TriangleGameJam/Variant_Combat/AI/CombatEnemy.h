@@ -8,11 +8,19 @@
 #include "CombatDamageable.h"
 #include "Animation/AnimMontage.h"
 #include "Engine/TimerHandle.h"
+#include "Math/RandomStream.h"
+#include "CombatSignificanceSubsystem.h"
+#include "CombatPerceptionSubsystem.h"
+#include "CombatAnimSharingSubsystem.h"
+#include "CombatAttackTimeline.h"
 #include "CombatEnemy.generated.h"
 
-class UWidgetComponent;
-class UCombatLifeBar;
+class UCombatHitReactionComponent;
+struct FStreamableHandle;
+class UNiagaraSystem;
+class USoundBase;
 class UAnimMontage;
+class UStaticMesh;
 
 /** Completed attack animation delegate for StateTree */
 DECLARE_DELEGATE(FOnEnemyAttackCompleted);
@@ -32,14 +40,14 @@ class ACombatEnemy : public ACharacter, public ICombatAttacker, public ICombatDa
 {
 	GENERATED_BODY()
 
-	/** Life bar widget component */
+	/** Procedural hit reaction */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
-	UWidgetComponent* LifeBar;
+	UCombatHitReactionComponent* HitReaction;
 
 public:
 	
-	/** Constructor */
-	ACombatEnemy();
+	/** Constructor. Uses a budgeted mesh so animation goes through the animation budget allocator */
+	ACombatEnemy(const FObjectInitializer& ObjectInitializer);
 
 protected:
 
@@ -49,8 +57,8 @@ protected:
 
 public:
 
-	/** Current amount of HP the character has */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Damage", meta = (ClampMin = 0, ClampMax = 100))
+	/** Current amount of HP the character has. Push-model replicated, so set it through SetCurrentHP */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, ReplicatedUsing=OnRep_CurrentHP, Category="Damage", meta = (ClampMin = 0, ClampMax = 100))
 	float CurrentHP = 0.0f;
 
 protected:
@@ -59,13 +67,36 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Damage")
 	FName PelvisBoneName;
 
-	/** Pointer to the life bar widget */
+	/** Life bar position relative to the actor */
 	UPROPERTY(EditAnywhere, Category="Damage")
-	UCombatLifeBar* LifeBarWidget;
+	FVector LifeBarOffset = FVector(0.0f, 0.0f, 120.0f);
 
-	/** If true, the character is currently playing an attack animation */
+	/** Life bar fill color */
+	UPROPERTY(EditAnywhere, Category="Damage")
+	FLinearColor LifeBarColor = FLinearColor::Red;
+
+	/** Impact effect played through the pooled effect dispatcher when damaged. Leave empty if the Blueprint damage event plays its own */
+	UPROPERTY(EditAnywhere, Category="Damage|Effects")
+	UNiagaraSystem* HitEffect;
+
+	/** Impact sound played through the pooled effect dispatcher when damaged. Leave empty if the Blueprint damage event plays its own */
+	UPROPERTY(EditAnywhere, Category="Damage|Effects")
+	USoundBase* HitSound;
+
+	/** Handle on the batched life bar renderer */
+	int32 LifeBarHandle = INDEX_NONE;
+
+	/** If true, the character is currently playing an attack animation. Push-model replicated, so set it through SetIsAttacking */
+	UPROPERTY(Replicated)
 	bool bIsAttacking = false;
 
+	/** If true, the character has died and is waiting to be removed. Push-model replicated, so set it through SetIsDead */
+	UPROPERTY(ReplicatedUsing=OnRep_IsDead)
+	bool bIsDead = false;
+
+	/** Identifies the current attack swing, so batched melee sweeps only hit each victim once per swing */
+	uint32 MeleeSwingId = 0;
+
 	/** Distance ahead of the character that melee attack sphere collision traces will extend */
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Trace", meta = (ClampMin = 0, ClampMax = 500, Units = "cm"))
 	float MeleeTraceDistance = 75.0f;
@@ -86,9 +117,9 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Damage", meta = (ClampMin = 0, ClampMax = 1000, Units = "cm/s"))
 	float MeleeLaunchImpulse = 350.0f;
 
-	/** AnimMontage that will play for combo attacks */
+	/** AnimMontage that will play for combo attacks. Streamed in by the wave director when a spawn is queued, and on BeginPlay */
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Combo")
-	UAnimMontage* ComboAttackMontage;
+	TSoftObjectPtr<UAnimMontage> ComboAttackMontage;
 
 	/** Names of the AnimMontage sections that correspond to each stage of the combo attack */
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Combo")
@@ -100,9 +131,9 @@ protected:
 	/** Index of the current stage of the melee attack combo */
 	int32 CurrentComboAttack = 0;
 
-	/** AnimMontage that will play for charged attacks */
+	/** AnimMontage that will play for charged attacks. Streamed in by the wave director when a spawn is queued, and on BeginPlay */
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Charged")
-	UAnimMontage* ChargedAttackMontage;
+	TSoftObjectPtr<UAnimMontage> ChargedAttackMontage;
 
 	/** Name of the AnimMontage section that corresponds to the charge loop */
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Charged")
@@ -126,6 +157,24 @@ protected:
 	/** Number of charge animation loop currently playing */
 	int32 CurrentChargeLoop = 0;
 
+	/** Random stream for attack choices, so runs with the same seeds play out the same way */
+	FRandomStream AttackRandom;
+
+	/** If true, attacks run on timelines extracted from the attack montages instead of anim notifies, so they keep working while animation is throttled */
+	UPROPERTY(EditAnywhere, Category="Melee Attack|Timeline")
+	bool bUseAttackTimeline = true;
+
+	/** Section layout and gameplay events of the combo attack montage, extracted when this class is saved */
+	UPROPERTY(VisibleAnywhere, Category="Melee Attack|Timeline")
+	FCombatAttackTimeline ComboAttackTimeline;
+
+	/** Section layout and gameplay events of the charged attack montage, extracted when this class is saved */
+	UPROPERTY(VisibleAnywhere, Category="Melee Attack|Timeline")
+	FCombatAttackTimeline ChargedAttackTimeline;
+
+	/** Gameplay clock for the attack in progress */
+	FCombatAttackClock AttackClock;
+
 	/** Time to wait before removing this character from the level after it dies */
 	UPROPERTY(EditAnywhere, Category="Death")
 	float DeathRemovalTime = 5.0f;
@@ -133,6 +182,81 @@ protected:
 	/** Enemy death timer */
 	FTimerHandle DeathTimer;
 
+	/** Starting mesh transform, so it can be restored when the enemy is reused */
+	FTransform MeshStartingTransform;
+
+	/** Keeps the attack montages resident while we're in play, including while waiting in the pool */
+	TSharedPtr<FStreamableHandle> AttackAssetsHandle;
+
+	/** If true, this enemy has been deactivated and is waiting in the enemy pool. Cleared when it's reactivated */
+	bool bInPool = false;
+
+	/** Actor, mesh and StateTree tick interval while at medium significance */
+	UPROPERTY(EditAnywhere, Category="Significance", meta = (ClampMin = 0, ClampMax = 1, Units = "s"))
+	float MediumTickInterval = 0.05f;
+
+	/** Actor, mesh and StateTree tick interval while at low significance */
+	UPROPERTY(EditAnywhere, Category="Significance", meta = (ClampMin = 0, ClampMax = 1, Units = "s"))
+	float LowTickInterval = 0.2f;
+
+	/** Actor, mesh, movement and StateTree tick interval while at minimal significance */
+	UPROPERTY(EditAnywhere, Category="Significance", meta = (ClampMin = 0, ClampMax = 2, Units = "s"))
+	float MinimalTickInterval = 0.5f;
+
+	/** Time after receiving damage during which the enemy is considered engaged in combat */
+	UPROPERTY(EditAnywhere, Category="Significance", meta = (ClampMin = 0, ClampMax = 10, Units = "s"))
+	float EngagementTime = 3.0f;
+
+	/** Net update frequency while engaged in combat */
+	UPROPERTY(EditAnywhere, Category="Significance|Replication", meta = (ClampMin = 1, ClampMax = 100, Units = "Hz"))
+	float EngagedNetUpdateFrequency = 30.0f;
+
+	/** Net update frequency while at high significance but not engaged */
+	UPROPERTY(EditAnywhere, Category="Significance|Replication", meta = (ClampMin = 1, ClampMax = 100, Units = "Hz"))
+	float NearNetUpdateFrequency = 10.0f;
+
+	/** Net update frequency at the lower significance tiers */
+	UPROPERTY(EditAnywhere, Category="Significance|Replication", meta = (ClampMin = 1, ClampMax = 100, Units = "Hz"))
+	float IdleNetUpdateFrequency = 2.0f;
+
+	/** Static mesh drawn for this enemy while it's part of the distant crowd */
+	UPROPERTY(EditAnywhere, Category="Crowd")
+	UStaticMesh* CrowdProxyMesh;
+
+	/** Simplified movement speed while part of the distant crowd */
+	UPROPERTY(EditAnywhere, Category="Crowd", meta = (ClampMin = 0, ClampMax = 2000, Units = "cm/s"))
+	float CrowdMoveSpeed = 300.0f;
+
+	/** Sight and hearing tuning */
+	UPROPERTY(EditAnywhere, Category="Perception")
+	FCombatPerceptionParams PerceptionParams;
+
+	/** Enemies in the same squad share what they see and hear. Spawners put the enemies they spawn in their own squad */
+	UPROPERTY(EditAnywhere, Category="Perception")
+	FName SquadName;
+
+	/** Handle on the perception subsystem */
+	int32 PerceptionHandle = INDEX_NONE;
+
+	/** If true, this enemy copies the pose of identical enemies in the same locomotion state instead of evaluating its own. Disable for unique anim graphs */
+	UPROPERTY(EditAnywhere, Category="Animation")
+	bool bShareAnimation = true;
+
+	/** Handle on the animation sharing subsystem */
+	int32 AnimSharingHandle = INDEX_NONE;
+
+	/** How our pose is currently evaluated */
+	ECombatAnimSharingRole AnimSharingRole = ECombatAnimSharingRole::Solo;
+
+	/** Current update tier */
+	ECombatSignificance Significance = ECombatSignificance::High;
+
+	/** Game time when damage was last received */
+	float LastDamageTime = -1000.0f;
+
+	/** Time this enemy has been idle and out of range of every player */
+	float SleepTimer = 0.0f;
+
 	/** Attack montage ended delegate */
 	FOnMontageEnded OnAttackMontageEnded;
 
@@ -173,6 +297,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category="Attacker")
 	virtual void CheckChargedAttack() override;
 
+	/** Returns true if attack events come from the attack timelines */
+	virtual bool UsesAttackTimeline() const override;
+
 	// ~end ICombatAttacker interface
 
 	// ~begin ICombatDamageable interface
@@ -193,6 +320,106 @@ protected:
 	/** Removes this character from the level after it dies */
 	void RemoveFromLevel();
 
+	/** Extracts the attack timelines from the attack montages */
+	void BuildAttackTimelines();
+
+	/** Starts streaming in the attack montages */
+	void PreloadAttackAssets();
+
+	/** Builds any missing attack timelines once the attack montages have streamed in */
+	void OnAttackAssetsLoaded();
+
+	/** Fires an attack timeline event */
+	void HandleAttackEvent(const FCombatAttackTimelineEvent& Event);
+
+	/** Sets the current HP and marks it dirty for replication, even while dormant */
+	void SetCurrentHP(float HP);
+
+	/** Sets the attacking flag and marks it dirty for replication, even while dormant */
+	void SetIsAttacking(bool bAttacking);
+
+	/** Sets the death state and marks it dirty for replication, even while dormant */
+	void SetIsDead(bool bDead);
+
+	/** Updates the life bar on clients when HP replicates */
+	UFUNCTION()
+	void OnRep_CurrentHP();
+
+	/** Hides or shows the life bar and capsule on clients when the death state replicates */
+	UFUNCTION()
+	void OnRep_IsDead();
+
+	/** Applies the mesh tick rate and animation budget registration for the current tier and sharing role */
+	void ApplyAnimationSettings();
+
+public:
+
+	/** Hides and disables this enemy so it can wait in the enemy pool */
+	void DeactivateForPool();
+
+	/** Resets this enemy to its freshly spawned state at the given transform and restarts its AI */
+	void ActivateFromPool(const FTransform& SpawnTransform);
+
+	/** Returns true if this enemy is waiting in the enemy pool */
+	bool IsInactiveInPool() const { return bInPool; }
+
+	/** Sets the current HP, e.g. when this enemy is brought back from the crowd */
+	void RestoreHP(float HP);
+
+	/** Reseeds the random stream used for attack choices */
+	void SeedAttackRandom(int32 Seed) { AttackRandom.Initialize(Seed); }
+
+	/** Returns the attack montages, so they can be streamed in before the enemy is spawned */
+	TArray<FSoftObjectPath> GetAttackAssetPaths() const { return { ComboAttackMontage.ToSoftObjectPath(), ChargedAttackMontage.ToSoftObjectPath() }; }
+
+	/** Returns the crowd proxy mesh */
+	UStaticMesh* GetCrowdProxyMesh() const { return CrowdProxyMesh; }
+
+	/** Returns the crowd movement speed */
+	float GetCrowdMoveSpeed() const { return CrowdMoveSpeed; }
+
+	/** Returns the max HP */
+	float GetMaxHP() const { return MaxHP; }
+
+	/** Applies the tick rates and life bar visibility for the given update tier */
+	void ApplySignificance(ECombatSignificance NewSignificance, bool bForce = false);
+
+	/** Returns the current update tier */
+	ECombatSignificance GetSignificance() const { return Significance; }
+
+	/** Returns the actor, mesh and StateTree tick interval for the current tier */
+	float GetSignificanceTickInterval() const;
+
+	/** Returns true if the enemy is playing an attack animation */
+	bool IsAttacking() const { return bIsAttacking; }
+
+	/** Returns true if the enemy is attacking or has been recently damaged */
+	bool IsEngagedInCombat() const;
+
+	/** Returns true if the enemy is idle enough to be put to sleep */
+	bool CanSleep() const;
+
+	/** Accumulates idle time while sleep is possible, or resets it. Returns the accumulated time */
+	float UpdateSleepTimer(bool bCanSleep, float DeltaTime);
+
+	/** Adapts the net update frequency to the current tier and combat engagement */
+	void UpdateNetUpdateFrequency();
+
+	/** Returns true if the enemy has died */
+	bool IsDead() const { return bIsDead; }
+
+	/** Sets how our pose is evaluated. Called by the animation sharing subsystem */
+	void SetAnimSharingRole(ECombatAnimSharingRole NewRole);
+
+	/** Returns the handle for perceived target queries */
+	int32 GetPerceptionHandle() const { return PerceptionHandle; }
+
+	/** Returns the squad this enemy shares what it senses with */
+	FName GetSquadName() const { return SquadName; }
+
+	/** Sets the squad this enemy shares what it senses with */
+	void SetSquadName(FName NewSquadName) { SquadName = NewSquadName; }
+
 public:
 
 	/** Overrides the default TakeDamage functionality */
@@ -201,6 +428,9 @@ public:
 	/** Overrides landing to reset damage ragdoll physics */
 	virtual void Landed(const FHitResult& Hit) override;
 
+	/** Registers the push-model replicated properties */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 protected:
 
 	/** Blueprint handler to play damage received effects */
@@ -214,4 +444,12 @@ protected:
 
 	/** EndPlay cleanup */
 	virtual void EndPlay(EEndPlayReason::Type EndPlayReason) override;
+
+	/** Extracts the attack timelines so they're cooked with this class */
+	virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
+
+public:
+
+	/** Advances the attack timeline */
+	virtual void Tick(float DeltaSeconds) override;
 };
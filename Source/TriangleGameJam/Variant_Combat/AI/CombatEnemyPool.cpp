@@ -0,0 +1,129 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatEnemyPool.h"
+#include "CombatEnemy.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<bool> CVarEnemyPoolEnabled(
+	TEXT("Combat.EnemyPool.Enabled"),
+	true,
+	TEXT("If true, dead enemies are reset and reused instead of being destroyed and spawned again."),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorldAndArgs EnemyPoolStatsCommand(
+	TEXT("Combat.EnemyPool.Stats"),
+	TEXT("Logs the number of pooled and created enemies per class."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UCombatEnemyPool::DumpStats)
+);
+
+void UCombatEnemyPool::Prewarm(TSubclassOf<ACombatEnemy> EnemyClass, int32 Count, const FTransform& StorageTransform)
+{
+	if (!IsPoolingEnabled() || !IsValid(EnemyClass))
+	{
+		return;
+	}
+
+	FCombatEnemyPoolBucket& Bucket = Buckets.FindOrAdd(EnemyClass);
+	Bucket.InactiveEnemies.Reserve(Bucket.InactiveEnemies.Num() + Count);
+
+	for (int32 i = 0; i < Count; ++i)
+	{
+		if (ACombatEnemy* Enemy = SpawnEnemy(EnemyClass, StorageTransform))
+		{
+			// park the enemy until it's needed
+			Enemy->DeactivateForPool();
+			Bucket.InactiveEnemies.Add(Enemy);
+		}
+	}
+}
+
+ACombatEnemy* UCombatEnemyPool::Acquire(TSubclassOf<ACombatEnemy> EnemyClass, const FTransform& SpawnTransform)
+{
+	if (!IsValid(EnemyClass))
+	{
+		return nullptr;
+	}
+
+	if (IsPoolingEnabled())
+	{
+		if (FCombatEnemyPoolBucket* Bucket = Buckets.Find(EnemyClass))
+		{
+			// reuse the most recently released enemy
+			while (Bucket->InactiveEnemies.Num() > 0)
+			{
+				ACombatEnemy* Enemy = Bucket->InactiveEnemies.Pop(EAllowShrinking::No);
+
+				// skip enemies that were destroyed behind the pool's back, e.g. by level streaming
+				if (IsValid(Enemy))
+				{
+					Enemy->ActivateFromPool(SpawnTransform);
+					return Enemy;
+				}
+			}
+		}
+
+		UE_LOG(LogTriangleGameJam, Verbose, TEXT("Enemy pool for %s is empty, spawning a new enemy"), *GetNameSafe(EnemyClass));
+	}
+
+	return SpawnEnemy(EnemyClass, SpawnTransform);
+}
+
+bool UCombatEnemyPool::Release(ACombatEnemy* Enemy)
+{
+	if (!IsPoolingEnabled() || !IsValid(Enemy))
+	{
+		return false;
+	}
+
+	Enemy->DeactivateForPool();
+
+	Buckets.FindOrAdd(Enemy->GetClass()).InactiveEnemies.Add(Enemy);
+
+	return true;
+}
+
+bool UCombatEnemyPool::IsPoolingEnabled()
+{
+	return CVarEnemyPoolEnabled.GetValueOnGameThread();
+}
+
+void UCombatEnemyPool::DumpStats(const TArray<FString>& Args, UWorld* World)
+{
+	const UCombatEnemyPool* Pool = World ? World->GetSubsystem<UCombatEnemyPool>() : nullptr;
+
+	if (!Pool)
+	{
+		return;
+	}
+
+	for (const TPair<TSubclassOf<ACombatEnemy>, FCombatEnemyPoolBucket>& Pair : Pool->Buckets)
+	{
+		UE_LOG(LogTriangleGameJam, Display, TEXT("%s: %d inactive, %d created"), *GetNameSafe(Pair.Key), Pair.Value.InactiveEnemies.Num(), Pair.Value.NumCreated);
+	}
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("UObjects: %d"), GUObjectArray.GetObjectArrayNumMinusAvailable());
+}
+
+ACombatEnemy* UCombatEnemyPool::SpawnEnemy(TSubclassOf<ACombatEnemy> EnemyClass, const FTransform& SpawnTransform)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	ACombatEnemy* Enemy = GetWorld()->SpawnActor<ACombatEnemy>(EnemyClass, SpawnTransform, SpawnParams);
+
+	if (Enemy)
+	{
+		++Buckets.FindOrAdd(EnemyClass).NumCreated;
+	}
+
+	return Enemy;
+}
+
+bool UCombatEnemyPool::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,67 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatEnemyPool.generated.h"
+
+class ACombatEnemy;
+
+/**
+ *  Inactive enemies of a single class, ready to be reactivated
+ */
+USTRUCT()
+struct FCombatEnemyPoolBucket
+{
+	GENERATED_BODY()
+
+	/** Deactivated enemies waiting to be reused */
+	UPROPERTY()
+	TArray<TObjectPtr<ACombatEnemy>> InactiveEnemies;
+
+	/** Total number of enemies of this class created by the pool */
+	int32 NumCreated = 0;
+};
+
+/**
+ *  Per-class pool of combat enemies.
+ *  Dead enemies are reset in place and reactivated instead of being destroyed and spawned again,
+ *  which avoids rebuilding their AI controller, StateTree, life bar widget, anim instance and physics bodies.
+ */
+UCLASS()
+class UCombatEnemyPool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Inactive enemies, per class */
+	UPROPERTY()
+	TMap<TSubclassOf<ACombatEnemy>, FCombatEnemyPoolBucket> Buckets;
+
+public:
+
+	/** Creates enemies of the given class ahead of time and keeps them deactivated */
+	void Prewarm(TSubclassOf<ACombatEnemy> EnemyClass, int32 Count, const FTransform& StorageTransform);
+
+	/** Reactivates a pooled enemy at the given transform, or spawns a new one if the pool for its class is empty */
+	ACombatEnemy* Acquire(TSubclassOf<ACombatEnemy> EnemyClass, const FTransform& SpawnTransform);
+
+	/** Deactivates an enemy and returns it to the pool. Returns false if pooling is disabled and the enemy should be destroyed instead */
+	bool Release(ACombatEnemy* Enemy);
+
+	/** Returns true if enemy pooling is enabled */
+	static bool IsPoolingEnabled();
+
+	/** Logs the pool contents. Bound to the Combat.EnemyPool.Stats console command */
+	static void DumpStats(const TArray<FString>& Args, UWorld* World);
+
+protected:
+
+	/** Spawns a brand new enemy */
+	ACombatEnemy* SpawnEnemy(TSubclassOf<ACombatEnemy> EnemyClass, const FTransform& SpawnTransform);
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+};
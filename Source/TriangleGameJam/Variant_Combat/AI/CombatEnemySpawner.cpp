@@ -7,6 +7,10 @@
 #include "Components/ArrowComponent.h"
 #include "TimerManager.h"
 #include "CombatEnemy.h"
+#include "CombatEnemyPool.h"
+#include "CombatWaveDirector.h"
+#include "CombatSignificanceSubsystem.h"
+#include "CombatCrowdSubsystem.h"
 
 ACombatEnemySpawner::ACombatEnemySpawner()
 {
@@ -30,12 +34,34 @@ ACombatEnemySpawner::ACombatEnemySpawner()
 void ACombatEnemySpawner::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// enemies are only spawned on the server and replicated to clients
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	UCombatWaveDirector* WaveDirector = GetWorld()->GetSubsystem<UCombatWaveDirector>();
+	check(WaveDirector);
+
+	// start loading the enemy class so it's resident before the first wave is due
+	WaveDirector->LoadEnemyClass(EnemyClass);
+
+	// create our enemies up front so spawning them later doesn't hitch.
+	// These go through the wave director so several spawners don't all prewarm on the same frame
+	if (UCombatEnemyPool::IsPoolingEnabled())
+	{
+		for (int32 i = 0; i < FMath::Min(PoolPrewarmCount, SpawnCount); ++i)
+		{
+			WaveDirector->RequestSpawn(this, true);
+		}
+	}
 	
 	// should we spawn an enemy right away?
 	if (bShouldSpawnEnemiesImmediately)
 	{
 		// schedule the first enemy spawn
-		GetWorld()->GetTimerManager().SetTimer(SpawnTimer, this, &ACombatEnemySpawner::SpawnEnemy, InitialSpawnDelay);
+		GetWorld()->GetTimerManager().SetTimer(SpawnTimer, this, &ACombatEnemySpawner::QueueSpawn, InitialSpawnDelay);
 	}
 
 }
@@ -48,26 +74,158 @@ void ACombatEnemySpawner::EndPlay(EEndPlayReason::Type EndPlayReason)
 	GetWorld()->GetTimerManager().ClearTimer(SpawnTimer);
 }
 
+void ACombatEnemySpawner::QueueSpawn()
+{
+	// hold the spawn until we're resumed
+	if (bSuspended)
+	{
+		bSpawnDeferred = true;
+		return;
+	}
+
+	// let the wave director fit the spawn into its frame budget
+	if (UCombatWaveDirector* WaveDirector = GetWorld()->GetSubsystem<UCombatWaveDirector>())
+	{
+		WaveDirector->RequestSpawn(this);
+	}
+}
+
+bool ACombatEnemySpawner::IsEnemyClassLoaded() const
+{
+	return EnemyClass.Get() != nullptr;
+}
+
+void ACombatEnemySpawner::PrewarmEnemy()
+{
+	if (UCombatEnemyPool* EnemyPool = GetWorld()->GetSubsystem<UCombatEnemyPool>())
+	{
+		EnemyPool->Prewarm(EnemyClass.Get(), 1, SpawnCapsule->GetComponentTransform());
+	}
+}
+
 void ACombatEnemySpawner::SpawnEnemy()
 {
-	// ensure the enemy class is valid
-	if (IsValid(EnemyClass))
+	// only the server spawns enemies
+	if (!HasAuthority())
 	{
-		// spawn the enemy at the reference capsule's transform
-		FActorSpawnParameters SpawnParams;
-		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+		return;
+	}
 
-		ACombatEnemy* SpawnedEnemy = GetWorld()->SpawnActor<ACombatEnemy>(EnemyClass, SpawnCapsule->GetComponentTransform(), SpawnParams);
+	// the wave director may have queued us before we were suspended
+	if (bSuspended)
+	{
+		bSpawnDeferred = true;
+		return;
+	}
+
+	// ensure the enemy class is loaded
+	if (IsEnemyClassLoaded())
+	{
+		// crowd spawners add all of their enemies at once
+		if (bSpawnIntoCrowd)
+		{
+			SpawnCrowd();
+			return;
+		}
+
+		// get an enemy from the pool at the reference capsule's transform
+		UCombatEnemyPool* EnemyPool = GetWorld()->GetSubsystem<UCombatEnemyPool>();
+		check(EnemyPool);
+
+		ACombatEnemy* SpawnedEnemy = EnemyPool->Acquire(EnemyClass.Get(), SpawnCapsule->GetComponentTransform());
 
 		// was the enemy successfully created?
 		if (SpawnedEnemy)
 		{
 			// subscribe to the death delegate
 			SpawnedEnemy->OnEnemyDied.AddDynamic(this, &ACombatEnemySpawner::OnEnemyDied);
+
+			// enemies from the same spawner share what they see and hear
+			SpawnedEnemy->SetSquadName(GetFName());
 		}
 	}
 }
 
+void ACombatEnemySpawner::SpawnCrowd()
+{
+	UCombatCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UCombatCrowdSubsystem>();
+	check(Crowd);
+
+	// each enemy reports its death back to us once it becomes a full actor
+	FOnEnemyDied OnDied;
+	OnDied.AddDynamic(this, &ACombatEnemySpawner::OnEnemyDied);
+
+	const FTransform SpawnTransform = SpawnCapsule->GetComponentTransform();
+
+	for (int32 i = 0; i < SpawnCount; ++i)
+	{
+		// scatter the enemies around the spawner
+		const FVector2D Offset = FMath::RandPointInCircle(CrowdSpawnRadius);
+
+		FTransform EnemyTransform = SpawnTransform;
+		EnemyTransform.AddToTranslation(FVector(Offset.X, Offset.Y, 0.0f));
+
+		Crowd->AddEnemy(EnemyClass.Get(), EnemyTransform, GetFName(), OnDied);
+	}
+}
+
+void ACombatEnemySpawner::SetSuspended(bool bSuspend)
+{
+	bSuspended = bSuspend;
+
+	// catch up on the spawn we held back
+	if (!bSuspended && bSpawnDeferred)
+	{
+		bSpawnDeferred = false;
+		QueueSpawn();
+	}
+}
+
+int32 ACombatEnemySpawner::SpawnBenchmarkEnemies(int32 Count, float ScatterRadius, FRandomStream& Random)
+{
+	// only the server spawns enemies
+	if (!HasAuthority())
+	{
+		return 0;
+	}
+
+	// the benchmark can't wait for the background load
+	UClass* LoadedEnemyClass = EnemyClass.LoadSynchronous();
+
+	if (!LoadedEnemyClass)
+	{
+		return 0;
+	}
+
+	UCombatEnemyPool* EnemyPool = GetWorld()->GetSubsystem<UCombatEnemyPool>();
+	check(EnemyPool);
+
+	const FTransform SpawnTransform = SpawnCapsule->GetComponentTransform();
+	int32 NumSpawned = 0;
+
+	for (int32 i = 0; i < Count; ++i)
+	{
+		// scatter the enemies around the spawner from the benchmark's random stream
+		const float Angle = Random.FRandRange(0.0f, UE_TWO_PI);
+		const float Distance = ScatterRadius * FMath::Sqrt(Random.FRand());
+
+		FTransform EnemyTransform = SpawnTransform;
+		EnemyTransform.AddToTranslation(FVector(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance, 0.0f));
+
+		if (ACombatEnemy* SpawnedEnemy = EnemyPool->Acquire(LoadedEnemyClass, EnemyTransform))
+		{
+			// give each enemy its own deterministic attack sequence
+			SpawnedEnemy->SeedAttackRandom(static_cast<int32>(Random.GetUnsignedInt()));
+
+			// enemies from the same spawner share what they see and hear
+			SpawnedEnemy->SetSquadName(GetFName());
+			++NumSpawned;
+		}
+	}
+
+	return NumSpawned;
+}
+
 void ACombatEnemySpawner::OnEnemyDied()
 {
 	// decrease the spawn counter
@@ -81,8 +239,14 @@ void ACombatEnemySpawner::OnEnemyDied()
 		return;
 	}
 
+	// crowd enemies were all spawned up front
+	if (bSpawnIntoCrowd)
+	{
+		return;
+	}
+
 	// schedule the next enemy spawn
-	GetWorld()->GetTimerManager().SetTimer(SpawnTimer, this, &ACombatEnemySpawner::SpawnEnemy, RespawnDelay);
+	GetWorld()->GetTimerManager().SetTimer(SpawnTimer, this, &ACombatEnemySpawner::QueueSpawn, RespawnDelay);
 }
 
 void ACombatEnemySpawner::SpawnerDepleted()
@@ -106,8 +270,8 @@ void ACombatEnemySpawner::ToggleInteraction(AActor* ActivationInstigator)
 
 void ACombatEnemySpawner::ActivateInteraction(AActor* ActivationInstigator)
 {
-	// ensure we're only activated once, and only if we've deferred enemy spawning
-	if (bHasBeenActivated || bShouldSpawnEnemiesImmediately)
+	// ensure we're only activated once, only if we've deferred enemy spawning, and only on the server
+	if (bHasBeenActivated || bShouldSpawnEnemiesImmediately || !HasAuthority())
 	{
 		return;
 	}
@@ -115,8 +279,14 @@ void ACombatEnemySpawner::ActivateInteraction(AActor* ActivationInstigator)
 	// raise the activation flag
 	bHasBeenActivated = true;
 
-	// spawn the first enemy
-	SpawnEnemy();
+	// wake up any sleeping enemies around us so they join the fight
+	if (UCombatSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UCombatSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->WakeEnemiesInRadius(GetActorLocation(), WakeRadius);
+	}
+
+	// queue the first enemy spawn
+	QueueSpawn();
 }
 
 void ACombatEnemySpawner::DeactivateInteraction(AActor* ActivationInstigator)
@@ -10,6 +10,7 @@
 class UCapsuleComponent;
 class UArrowComponent;
 class ACombatEnemy;
+struct FRandomStream;
 
 /**
  *  A basic Actor in charge of spawning Enemy Characters and monitoring their deaths.
@@ -30,9 +31,9 @@ class ACombatEnemySpawner : public AActor, public ICombatActivatable
 
 protected:
 
-	/** Type of enemy to spawn */
+	/** Type of enemy to spawn. Loaded in the background when play begins */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Enemy Spawner")
-	TSubclassOf<ACombatEnemy> EnemyClass;
+	TSoftClassPtr<ACombatEnemy> EnemyClass;
 
 	/** If true, the first enemy will be spawned as soon as the game starts */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Enemy Spawner")
@@ -43,13 +44,29 @@ protected:
 	float InitialSpawnDelay = 5.0f;
 
 	/** Number of enemies to spawn */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Enemy Spawner", meta = (ClampMin = 0, ClampMax = 100))
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Enemy Spawner", meta = (ClampMin = 0, ClampMax = 2000))
 	int32 SpawnCount = 1;
 
 	/** Time to wait before spawning the next enemy after the current one dies */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Enemy Spawner", meta = (ClampMin = 0, ClampMax = 10))
 	float RespawnDelay = 5.0f;
 
+	/** If true, all enemies are added to the crowd at once as lightweight entities, and only become full actors when players come close */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Enemy Spawner|Crowd")
+	bool bSpawnIntoCrowd = false;
+
+	/** Radius around the spawner that crowd enemies are scattered in */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Enemy Spawner|Crowd", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm", EditCondition = "bSpawnIntoCrowd"))
+	float CrowdSpawnRadius = 2000.0f;
+
+	/** Number of enemies to create ahead of time for the enemy pool when the level loads */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Enemy Spawner", meta = (ClampMin = 0, ClampMax = 10))
+	int32 PoolPrewarmCount = 2;
+
+	/** Sleeping enemies within this distance are woken up when the spawner is activated */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Activation", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm"))
+	float WakeRadius = 3000.0f;
+
 	/** Time to wait after this spawner is depleted before activating the actor list */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Activation", meta = (ClampMin = 0, ClampMax = 10))
 	float ActivationDelay = 1.0f;
@@ -61,6 +78,12 @@ protected:
 	/** Flag to ensure this is only activated once */
 	bool bHasBeenActivated = false;
 
+	/** If true, spawns are held back until the spawner is resumed, e.g. while the combat benchmark runs */
+	bool bSuspended = false;
+
+	/** If true, a spawn came due while suspended and is queued once the spawner resumes */
+	bool bSpawnDeferred = false;
+
 	/** Timer to spawn enemies after a delay */
 	FTimerHandle SpawnTimer;
 
@@ -79,9 +102,36 @@ public:
 
 protected:
 
-	/** Spawn an enemy and subscribe to its death event */
+	/** Asks the wave director to schedule an enemy spawn */
+	void QueueSpawn();
+
+public:
+
+	/** Returns true if the enemy class has finished loading */
+	bool IsEnemyClassLoaded() const;
+
+	/** Returns the type of enemy to spawn */
+	const TSoftClassPtr<ACombatEnemy>& GetEnemyClass() const { return EnemyClass; }
+
+	/** Spawn an enemy, reusing a pooled one if possible, and subscribe to its death event. Called by the wave director */
 	void SpawnEnemy();
 
+	/** Creates an inactive enemy for the enemy pool. Called by the wave director */
+	void PrewarmEnemy();
+
+	/** Holds back or resumes the spawner's own spawns and respawns. Spawns that came due while suspended are queued on resume */
+	void SetSuspended(bool bSuspend);
+
+	/** Spawns a number of enemies scattered around the spawner for the combat benchmark. Returns the number spawned */
+	int32 SpawnBenchmarkEnemies(int32 Count, float ScatterRadius, FRandomStream& Random);
+
+protected:
+
+	/** Adds all our enemies to the crowd */
+	void SpawnCrowd();
+
+protected:
+
 	/** Called when the spawned enemy has died */
 	UFUNCTION()
 	void OnEnemyDied();
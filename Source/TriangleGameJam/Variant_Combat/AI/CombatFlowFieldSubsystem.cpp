@@ -0,0 +1,494 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatFlowFieldSubsystem.h"
+#include "CombatTargetCache.h"
+#include "CombatSignificanceSubsystem.h"
+#include "CombatEnemy.h"
+#include "CombatEnemySpawner.h"
+#include "GameFramework/Pawn.h"
+#include "NavigationSystem.h"
+#include "NavMesh/NavMeshBoundsVolume.h"
+#include "EngineUtils.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<bool> CVarFlowFieldEnabled(
+	TEXT("Combat.FlowField.Enabled"),
+	true,
+	TEXT("If true, chasing enemies follow the shared flow field instead of running their own path queries."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarFlowFieldCellSize(
+	TEXT("Combat.FlowField.CellSize"),
+	100.0f,
+	TEXT("Edge length of the flow field grid cells. Only read when the grid is built."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarFlowFieldMaxCells(
+	TEXT("Combat.FlowField.MaxCells"),
+	262144,
+	TEXT("Maximum number of grid cells. Cells are enlarged to fit large nav bounds."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarFlowFieldCellsPerFrame(
+	TEXT("Combat.FlowField.CellsPerFrame"),
+	8192,
+	TEXT("Maximum number of cells expanded by the flow field builds each frame."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarFlowFieldSamplesPerFrame(
+	TEXT("Combat.FlowField.SamplesPerFrame"),
+	256,
+	TEXT("Maximum number of grid cells tested against the nav mesh each frame while the grid is being built."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarFlowFieldMaxHeightDifference(
+	TEXT("Combat.FlowField.MaxHeightDifference"),
+	60.0f,
+	TEXT("Neighboring cells with a larger nav mesh height difference than this are not connected."),
+	ECVF_Default
+);
+
+/** Neighbor offsets, orthogonal first */
+static const FIntPoint FlowFieldNeighbors[] = {
+	FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1),
+	FIntPoint(1, 1), FIntPoint(1, -1), FIntPoint(-1, 1), FIntPoint(-1, -1)
+};
+
+bool UCombatFlowFieldSubsystem::SampleDirection(const FVector& Location, FVector& OutDirection, float& OutDistance) const
+{
+	const int32 CellIndex = WorldToCell(Location);
+
+	if (CellIndex == INDEX_NONE || !Walkable[CellIndex])
+	{
+		return false;
+	}
+
+	// pick the field that leads to the closest player by path distance
+	const FCombatFlowField* BestField = nullptr;
+	float BestDistance = UE_BIG_NUMBER;
+
+	for (const FCombatFlowField& Field : Fields)
+	{
+		if (Field.bValid && Field.Distances[CellIndex] < BestDistance)
+		{
+			BestField = &Field;
+			BestDistance = Field.Distances[CellIndex];
+		}
+	}
+
+	return BestField && SampleField(*BestField, CellIndex, Location, OutDirection, OutDistance);
+}
+
+bool UCombatFlowFieldSubsystem::SampleDirectionTowards(const AActor* Target, const FVector& Location, FVector& OutDirection, float& OutDistance) const
+{
+	const int32 CellIndex = WorldToCell(Location);
+
+	if (!Target || CellIndex == INDEX_NONE || !Walkable[CellIndex])
+	{
+		return false;
+	}
+
+	const FCombatFlowField* Field = Fields.FindByPredicate([Target](const FCombatFlowField& Candidate) { return Candidate.Target.Get() == Target; });
+
+	return Field && Field->bValid && SampleField(*Field, CellIndex, Location, OutDirection, OutDistance);
+}
+
+bool UCombatFlowFieldSubsystem::SampleField(const FCombatFlowField& Field, int32 CellIndex, const FVector& Location, FVector& OutDirection, float& OutDistance) const
+{
+	if (Field.Distances[CellIndex] >= UE_BIG_NUMBER)
+	{
+		return false;
+	}
+
+	OutDistance = Field.Distances[CellIndex] * CellSize;
+
+	// head straight for the player once we're next to it, otherwise for the next cell along the field
+	const int32 NextCell = Field.NextCells[CellIndex];
+	const FVector Destination = (CellIndex == Field.GoalCell || NextCell == Field.GoalCell || NextCell == INDEX_NONE) ? Field.GoalLocation : CellToWorld(NextCell);
+
+	OutDirection = (Destination - Location).GetSafeNormal2D();
+
+	return !OutDirection.IsNearlyZero();
+}
+
+bool UCombatFlowFieldSubsystem::SampleHeight(const FVector& Location, float& OutHeight) const
+{
+	const int32 CellIndex = WorldToCell(Location);
+
+	if (CellIndex == INDEX_NONE || !Walkable[CellIndex])
+	{
+		return false;
+	}
+
+	OutHeight = Heights[CellIndex];
+
+	return true;
+}
+
+bool UCombatFlowFieldSubsystem::IsFlowFieldEnabled()
+{
+	return CVarFlowFieldEnabled.GetValueOnGameThread();
+}
+
+void UCombatFlowFieldSubsystem::InitializeGrid()
+{
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	// wait for the nav mesh
+	if (!NavSys || !NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate))
+	{
+		return;
+	}
+
+	// cover every nav mesh bounds volume in the level
+	FBox Bounds(ForceInit);
+
+	for (TActorIterator<ANavMeshBoundsVolume> It(GetWorld()); It; ++It)
+	{
+		Bounds += It->GetComponentsBoundingBox(true);
+	}
+
+	bGridInitialized = true;
+
+	if (!Bounds.IsValid)
+	{
+		UE_LOG(LogTriangleGameJam, Warning, TEXT("Combat flow field: no nav mesh bounds volumes found, enemies will use regular path following."));
+		return;
+	}
+
+	// enlarge the cells if the bounds would need too many
+	const FVector Size = Bounds.GetSize();
+	const int32 MaxCells = FMath::Max(1, CVarFlowFieldMaxCells.GetValueOnGameThread());
+
+	CellSize = FMath::Max(10.0f, CVarFlowFieldCellSize.GetValueOnGameThread());
+	CellSize = FMath::Max(CellSize, FMath::Sqrt(Size.X * Size.Y / MaxCells));
+
+	GridSize.X = FMath::Max(1, FMath::CeilToInt(Size.X / CellSize));
+	GridSize.Y = FMath::Max(1, FMath::CeilToInt(Size.Y / CellSize));
+	GridOrigin = FVector(Bounds.Min.X, Bounds.Min.Y, Bounds.GetCenter().Z);
+	GridHalfHeight = Size.Z * 0.5f;
+
+	const int32 NumCells = GridSize.X * GridSize.Y;
+
+	Walkable.Init(false, NumCells);
+	Heights.Init(0.0f, NumCells);
+	NumCellsSampled = 0;
+	Fields.Reset();
+
+	UE_LOG(LogTriangleGameJam, Log, TEXT("Combat flow field: %d x %d cells of %.0f cm"), GridSize.X, GridSize.Y, CellSize);
+}
+
+void UCombatFlowFieldSubsystem::SampleCells(int32 MaxCells)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatFlowFieldSubsystem::SampleCells);
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	if (!NavSys)
+	{
+		return;
+	}
+
+	const FVector QueryExtent(CellSize * 0.5f, CellSize * 0.5f, GridHalfHeight);
+	const int32 LastCell = FMath::Min(Walkable.Num(), NumCellsSampled + MaxCells);
+
+	for (; NumCellsSampled < LastCell; ++NumCellsSampled)
+	{
+		FNavLocation NavLocation;
+
+		if (NavSys->ProjectPointToNavigation(CellToWorld(NumCellsSampled), NavLocation, QueryExtent))
+		{
+			Walkable[NumCellsSampled] = true;
+			Heights[NumCellsSampled] = NavLocation.Location.Z;
+		}
+	}
+}
+
+void UCombatFlowFieldSubsystem::UpdateFields(int32 MaxCells)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatFlowFieldSubsystem::UpdateFields);
+
+	UCombatTargetCache* TargetCache = GetWorld()->GetSubsystem<UCombatTargetCache>();
+	check(TargetCache);
+
+	const TArray<TWeakObjectPtr<APawn>>& TargetPawns = TargetCache->GetTargetPawns();
+	const TArray<FVector>& TargetLocations = TargetCache->GetTargetLocations();
+
+	// drop the fields of players that have left. The other fields stay with their players
+	Fields.RemoveAllSwap([&TargetPawns](const FCombatFlowField& Field) { return !TargetPawns.Contains(Field.Target); });
+
+	for (int32 TargetIndex = 0; TargetIndex < TargetPawns.Num(); ++TargetIndex)
+	{
+		FCombatFlowField* ExistingField = Fields.FindByPredicate([&TargetPawns, TargetIndex](const FCombatFlowField& Candidate) { return Candidate.Target == TargetPawns[TargetIndex]; });
+
+		// players that just joined get a new field, which can be used once its first build completes
+		if (!ExistingField)
+		{
+			ExistingField = &Fields.AddDefaulted_GetRef();
+			ExistingField->Target = TargetPawns[TargetIndex];
+		}
+
+		FCombatFlowField& Field = *ExistingField;
+		const FVector& TargetLocation = TargetLocations[TargetIndex];
+		const int32 TargetCell = WorldToCell(TargetLocation);
+
+		// keep the last field while the player is off the grid or in the air over an unwalkable cell
+		if (TargetCell == INDEX_NONE || !Walkable[TargetCell])
+		{
+			continue;
+		}
+
+		// let the current build finish instead of restarting it every time the player crosses a cell,
+		// or it may never complete. The next build picks up the player's latest cell
+		if (Field.bBuilding)
+		{
+			if (TargetCell == Field.BuildGoalCell)
+			{
+				Field.BuildGoalLocation = TargetLocation;
+			}
+
+			continue;
+		}
+
+		// the player is still in the cell the field was built for
+		if (TargetCell == Field.GoalCell)
+		{
+			Field.GoalLocation = TargetLocation;
+			continue;
+		}
+
+		// start a new build towards the player's cell. The current field stays in use until it completes
+		Field.BuildGoalCell = TargetCell;
+		Field.BuildGoalLocation = TargetLocation;
+		Field.BuildDistances.Init(UE_BIG_NUMBER, Walkable.Num());
+		Field.BuildDistances[TargetCell] = 0.0f;
+		Field.Frontier.Reset();
+		Field.Frontier.HeapPush(FCombatFlowFieldNode{ 0.0f, TargetCell });
+		Field.bBuilding = true;
+	}
+
+	// share the per-frame budget across the fields being built
+	int32 CellsLeft = MaxCells;
+
+	for (FCombatFlowField& Field : Fields)
+	{
+		if (!Field.bBuilding || CellsLeft <= 0)
+		{
+			continue;
+		}
+
+		CellsLeft -= ExpandField(Field, CellsLeft);
+
+		if (Field.Frontier.Num() == 0)
+		{
+			FinishField(Field);
+		}
+	}
+}
+
+int32 UCombatFlowFieldSubsystem::ExpandField(FCombatFlowField& Field, int32 MaxCells) const
+{
+	int32 NumProcessed = 0;
+
+	while (Field.Frontier.Num() > 0 && NumProcessed < MaxCells)
+	{
+		FCombatFlowFieldNode Node;
+		Field.Frontier.HeapPop(Node, EAllowShrinking::No);
+
+		// skip stale entries for cells that were reached by a shorter path since they were pushed
+		if (Node.Distance > Field.BuildDistances[Node.CellIndex])
+		{
+			continue;
+		}
+
+		++NumProcessed;
+
+		const FIntPoint Cell(Node.CellIndex % GridSize.X, Node.CellIndex / GridSize.X);
+
+		for (int32 NeighborIndex = 0; NeighborIndex < UE_ARRAY_COUNT(FlowFieldNeighbors); ++NeighborIndex)
+		{
+			const FIntPoint& Offset = FlowFieldNeighbors[NeighborIndex];
+			const FIntPoint Neighbor = Cell + Offset;
+
+			if (Neighbor.X < 0 || Neighbor.Y < 0 || Neighbor.X >= GridSize.X || Neighbor.Y >= GridSize.Y)
+			{
+				continue;
+			}
+
+			const int32 NeighborCell = Neighbor.Y * GridSize.X + Neighbor.X;
+
+			if (!CanTraverse(Node.CellIndex, NeighborCell))
+			{
+				continue;
+			}
+
+			// don't cut corners around unwalkable cells
+			const bool bDiagonal = Offset.X != 0 && Offset.Y != 0;
+
+			if (bDiagonal && (!CanTraverse(Node.CellIndex, Cell.Y * GridSize.X + Neighbor.X) || !CanTraverse(Node.CellIndex, Neighbor.Y * GridSize.X + Cell.X)))
+			{
+				continue;
+			}
+
+			const float NewDistance = Node.Distance + (bDiagonal ? UE_SQRT_2 : 1.0f);
+
+			if (NewDistance < Field.BuildDistances[NeighborCell])
+			{
+				Field.BuildDistances[NeighborCell] = NewDistance;
+				Field.Frontier.HeapPush(FCombatFlowFieldNode{ NewDistance, NeighborCell });
+			}
+		}
+	}
+
+	return NumProcessed;
+}
+
+void UCombatFlowFieldSubsystem::FinishField(FCombatFlowField& Field) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatFlowFieldSubsystem::FinishField);
+
+	Field.Distances = MoveTemp(Field.BuildDistances);
+	Field.GoalCell = Field.BuildGoalCell;
+	Field.GoalLocation = Field.BuildGoalLocation;
+	Field.NextCells.SetNumUninitialized(Field.Distances.Num());
+	Field.Frontier.Empty();
+	Field.bBuilding = false;
+	Field.bValid = true;
+
+	// point every reachable cell at its neighbor closest to the goal. Each iteration only writes its own cell
+	ParallelFor(TEXT("CombatFlowFieldDirections"), Field.Distances.Num(), 1024,
+		[&](int32 CellIndex)
+		{
+			int32 BestCell = INDEX_NONE;
+			float BestDistance = Field.Distances[CellIndex];
+
+			if (BestDistance < UE_BIG_NUMBER)
+			{
+				const FIntPoint Cell(CellIndex % GridSize.X, CellIndex / GridSize.X);
+
+				for (const FIntPoint& Offset : FlowFieldNeighbors)
+				{
+					const FIntPoint Neighbor = Cell + Offset;
+
+					if (Neighbor.X < 0 || Neighbor.Y < 0 || Neighbor.X >= GridSize.X || Neighbor.Y >= GridSize.Y)
+					{
+						continue;
+					}
+
+					const int32 NeighborCell = Neighbor.Y * GridSize.X + Neighbor.X;
+
+					if (Field.Distances[NeighborCell] >= BestDistance || !CanTraverse(CellIndex, NeighborCell))
+					{
+						continue;
+					}
+
+					if (Offset.X != 0 && Offset.Y != 0 && (!CanTraverse(CellIndex, Cell.Y * GridSize.X + Neighbor.X) || !CanTraverse(CellIndex, Neighbor.Y * GridSize.X + Cell.X)))
+					{
+						continue;
+					}
+
+					BestCell = NeighborCell;
+					BestDistance = Field.Distances[NeighborCell];
+				}
+			}
+
+			Field.NextCells[CellIndex] = BestCell;
+		});
+}
+
+int32 UCombatFlowFieldSubsystem::WorldToCell(const FVector& Location) const
+{
+	if (!IsGridReady())
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 X = FMath::FloorToInt((Location.X - GridOrigin.X) / CellSize);
+	const int32 Y = FMath::FloorToInt((Location.Y - GridOrigin.Y) / CellSize);
+
+	if (X < 0 || Y < 0 || X >= GridSize.X || Y >= GridSize.Y)
+	{
+		return INDEX_NONE;
+	}
+
+	return Y * GridSize.X + X;
+}
+
+FVector UCombatFlowFieldSubsystem::CellToWorld(int32 CellIndex) const
+{
+	const int32 X = CellIndex % GridSize.X;
+	const int32 Y = CellIndex / GridSize.X;
+
+	// unsampled cells use the vertical center of the nav bounds
+	const float Z = CellIndex < NumCellsSampled && Walkable[CellIndex] ? Heights[CellIndex] : GridOrigin.Z;
+
+	return FVector(GridOrigin.X + (X + 0.5f) * CellSize, GridOrigin.Y + (Y + 0.5f) * CellSize, Z);
+}
+
+bool UCombatFlowFieldSubsystem::CanTraverse(int32 FromCell, int32 ToCell) const
+{
+	return Walkable[FromCell] && Walkable[ToCell] && FMath::Abs(Heights[FromCell] - Heights[ToCell]) <= CVarFlowFieldMaxHeightDifference.GetValueOnAnyThread();
+}
+
+bool UCombatFlowFieldSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatFlowFieldSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	bHasCombatEnemies = TActorIterator<ACombatEnemySpawner>(&InWorld) || TActorIterator<ACombatEnemy>(&InWorld);
+}
+
+void UCombatFlowFieldSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!IsFlowFieldEnabled())
+	{
+		return;
+	}
+
+	// don't pay for the grid in levels without combat enemies, unless some get spawned later
+	if (!bHasCombatEnemies)
+	{
+		const UCombatSignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UCombatSignificanceSubsystem>();
+		bHasCombatEnemies = Significance && Significance->GetNumEnemies() > 0;
+
+		if (!bHasCombatEnemies)
+		{
+			return;
+		}
+	}
+
+	if (!bGridInitialized)
+	{
+		InitializeGrid();
+		return;
+	}
+
+	// finish sampling the nav mesh before building any fields
+	if (!IsGridReady())
+	{
+		SampleCells(FMath::Max(1, CVarFlowFieldSamplesPerFrame.GetValueOnGameThread()));
+		return;
+	}
+
+	UpdateFields(FMath::Max(1, CVarFlowFieldCellsPerFrame.GetValueOnGameThread()));
+}
+
+TStatId UCombatFlowFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatFlowFieldSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,152 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatFlowFieldSubsystem.generated.h"
+
+class APawn;
+
+/**
+ *  Frontier entry for the flow field distance search
+ */
+struct FCombatFlowFieldNode
+{
+	float Distance = 0.0f;
+	int32 CellIndex = INDEX_NONE;
+
+	bool operator<(const FCombatFlowFieldNode& Other) const { return Distance < Other.Distance; }
+};
+
+/**
+ *  Distance and direction field towards one player
+ */
+struct FCombatFlowField
+{
+	/** Player the field leads to */
+	TWeakObjectPtr<APawn> Target;
+
+	/** Cell and location of the player the field leads to */
+	int32 GoalCell = INDEX_NONE;
+	FVector GoalLocation = FVector::ZeroVector;
+
+	/** Path distance to the goal per cell, in cells. Unreachable cells are UE_BIG_NUMBER */
+	TArray<float> Distances;
+
+	/** Index of the next cell towards the goal per cell, or INDEX_NONE */
+	TArray<int32> NextCells;
+
+	/** If true, the field is complete and can be sampled */
+	bool bValid = false;
+
+	/** Field being built for the player's cell at the time the build started. Swapped in once complete */
+	int32 BuildGoalCell = INDEX_NONE;
+	FVector BuildGoalLocation = FVector::ZeroVector;
+	TArray<float> BuildDistances;
+	TArray<FCombatFlowFieldNode> Frontier;
+	bool bBuilding = false;
+};
+
+/**
+ *  Builds a navigation grid over the arena's nav mesh bounds and keeps one distance and direction field per player,
+ *  rebuilt in time slices as players move between cells. A build always runs to completion; if the player changed
+ *  cells meanwhile, the next build starts from their latest cell. Nothing is built in worlds without combat enemies.
+ *  Enemies sample the field for their cell in constant time instead of running their own path queries,
+ *  so pathfinding cost doesn't grow with the number of enemies.
+ */
+UCLASS()
+class UCombatFlowFieldSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** World location of the corner of the first cell, at the vertical center of the nav bounds */
+	FVector GridOrigin = FVector::ZeroVector;
+
+	/** Half height of the nav bounds, used to find the nav mesh under each cell */
+	float GridHalfHeight = 0.0f;
+
+	/** Number of cells along X and Y */
+	FIntPoint GridSize = FIntPoint::ZeroValue;
+
+	/** Cell edge length */
+	float CellSize = 100.0f;
+
+	/** Per-cell walkability and nav mesh height */
+	TArray<bool> Walkable;
+	TArray<float> Heights;
+
+	/** Number of cells already tested against the nav mesh */
+	int32 NumCellsSampled = 0;
+
+	/** If true, the grid has been set up */
+	bool bGridInitialized = false;
+
+	/** If true, the world has combat enemies or spawners to build the grid for */
+	bool bHasCombatEnemies = false;
+
+	/** One field per player. Fields stay with their player as other players join or leave */
+	TArray<FCombatFlowField> Fields;
+
+public:
+
+	/** Samples the flow towards the nearest reachable player. Returns false if no field covers the location */
+	bool SampleDirection(const FVector& Location, FVector& OutDirection, float& OutDistance) const;
+
+	/** Samples the flow towards the given player. Returns false if there's no field for it or the field doesn't cover the location */
+	bool SampleDirectionTowards(const AActor* Target, const FVector& Location, FVector& OutDirection, float& OutDistance) const;
+
+	/** Returns the nav mesh height under a location. Returns false if it's outside the grid or over an unwalkable cell */
+	bool SampleHeight(const FVector& Location, float& OutHeight) const;
+
+	/** Returns true if the grid is fully built */
+	bool IsGridReady() const { return bGridInitialized && NumCellsSampled == Walkable.Num(); }
+
+	/** Returns true if flow field movement is enabled */
+	static bool IsFlowFieldEnabled();
+
+protected:
+
+	/** Sets up the grid over the nav mesh bounds volumes */
+	void InitializeGrid();
+
+	/** Tests a slice of cells against the nav mesh */
+	void SampleCells(int32 MaxCells);
+
+	/** Samples a single field at a walkable cell. Returns false if the goal can't be reached from the cell */
+	bool SampleField(const FCombatFlowField& Field, int32 CellIndex, const FVector& Location, FVector& OutDirection, float& OutDistance) const;
+
+	/** Starts or continues field builds towards the current player locations */
+	void UpdateFields(int32 MaxCells);
+
+	/** Expands a field's frontier by up to the given number of cells. Returns the number of cells processed */
+	int32 ExpandField(FCombatFlowField& Field, int32 MaxCells) const;
+
+	/** Fills in the next cell for every cell of a finished field and makes it current */
+	void FinishField(FCombatFlowField& Field) const;
+
+	/** Returns the cell index for a world location, or INDEX_NONE if it's outside the grid */
+	int32 WorldToCell(const FVector& Location) const;
+
+	/** Returns the world location of a cell's center at its nav mesh height */
+	FVector CellToWorld(int32 CellIndex) const;
+
+	/** Returns true if agents can move directly between two neighboring cells */
+	bool CanTraverse(int32 FromCell, int32 ToCell) const;
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Looks for combat enemies or spawners placed in the level */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+public:
+
+	/** Runs the time-sliced grid and field builds */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
@@ -0,0 +1,53 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatPathFollowingComponent.h"
+#include "CombatFlowFieldSubsystem.h"
+#include "GameFramework/NavMovementComponent.h"
+#include "Engine/World.h"
+
+bool UCombatPathFollowingComponent::CanFollowFlowField(const UWorld* World, const AActor* Goal, const FVector& Location)
+{
+	const UCombatFlowFieldSubsystem* FlowField = World ? World->GetSubsystem<UCombatFlowFieldSubsystem>() : nullptr;
+
+	FVector Direction;
+	float Distance;
+
+	return FlowField && UCombatFlowFieldSubsystem::IsFlowFieldEnabled() && FlowField->SampleDirectionTowards(Goal, Location, Direction, Distance);
+}
+
+void UCombatPathFollowingComponent::FollowPathSegment(float DeltaTime)
+{
+	bFollowingFlowField = false;
+
+	const UCombatFlowFieldSubsystem* FlowField = GetWorld()->GetSubsystem<UCombatFlowFieldSubsystem>();
+
+	// only moves towards a player can use the field
+	if (MovementComp && FlowField && UCombatFlowFieldSubsystem::IsFlowFieldEnabled())
+	{
+		float Distance = 0.0f;
+
+		if (FlowField->SampleDirectionTowards(GetMoveGoal(), MovementComp->GetActorFeetLocation(), FlowDirection, Distance))
+		{
+			bFollowingFlowField = true;
+
+			// keep full speed. Arrival is still checked against the goal actor with the move's acceptance radius
+			MovementComp->RequestDirectMove(FlowDirection * MovementComp->GetMaxSpeed(), true);
+			return;
+		}
+	}
+
+	// outside of the field, e.g. off the grid or towards a location
+	Super::FollowPathSegment(DeltaTime);
+}
+
+FVector UCombatPathFollowingComponent::GetMoveFocus(bool bAllowStrafe) const
+{
+	// the path points don't follow the field, so look where we're actually going
+	if (bFollowingFlowField && MovementComp && !bAllowStrafe)
+	{
+		return MovementComp->GetActorFeetLocation() + FlowDirection * 100.0f;
+	}
+
+	return Super::GetMoveFocus(bAllowStrafe);
+}
@@ -0,0 +1,40 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "CombatPathFollowingComponent.generated.h"
+
+/**
+ *  Path following component for combat enemies.
+ *  While moving towards a player covered by the shared flow field, steers along the field instead of the path points,
+ *  so the regular MoveTo tasks chase players without running their own path queries.
+ *  Any other move uses regular path following.
+ */
+UCLASS()
+class UCombatPathFollowingComponent : public UPathFollowingComponent
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Direction given by the flow field on the last update */
+	FVector FlowDirection = FVector::ZeroVector;
+
+	/** If true, the last update was steered by the flow field */
+	bool bFollowingFlowField = false;
+
+public:
+
+	/** Returns true if a move from the given location towards the goal can be steered by the flow field */
+	static bool CanFollowFlowField(const UWorld* World, const AActor* Goal, const FVector& Location);
+
+protected:
+
+	/** Steers along the flow field if it covers us, otherwise follows the path */
+	virtual void FollowPathSegment(float DeltaTime) override;
+
+	/** Looks along the flow direction while following the field */
+	virtual FVector GetMoveFocus(bool bAllowStrafe) const override;
+};
@@ -0,0 +1,456 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatPerceptionSubsystem.h"
+#include "CombatEnemy.h"
+#include "CombatTargetCache.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<bool> CVarPerceptionEnabled(
+	TEXT("Combat.Perception.Enabled"),
+	true,
+	TEXT("If false, enemies always know where the nearest player is instead of having to see or hear them."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarPerceptionTracesPerFrame(
+	TEXT("Combat.Perception.TracesPerFrame"),
+	8,
+	TEXT("Maximum number of enemy line of sight traces per frame. Enemies over the budget wait for a later frame."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarPerceptionMinCheckInterval(
+	TEXT("Combat.Perception.MinCheckInterval"),
+	0.1f,
+	TEXT("Minimum seconds between two line of sight checks for the same enemy."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarPerceptionTrackingTime(
+	TEXT("Combat.Perception.TrackingTime"),
+	1.0f,
+	TEXT("Seconds after a sighting during which enemies follow the target itself instead of its last known location."),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorldAndArgs PerceptionStatsCommand(
+	TEXT("Combat.Perception.Stats"),
+	TEXT("Logs the number of perceiving enemies and the line of sight budget usage since the last call."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UCombatPerceptionSubsystem::DumpStats)
+);
+
+int32 UCombatPerceptionSubsystem::RegisterListener(ACombatEnemy* Enemy, const FCombatPerceptionParams& Params)
+{
+	const int32 ListenerHandle = FreeListenerHandles.Num() > 0 ? FreeListenerHandles.Pop(EAllowShrinking::No) : Listeners.AddDefaulted();
+
+	FCombatPerceptionListener& Listener = Listeners[ListenerHandle];
+	Listener = FCombatPerceptionListener();
+	Listener.Enemy = Enemy;
+	Listener.Params = Params;
+	Listener.PeripheralVisionCos = FMath::Cos(FMath::DegreesToRadians(Params.PeripheralVisionAngle));
+	Listener.LastCheckTime = GetWorld()->GetTimeSeconds();
+	Listener.bRegistered = true;
+
+	MaxForgetTime = FMath::Max(MaxForgetTime, Params.ForgetTime);
+
+	// share the batched nearest target queries
+	if (UCombatTargetCache* TargetCache = GetWorld()->GetSubsystem<UCombatTargetCache>())
+	{
+		Listener.TargetCacheHandle = TargetCache->RegisterAgent(Enemy);
+	}
+
+	return ListenerHandle;
+}
+
+void UCombatPerceptionSubsystem::UnregisterListener(int32 ListenerHandle)
+{
+	if (!Listeners.IsValidIndex(ListenerHandle) || !Listeners[ListenerHandle].bRegistered)
+	{
+		return;
+	}
+
+	FCombatPerceptionListener& Listener = Listeners[ListenerHandle];
+
+	if (UCombatTargetCache* TargetCache = GetWorld()->GetSubsystem<UCombatTargetCache>())
+	{
+		TargetCache->UnregisterAgent(Listener.TargetCacheHandle);
+	}
+
+	Listener = FCombatPerceptionListener();
+	FreeListenerHandles.Add(ListenerHandle);
+}
+
+void UCombatPerceptionSubsystem::ForgetTargets(int32 ListenerHandle)
+{
+	if (Listeners.IsValidIndex(ListenerHandle))
+	{
+		Listeners[ListenerHandle].Knowledge = FCombatPerceivedTarget();
+		Listeners[ListenerHandle].bTargetVisible = false;
+	}
+}
+
+bool UCombatPerceptionSubsystem::GetPerceivedTarget(int32 ListenerHandle, FCombatTargetInfo& OutTarget)
+{
+	if (!Listeners.IsValidIndex(ListenerHandle) || !Listeners[ListenerHandle].bRegistered)
+	{
+		return false;
+	}
+
+	const FCombatPerceptionListener& Listener = Listeners[ListenerHandle];
+	const ACombatEnemy* Enemy = Listener.Enemy.Get();
+
+	if (!Enemy)
+	{
+		return false;
+	}
+
+	// without perception, fall back to knowing where the nearest player always is
+	if (!IsPerceptionEnabled())
+	{
+		UCombatTargetCache* TargetCache = GetWorld()->GetSubsystem<UCombatTargetCache>();
+
+		return TargetCache && TargetCache->GetNearestTarget(Listener.TargetCacheHandle, OutTarget);
+	}
+
+	// use whichever is fresher between what we sensed and what our squad sensed
+	const FCombatPerceivedTarget* Knowledge = &Listener.Knowledge;
+
+	if (!Enemy->GetSquadName().IsNone())
+	{
+		if (const FCombatPerceivedTarget* Shared = SquadKnowledge.Find(Enemy->GetSquadName()))
+		{
+			if (Shared->StimulusTime > Knowledge->StimulusTime)
+			{
+				Knowledge = Shared;
+			}
+		}
+	}
+
+	APawn* Pawn = Knowledge->Pawn.Get();
+	const double Time = GetWorld()->GetTimeSeconds();
+
+	if (!Pawn || Time - Knowledge->StimulusTime > Listener.Params.ForgetTime)
+	{
+		return false;
+	}
+
+	OutTarget.Pawn = Pawn;
+
+	// a target seen moments ago is still being tracked, so follow the target itself
+	if (Knowledge->bSeen && Time - Knowledge->StimulusTime <= CVarPerceptionTrackingTime.GetValueOnGameThread())
+	{
+		OutTarget.Location = Pawn->GetActorLocation();
+		OutTarget.Velocity = Pawn->GetVelocity();
+	}
+	else
+	{
+		// otherwise investigate where it was last sensed
+		OutTarget.Location = Knowledge->LastKnownLocation;
+		OutTarget.Velocity = FVector::ZeroVector;
+	}
+
+	OutTarget.DistanceSquared = FVector::DistSquared(Enemy->GetActorLocation(), OutTarget.Location);
+	OutTarget.Distance = FMath::Sqrt(OutTarget.DistanceSquared);
+
+	return true;
+}
+
+void UCombatPerceptionSubsystem::ReportNoise(FVector Location, float Loudness, AActor* NoiseInstigator)
+{
+	if (!IsPerceptionEnabled() || !NoiseInstigator)
+	{
+		return;
+	}
+
+	// noises from weapons and projectiles give away whoever is behind them
+	APawn* Target = Cast<APawn>(NoiseInstigator);
+
+	if (!Target)
+	{
+		Target = NoiseInstigator->GetInstigator();
+	}
+
+	// only noises made by players give away a target
+	if (!Target || !Target->IsPlayerControlled())
+	{
+		return;
+	}
+
+	++NumNoises;
+
+	const double Time = GetWorld()->GetTimeSeconds();
+
+	for (FCombatPerceptionListener& Listener : Listeners)
+	{
+		ACombatEnemy* Enemy = Listener.Enemy.Get();
+
+		if (!Listener.bRegistered || !CanSense(Enemy))
+		{
+			continue;
+		}
+
+		if (FVector::DistSquared(Enemy->GetActorLocation(), Location) > FMath::Square(Listener.Params.HearingRadius * Loudness))
+		{
+			continue;
+		}
+
+		// noises wake sleeping enemies up so they can come and look
+		if (Enemy->GetSignificance() == ECombatSignificance::Sleeping)
+		{
+			Enemy->ApplySignificance(ECombatSignificance::High);
+		}
+
+		Sense(Listener, Target, Location, false, Time);
+	}
+}
+
+bool UCombatPerceptionSubsystem::IsPerceptionEnabled()
+{
+	return CVarPerceptionEnabled.GetValueOnGameThread();
+}
+
+void UCombatPerceptionSubsystem::DumpStats(const TArray<FString>& Args, UWorld* World)
+{
+	UCombatPerceptionSubsystem* Perception = World ? World->GetSubsystem<UCombatPerceptionSubsystem>() : nullptr;
+
+	if (!Perception)
+	{
+		return;
+	}
+
+	const int32 NumListeners = Perception->Listeners.Num() - Perception->FreeListenerHandles.Num();
+	const int32 NumFrames = FMath::Max(1, Perception->NumFrames);
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Perception: %d enemies in %d squads, budget %d traces/frame"), NumListeners, Perception->SquadKnowledge.Num(), CVarPerceptionTracesPerFrame.GetValueOnGameThread());
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Over %d frames: %.2f traces/frame, %.2f checks deferred/frame, %d noises"), Perception->NumFrames, static_cast<float>(Perception->NumTraces) / NumFrames, static_cast<float>(Perception->NumDeferred) / NumFrames, Perception->NumNoises);
+
+	// start a new sampling window
+	Perception->NumFrames = 0;
+	Perception->NumTraces = 0;
+	Perception->NumDeferred = 0;
+	Perception->NumNoises = 0;
+}
+
+void UCombatPerceptionSubsystem::Sense(FCombatPerceptionListener& Listener, APawn* Target, const FVector& Location, bool bSeen, double Time)
+{
+	const float TrackingTime = CVarPerceptionTrackingTime.GetValueOnGameThread();
+
+	auto Record = [Target, &Location, bSeen, Time, TrackingTime](FCombatPerceivedTarget& Known)
+	{
+		// a noise doesn't replace a sighting of the same target that's still being tracked
+		if (!bSeen && Known.bSeen && Known.Pawn == Target && Time - Known.StimulusTime <= TrackingTime)
+		{
+			return;
+		}
+
+		Known.Pawn = Target;
+		Known.LastKnownLocation = Location;
+		Known.StimulusTime = Time;
+		Known.bSeen = bSeen;
+	};
+
+	Record(Listener.Knowledge);
+
+	// let the rest of the squad know
+	const ACombatEnemy* Enemy = Listener.Enemy.Get();
+
+	if (Enemy && !Enemy->GetSquadName().IsNone())
+	{
+		Record(SquadKnowledge.FindOrAdd(Enemy->GetSquadName()));
+	}
+}
+
+void UCombatPerceptionSubsystem::GatherCandidates(double Time)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatPerceptionSubsystem::GatherCandidates);
+
+	Candidates.Reset();
+
+	UCombatTargetCache* TargetCache = GetWorld()->GetSubsystem<UCombatTargetCache>();
+
+	if (!TargetCache)
+	{
+		return;
+	}
+
+	const float MinCheckInterval = CVarPerceptionMinCheckInterval.GetValueOnGameThread();
+
+	for (int32 ListenerHandle = 0; ListenerHandle < Listeners.Num(); ++ListenerHandle)
+	{
+		FCombatPerceptionListener& Listener = Listeners[ListenerHandle];
+		const ACombatEnemy* Enemy = Listener.Enemy.Get();
+
+		// sleeping enemies can only hear
+		if (!Listener.bRegistered || !CanSense(Enemy) || Enemy->GetSignificance() == ECombatSignificance::Sleeping)
+		{
+			Listener.bTargetVisible = false;
+			continue;
+		}
+
+		FCombatTargetInfo Target;
+
+		if (!TargetCache->GetNearestTarget(Listener.TargetCacheHandle, Target))
+		{
+			Listener.bTargetVisible = false;
+			continue;
+		}
+
+		// targets already in sight are tracked further out and all around us, new ones must be in range and in front
+		const float Range = Listener.bTargetVisible ? Listener.Params.LoseSightRadius : Listener.Params.SightRadius;
+
+		if (Target.DistanceSquared > FMath::Square(Range))
+		{
+			Listener.bTargetVisible = false;
+			continue;
+		}
+
+		if (!Listener.bTargetVisible && Target.Distance > UE_KINDA_SMALL_NUMBER)
+		{
+			const FVector Direction = (Target.Location - Enemy->GetActorLocation()) / Target.Distance;
+
+			if ((Direction | Enemy->GetActorForwardVector()) < Listener.PeripheralVisionCos)
+			{
+				continue;
+			}
+		}
+
+		const double TimeSinceCheck = Time - Listener.LastCheckTime;
+
+		if (TimeSinceCheck < MinCheckInterval)
+		{
+			continue;
+		}
+
+		// significant enemies get checked more often, but everyone's priority grows while they wait
+		FCombatPerceptionCandidate& Candidate = Candidates.AddDefaulted_GetRef();
+		Candidate.ListenerHandle = ListenerHandle;
+		Candidate.Target = Target.Pawn;
+		Candidate.Priority = static_cast<float>(TimeSinceCheck) * GetSignificanceWeight(Enemy->GetSignificance());
+	}
+}
+
+void UCombatPerceptionSubsystem::CheckLineOfSight(double Time)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatPerceptionSubsystem::CheckLineOfSight);
+
+	const int32 TraceBudget = FMath::Max(0, CVarPerceptionTracesPerFrame.GetValueOnGameThread());
+
+	// only the most urgent checks fit in the budget. The rest wait for a later frame
+	if (Candidates.Num() > TraceBudget)
+	{
+		Candidates.Sort([](const FCombatPerceptionCandidate& A, const FCombatPerceptionCandidate& B)
+		{
+			return A.Priority > B.Priority;
+		});
+
+		NumDeferred += Candidates.Num() - TraceBudget;
+	}
+
+	const int32 NumChecks = FMath::Min(TraceBudget, Candidates.Num());
+
+	for (int32 CandidateIndex = 0; CandidateIndex < NumChecks; ++CandidateIndex)
+	{
+		const FCombatPerceptionCandidate& Candidate = Candidates[CandidateIndex];
+		FCombatPerceptionListener& Listener = Listeners[Candidate.ListenerHandle];
+		const ACombatEnemy* Enemy = Listener.Enemy.Get();
+
+		// trace from our eyes to the target, ignoring both of us
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(CombatPerception), false, Enemy);
+		QueryParams.AddIgnoredActor(Candidate.Target);
+
+		const FVector TargetLocation = Candidate.Target->GetActorLocation();
+		const bool bBlocked = GetWorld()->LineTraceTestByChannel(Enemy->GetPawnViewLocation(), TargetLocation, ECC_Visibility, QueryParams);
+
+		Listener.LastCheckTime = Time;
+		Listener.bTargetVisible = !bBlocked;
+
+		if (!bBlocked)
+		{
+			Sense(Listener, Candidate.Target, TargetLocation, true, Time);
+		}
+
+		++NumTraces;
+	}
+}
+
+void UCombatPerceptionSubsystem::PruneSquadKnowledge(double Time)
+{
+	for (auto It = SquadKnowledge.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().Pawn.IsValid() || Time - It.Value().StimulusTime > MaxForgetTime)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+bool UCombatPerceptionSubsystem::CanSense(const ACombatEnemy* Enemy)
+{
+	return IsValid(Enemy) && !Enemy->IsInactiveInPool() && !Enemy->IsDead();
+}
+
+float UCombatPerceptionSubsystem::GetSignificanceWeight(ECombatSignificance Significance)
+{
+	switch (Significance)
+	{
+	case ECombatSignificance::High:
+		return 4.0f;
+
+	case ECombatSignificance::Medium:
+		return 2.0f;
+
+	case ECombatSignificance::Low:
+		return 1.0f;
+
+	case ECombatSignificance::Minimal:
+		return 0.5f;
+
+	default:
+		return 0.0f;
+	}
+}
+
+bool UCombatPerceptionSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatPerceptionSubsystem::Deinitialize()
+{
+	Listeners.Reset();
+	FreeListenerHandles.Reset();
+	SquadKnowledge.Reset();
+	Candidates.Reset();
+	MaxForgetTime = 0.0f;
+
+	Super::Deinitialize();
+}
+
+void UCombatPerceptionSubsystem::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatPerceptionSubsystem::Tick);
+
+	Super::Tick(DeltaTime);
+
+	if (!IsPerceptionEnabled())
+	{
+		return;
+	}
+
+	const double Time = GetWorld()->GetTimeSeconds();
+
+	GatherCandidates(Time);
+	CheckLineOfSight(Time);
+	PruneSquadKnowledge(Time);
+
+	++NumFrames;
+}
+
+TStatId UCombatPerceptionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatPerceptionSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,197 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatSignificanceSubsystem.h"
+#include "CombatPerceptionSubsystem.generated.h"
+
+class ACombatEnemy;
+class APawn;
+struct FCombatTargetInfo;
+
+/**
+ *  Per-enemy tuning for sight and hearing
+ */
+USTRUCT(BlueprintType)
+struct FCombatPerceptionParams
+{
+	GENERATED_BODY()
+
+	/** Targets closer than this can be spotted */
+	UPROPERTY(EditAnywhere, Category="Perception", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm"))
+	float SightRadius = 2500.0f;
+
+	/** Targets already in sight are tracked until they move further than this */
+	UPROPERTY(EditAnywhere, Category="Perception", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm"))
+	float LoseSightRadius = 3000.0f;
+
+	/** Half angle of the view cone new targets must be in to be spotted */
+	UPROPERTY(EditAnywhere, Category="Perception", meta = (ClampMin = 0, ClampMax = 180, Units = "deg"))
+	float PeripheralVisionAngle = 70.0f;
+
+	/** Noises of unit loudness closer than this are heard */
+	UPROPERTY(EditAnywhere, Category="Perception", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm"))
+	float HearingRadius = 1500.0f;
+
+	/** Time after the last sighting or noise after which a target is forgotten */
+	UPROPERTY(EditAnywhere, Category="Perception", meta = (ClampMin = 0, ClampMax = 60, Units = "s"))
+	float ForgetTime = 8.0f;
+};
+
+/**
+ *  What an enemy, or its squad, knows about a target
+ */
+struct FCombatPerceivedTarget
+{
+	/** Sensed target */
+	TWeakObjectPtr<APawn> Pawn;
+
+	/** Where the target was when it was last sensed */
+	FVector LastKnownLocation = FVector::ZeroVector;
+
+	/** Game time the target was last sensed */
+	double StimulusTime = -1000.0;
+
+	/** If true, the last stimulus was a sighting instead of a noise */
+	bool bSeen = false;
+};
+
+/**
+ *  A registered enemy and its perception state
+ */
+struct FCombatPerceptionListener
+{
+	/** Enemy doing the sensing */
+	TWeakObjectPtr<ACombatEnemy> Enemy;
+
+	/** Tuning */
+	FCombatPerceptionParams Params;
+
+	/** Cosine of the peripheral vision angle, for cheap view cone tests */
+	float PeripheralVisionCos = 0.0f;
+
+	/** Handle for batched nearest target queries */
+	int32 TargetCacheHandle = INDEX_NONE;
+
+	/** What this enemy sensed itself */
+	FCombatPerceivedTarget Knowledge;
+
+	/** Game time of the last line of sight check */
+	double LastCheckTime = 0.0;
+
+	/** If true, the last line of sight check succeeded */
+	bool bTargetVisible = false;
+
+	/** If true, this slot holds a registered listener */
+	bool bRegistered = false;
+};
+
+/**
+ *  A listener waiting for a line of sight check this frame
+ */
+struct FCombatPerceptionCandidate
+{
+	int32 ListenerHandle = INDEX_NONE;
+
+	/** Target to check */
+	APawn* Target = nullptr;
+
+	/** Higher values are checked first */
+	float Priority = 0.0f;
+};
+
+/**
+ *  Gives combat enemies sight and hearing instead of letting them always know where the nearest player is.
+ *  Cheap range and view cone tests run for every enemy each frame, but line of sight traces go through a global
+ *  per-frame budget, handed out by significance tier and time since each enemy's last check.
+ *  Anything an enemy senses is shared with the rest of its squad.
+ *  Perception only runs on the server; enemies only register as listeners when they have authority.
+ */
+UCLASS()
+class UCombatPerceptionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Registered listeners, indexed by handle */
+	TArray<FCombatPerceptionListener> Listeners;
+
+	/** Free listener handles */
+	TArray<int32> FreeListenerHandles;
+
+	/** What each squad knows, shared by all of its members */
+	TMap<FName, FCombatPerceivedTarget> SquadKnowledge;
+
+	/** Longest forget time of any listener registered so far. Squad knowledge older than this is discarded */
+	float MaxForgetTime = 0.0f;
+
+	/** Listeners waiting for a line of sight check this frame */
+	TArray<FCombatPerceptionCandidate> Candidates;
+
+	/** Totals for the stats command */
+	int32 NumFrames = 0;
+	int32 NumTraces = 0;
+	int32 NumDeferred = 0;
+	int32 NumNoises = 0;
+
+public:
+
+	/** Starts sensing for an enemy and returns its handle */
+	int32 RegisterListener(ACombatEnemy* Enemy, const FCombatPerceptionParams& Params);
+
+	/** Stops sensing for an enemy */
+	void UnregisterListener(int32 ListenerHandle);
+
+	/** Clears what an enemy has sensed, e.g. when it's returned to the pool */
+	void ForgetTargets(int32 ListenerHandle);
+
+	/** Returns the target an enemy or its squad currently knows about. Returns false if there's none */
+	bool GetPerceivedTarget(int32 ListenerHandle, FCombatTargetInfo& OutTarget);
+
+	/** Alerts every enemy within hearing range of a noise made by a player. Loudness scales the hearing radius */
+	UFUNCTION(BlueprintCallable, Category="Perception")
+	void ReportNoise(FVector Location, float Loudness, AActor* NoiseInstigator);
+
+	/** Returns true if enemies sense their targets instead of always knowing the nearest one */
+	static bool IsPerceptionEnabled();
+
+	/** Logs the listener count and trace budget usage. Bound to the Combat.Perception.Stats console command */
+	static void DumpStats(const TArray<FString>& Args, UWorld* World);
+
+protected:
+
+	/** Records a stimulus for a listener and its squad */
+	void Sense(FCombatPerceptionListener& Listener, APawn* Target, const FVector& Location, bool bSeen, double Time);
+
+	/** Gathers the listeners with a target in range and view */
+	void GatherCandidates(double Time);
+
+	/** Runs the line of sight traces for the highest priority candidates */
+	void CheckLineOfSight(double Time);
+
+	/** Discards squad knowledge no member could still remember */
+	void PruneSquadKnowledge(double Time);
+
+	/** Returns true if the enemy can sense anything, i.e. it's alive and not waiting in the pool */
+	static bool CanSense(const ACombatEnemy* Enemy);
+
+	/** Returns the line of sight priority multiplier for a significance tier */
+	static float GetSignificanceWeight(ECombatSignificance Significance);
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Cleanup */
+	virtual void Deinitialize() override;
+
+public:
+
+	/** Runs the budgeted sight checks */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
@@ -0,0 +1,264 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatSignificanceSubsystem.h"
+#include "CombatEnemy.h"
+#include "CombatTargetCache.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<bool> CVarSignificanceEnabled(
+	TEXT("Combat.Significance.Enabled"),
+	true,
+	TEXT("If false, all combat enemies update at full rate."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarSignificanceUpdateInterval(
+	TEXT("Combat.Significance.UpdateInterval"),
+	0.1f,
+	TEXT("Seconds between enemy significance scoring passes."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarSignificanceNearDistance(
+	TEXT("Combat.Significance.NearDistance"),
+	1500.0f,
+	TEXT("Enemies closer than this to a player always update at full rate."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarSignificanceFarDistance(
+	TEXT("Combat.Significance.FarDistance"),
+	4000.0f,
+	TEXT("Enemies further than this from every player drop to the lower tiers."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<bool> CVarAISleepEnabled(
+	TEXT("Combat.AILOD.SleepEnabled"),
+	true,
+	TEXT("If true, idle enemies far from every player pause their StateTree and stop ticking until woken up."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarAISleepDistance(
+	TEXT("Combat.AILOD.SleepDistance"),
+	6000.0f,
+	TEXT("Idle enemies further than this from every player may go to sleep."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarAIWakeDistance(
+	TEXT("Combat.AILOD.WakeDistance"),
+	5000.0f,
+	TEXT("Sleeping enemies wake up when a player comes closer than this. Should be lower than the sleep distance."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarAISleepDelay(
+	TEXT("Combat.AILOD.SleepDelay"),
+	2.0f,
+	TEXT("Seconds an enemy must stay idle and out of range before going to sleep."),
+	ECVF_Default
+);
+
+void UCombatSignificanceSubsystem::RegisterEnemy(ACombatEnemy* Enemy)
+{
+	Enemies.AddUnique(Enemy);
+}
+
+void UCombatSignificanceSubsystem::UnregisterEnemy(ACombatEnemy* Enemy)
+{
+	Enemies.RemoveSwap(Enemy);
+}
+
+ECombatSignificance UCombatSignificanceSubsystem::ComputeSignificance(float DistanceSquared, bool bVisible, bool bEngaged)
+{
+	const float NearDistance = CVarSignificanceNearDistance.GetValueOnGameThread();
+	const float FarDistance = CVarSignificanceFarDistance.GetValueOnGameThread();
+
+	// enemies fighting or about to fight always get full updates
+	if (bEngaged || DistanceSquared < FMath::Square(NearDistance))
+	{
+		return ECombatSignificance::High;
+	}
+
+	const bool bInRange = DistanceSquared < FMath::Square(FarDistance);
+
+	if (bVisible)
+	{
+		return bInRange ? ECombatSignificance::Medium : ECombatSignificance::Low;
+	}
+
+	return bInRange ? ECombatSignificance::Low : ECombatSignificance::Minimal;
+}
+
+void UCombatSignificanceSubsystem::WakeEnemiesInRadius(const FVector& Location, float Radius)
+{
+	const float RadiusSquared = FMath::Square(Radius);
+
+	for (const TWeakObjectPtr<ACombatEnemy>& WeakEnemy : Enemies)
+	{
+		ACombatEnemy* Enemy = WeakEnemy.Get();
+
+		if (Enemy && Enemy->GetSignificance() == ECombatSignificance::Sleeping && FVector::DistSquared(Enemy->GetActorLocation(), Location) < RadiusSquared)
+		{
+			Enemy->ApplySignificance(ECombatSignificance::High);
+		}
+	}
+}
+
+void UCombatSignificanceSubsystem::UpdateSignificance()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatSignificanceSubsystem::UpdateSignificance);
+
+	const bool bEnabled = CVarSignificanceEnabled.GetValueOnGameThread();
+
+	// on clients the tiers only throttle visuals. Sleep and replication are driven by the server
+	const bool bHasAuthority = !GetWorld()->IsNetMode(NM_Client);
+	const bool bSleepEnabled = bEnabled && bHasAuthority && CVarAISleepEnabled.GetValueOnGameThread();
+	const float SleepDistanceSquared = FMath::Square(CVarAISleepDistance.GetValueOnGameThread());
+	const float WakeDistanceSquared = FMath::Square(CVarAIWakeDistance.GetValueOnGameThread());
+	const float SleepDelay = CVarAISleepDelay.GetValueOnGameThread();
+
+	// the server scores against every player, clients only against what they see themselves
+	LocalViewerLocations.Reset();
+	const TArray<FVector>* ViewerLocationsPtr = &LocalViewerLocations;
+
+	if (!bHasAuthority)
+	{
+		GatherLocalViewerLocations();
+	}
+	else if (UCombatTargetCache* TargetCache = GetWorld()->GetSubsystem<UCombatTargetCache>())
+	{
+		ViewerLocationsPtr = &TargetCache->GetTargetLocations();
+	}
+
+	const TArray<FVector>& ViewerLocations = *ViewerLocationsPtr;
+
+	for (int32 EnemyIndex = Enemies.Num() - 1; EnemyIndex >= 0; --EnemyIndex)
+	{
+		ACombatEnemy* Enemy = Enemies[EnemyIndex].Get();
+
+		// drop stale entries
+		if (!IsValid(Enemy))
+		{
+			Enemies.RemoveAtSwap(EnemyIndex, EAllowShrinking::No);
+			continue;
+		}
+
+		// pooled enemies are already fully disabled, and dead ones are on their way out
+		if (Enemy->IsInactiveInPool() || Enemy->IsDead())
+		{
+			continue;
+		}
+
+		if (!bEnabled || ViewerLocations.Num() == 0)
+		{
+			Enemy->ApplySignificance(ECombatSignificance::High);
+
+			if (bHasAuthority)
+			{
+				Enemy->UpdateNetUpdateFrequency();
+			}
+
+			continue;
+		}
+
+		// find the distance to the closest player
+		const FVector EnemyLocation = Enemy->GetActorLocation();
+		float ClosestDistanceSquared = UE_BIG_NUMBER;
+
+		for (const FVector& ViewerLocation : ViewerLocations)
+		{
+			ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, static_cast<float>(FVector::DistSquared(EnemyLocation, ViewerLocation)));
+		}
+
+		const bool bVisible = Enemy->GetMesh()->WasRecentlyRendered(0.2f);
+		const bool bEngaged = Enemy->IsEngagedInCombat();
+
+		ECombatSignificance NewSignificance = ComputeSignificance(ClosestDistanceSquared, bVisible, bEngaged);
+
+		if (Enemy->GetSignificance() == ECombatSignificance::Sleeping)
+		{
+			// stay asleep until a player comes within the wake distance
+			if (bSleepEnabled && !bEngaged && ClosestDistanceSquared >= WakeDistanceSquared)
+			{
+				continue;
+			}
+		}
+		else
+		{
+			// go to sleep once we've been idle and out of range for long enough
+			const bool bCanSleep = bSleepEnabled && NewSignificance == ECombatSignificance::Minimal && ClosestDistanceSquared > SleepDistanceSquared && Enemy->CanSleep();
+
+			if (Enemy->UpdateSleepTimer(bCanSleep, TimeSinceLastUpdate) >= SleepDelay)
+			{
+				NewSignificance = ECombatSignificance::Sleeping;
+			}
+		}
+
+		Enemy->ApplySignificance(NewSignificance);
+
+		// engagement can change without changing the tier
+		if (bHasAuthority)
+		{
+			Enemy->UpdateNetUpdateFrequency();
+		}
+	}
+}
+
+void UCombatSignificanceSubsystem::GatherLocalViewerLocations()
+{
+	LocalViewerLocations.Reset();
+
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+
+		if (!PlayerController || !PlayerController->IsLocalController())
+		{
+			continue;
+		}
+
+		// prefer the pawn, since the camera may sit far behind it
+		if (const APawn* Pawn = PlayerController->GetPawn())
+		{
+			LocalViewerLocations.Add(Pawn->GetActorLocation());
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		LocalViewerLocations.Add(ViewLocation);
+	}
+}
+
+bool UCombatSignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeSinceLastUpdate += DeltaTime;
+
+	if (TimeSinceLastUpdate >= CVarSignificanceUpdateInterval.GetValueOnGameThread())
+	{
+		UpdateSignificance();
+
+		TimeSinceLastUpdate = 0.0f;
+	}
+}
+
+TStatId UCombatSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatSignificanceSubsystem, STATGROUP_Tickables);
+}
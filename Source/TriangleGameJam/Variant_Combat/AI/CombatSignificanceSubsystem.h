@@ -0,0 +1,92 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatSignificanceSubsystem.generated.h"
+
+class ACombatEnemy;
+
+/**
+ *  Update tiers for combat enemies, from most to least expensive
+ */
+UENUM(BlueprintType)
+enum class ECombatSignificance : uint8
+{
+	/** Engaged in combat or close to a player: full update rate */
+	High,
+
+	/** Visible at mid range: reduced tick rate, no life bar */
+	Medium,
+
+	/** Visible far away, or offscreen at mid range */
+	Low,
+
+	/** Offscreen and far away: minimal updates */
+	Minimal,
+
+	/** Idle and out of every player's range: StateTree paused and no ticking until woken up */
+	Sleeping
+};
+
+/**
+ *  Scores combat enemies by distance to the players, visibility and combat engagement,
+ *  and pushes the resulting update tier to each enemy so only the engaged ones pay full cost.
+ *  Idle enemies far from every player are put to sleep, and woken up by players approaching, damage or spawner activation.
+ *  Sleep and net update rates are only driven on the server, which scores against every player.
+ *  Clients score against their local viewers only, and the tiers just throttle ticking, animation and life bars.
+ */
+UCLASS()
+class UCombatSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Enemies being scored */
+	TArray<TWeakObjectPtr<ACombatEnemy>> Enemies;
+
+	/** View locations of the local players, gathered each pass on clients */
+	TArray<FVector> LocalViewerLocations;
+
+	/** Time accumulated since the last scoring pass */
+	float TimeSinceLastUpdate = 0.0f;
+
+public:
+
+	/** Adds an enemy to the scoring list */
+	void RegisterEnemy(ACombatEnemy* Enemy);
+
+	/** Removes an enemy from the scoring list */
+	void UnregisterEnemy(ACombatEnemy* Enemy);
+
+	/** Returns the number of registered enemies */
+	int32 GetNumEnemies() const { return Enemies.Num(); }
+
+	/** Returns the tier an enemy at the given distance should use */
+	static ECombatSignificance ComputeSignificance(float DistanceSquared, bool bVisible, bool bEngaged);
+
+	/** Wakes up all sleeping enemies within the given radius */
+	UFUNCTION(BlueprintCallable, Category="Significance")
+	void WakeEnemiesInRadius(const FVector& Location, float Radius);
+
+protected:
+
+	/** Scores all registered enemies and applies their tiers */
+	void UpdateSignificance();
+
+	/** Gathers the view locations of this machine's player controllers */
+	void GatherLocalViewerLocations();
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Runs scoring passes at a fixed interval */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
@@ -8,7 +8,9 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "AIController.h"
 #include "CombatEnemy.h"
-#include "Kismet/GameplayStatics.h"
+#include "CombatTargetCache.h"
+#include "CombatPerceptionSubsystem.h"
+#include "CombatFlowFieldSubsystem.h"
 #include "StateTreeAsyncExecutionContext.h"
 
 bool FStateTreeCharacterGroundedCondition::TestCondition(FStateTreeExecutionContext& Context) const
@@ -261,23 +263,79 @@ FText FStateTreeSetCharacterSpeedTask::GetDescription(const FGuid& ID, FStateTre
 
 ////////////////////////////////////////////////////////////////////
 
+EStateTreeRunStatus FStateTreeGetPlayerInfoTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	// combat enemies query their perception instead. Anyone else registers with the target cache so the query is batched with all other agents
+	if (InstanceData.TargetCacheHandle == INDEX_NONE && !InstanceData.Character->IsA<ACombatEnemy>())
+	{
+		if (UCombatTargetCache* TargetCache = InstanceData.Character->GetWorld()->GetSubsystem<UCombatTargetCache>())
+		{
+			InstanceData.TargetCacheHandle = TargetCache->RegisterAgent(InstanceData.Character);
+		}
+	}
+
+	return EStateTreeRunStatus::Running;
+}
+
+void FStateTreeGetPlayerInfoTask::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// have we transitioned to another state?
+	if (Transition.ChangeType == EStateTreeStateChangeType::Changed)
+	{
+		// get the instance data
+		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+		// release the target cache handle
+		if (UCombatTargetCache* TargetCache = InstanceData.Character->GetWorld()->GetSubsystem<UCombatTargetCache>())
+		{
+			TargetCache->UnregisterAgent(InstanceData.TargetCacheHandle);
+		}
+
+		InstanceData.TargetCacheHandle = INDEX_NONE;
+	}
+}
+
 EStateTreeRunStatus FStateTreeGetPlayerInfoTask::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
 {
 	// get the instance data
 	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
-	// get the character possessed by the first local player
-	InstanceData.TargetPlayerCharacter = Cast<ACharacter>(UGameplayStatics::GetPlayerPawn(InstanceData.Character, 0));
+	FCombatTargetInfo Target;
+	bool bHasTarget = false;
 
-	// do we have a valid target?
-	if (InstanceData.TargetPlayerCharacter)
+	if (const ACombatEnemy* Enemy = Cast<ACombatEnemy>(InstanceData.Character))
+	{
+		// get the target the enemy or its squad has seen or heard
+		UCombatPerceptionSubsystem* Perception = Enemy->GetWorld()->GetSubsystem<UCombatPerceptionSubsystem>();
+		bHasTarget = Perception && Perception->GetPerceivedTarget(Enemy->GetPerceptionHandle(), Target);
+	}
+	else
 	{
-		// update the last known location
-		InstanceData.TargetPlayerLocation = InstanceData.TargetPlayerCharacter->GetActorLocation();
+		// get the nearest player from this frame's batch
+		UCombatTargetCache* TargetCache = InstanceData.Character->GetWorld()->GetSubsystem<UCombatTargetCache>();
+		bHasTarget = TargetCache && TargetCache->GetNearestTarget(InstanceData.TargetCacheHandle, Target);
 	}
 
-	// update the distance
-	InstanceData.DistanceToTarget = FVector::Distance(InstanceData.TargetPlayerLocation, InstanceData.Character->GetActorLocation());
+	if (bHasTarget)
+	{
+		// update the target and its last known location
+		InstanceData.TargetPlayerCharacter = Cast<ACharacter>(Target.Pawn);
+		InstanceData.TargetPlayerLocation = Target.Location;
+		InstanceData.TargetPlayerVelocity = Target.Velocity;
+		InstanceData.DistanceToTargetSquared = Target.DistanceSquared;
+		InstanceData.DistanceToTarget = Target.Distance;
+	}
+	else
+	{
+		// nothing sensed, keep tracking the last known location
+		InstanceData.TargetPlayerCharacter = nullptr;
+		InstanceData.TargetPlayerVelocity = FVector::ZeroVector;
+		InstanceData.DistanceToTargetSquared = FVector::DistSquared(InstanceData.TargetPlayerLocation, InstanceData.Character->GetActorLocation());
+		InstanceData.DistanceToTarget = FMath::Sqrt(InstanceData.DistanceToTargetSquared);
+	}
 
 	return EStateTreeRunStatus::Running;
 }
@@ -287,4 +345,40 @@ FText FStateTreeGetPlayerInfoTask::GetDescription(const FGuid& ID, FStateTreeDat
 {
 	return FText::FromString("<b>Get Player Info</b>");
 }
-#endif // WITH_EDITOR
\ No newline at end of file
+#endif // WITH_EDITOR
+
+////////////////////////////////////////////////////////////////////
+
+EStateTreeRunStatus FStateTreeFlowFieldMoveTask::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	const UCombatFlowFieldSubsystem* FlowField = InstanceData.Character->GetWorld()->GetSubsystem<UCombatFlowFieldSubsystem>();
+
+	FVector Direction;
+	float Distance;
+
+	// fail if the character isn't covered by the field
+	if (!FlowField || !UCombatFlowFieldSubsystem::IsFlowFieldEnabled() || !FlowField->SampleDirection(InstanceData.Character->GetActorLocation(), Direction, Distance))
+	{
+		return EStateTreeRunStatus::Failed;
+	}
+
+	// have we arrived?
+	if (Distance <= InstanceData.AcceptanceRadius)
+	{
+		return EStateTreeRunStatus::Succeeded;
+	}
+
+	InstanceData.Character->AddMovementInput(Direction);
+
+	return EStateTreeRunStatus::Running;
+}
+
+#if WITH_EDITOR
+FText FStateTreeFlowFieldMoveTask::GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting /*= EStateTreeNodeFormatting::Text*/) const
+{
+	return FText::FromString("<b>Flow Field Move</b>");
+}
+#endif // WITH_EDITOR
@@ -288,10 +288,21 @@ struct FStateTreeGetPlayerInfoInstanceData
 	/** Distance to the target */
 	UPROPERTY(VisibleAnywhere)
 	float DistanceToTarget = 0.0f;
+
+	/** Squared distance to the target. Cheaper to compare against squared thresholds */
+	UPROPERTY(VisibleAnywhere)
+	float DistanceToTargetSquared = 0.0f;
+
+	/** Velocity of the target */
+	UPROPERTY(VisibleAnywhere)
+	FVector TargetPlayerVelocity = FVector::ZeroVector;
+
+	/** Handle for batched queries on the target cache */
+	int32 TargetCacheHandle = INDEX_NONE;
 };
 
 /**
- *  StateTree task to get information about the player character
+ *  StateTree task to get information about the player character the enemy has seen or heard, or the nearest one for other characters
  */
 USTRUCT(meta=(DisplayName="GetPlayerInfo", Category="Combat"))
 struct FStateTreeGetPlayerInfoTask : public FStateTreeTaskCommonBase
@@ -302,10 +313,56 @@ struct FStateTreeGetPlayerInfoTask : public FStateTreeTaskCommonBase
 	using FInstanceDataType = FStateTreeGetPlayerInfoInstanceData;
 	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
 
+	/** Runs when the owning state is entered */
+	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+	/** Runs when the owning state is ended */
+	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+	/** Runs while the owning state is active */
+	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
+
+#if WITH_EDITOR
+	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
+#endif // WITH_EDITOR
+};
+
+////////////////////////////////////////////////////////////////////
+
+/**
+ *  Instance data struct for the Flow Field Move task
+ */
+USTRUCT()
+struct FStateTreeFlowFieldMoveInstanceData
+{
+	GENERATED_BODY()
+
+	/** Character that will be moved */
+	UPROPERTY(EditAnywhere, Category = Context)
+	TObjectPtr<ACharacter> Character;
+
+	/** The task succeeds once the path distance to the nearest player is below this */
+	UPROPERTY(EditAnywhere, Category = Parameter)
+	float AcceptanceRadius = 150.0f;
+};
+
+/**
+ *  StateTree task that moves a Character towards the nearest player along the shared flow field.
+ *  Fails if the character is outside of the field, so the tree can fall back to regular path following.
+ */
+USTRUCT(meta=(DisplayName="Flow Field Move", Category="Combat"))
+struct FStateTreeFlowFieldMoveTask : public FStateTreeTaskCommonBase
+{
+	GENERATED_BODY()
+
+	/* Ensure we're using the correct instance data struct */
+	using FInstanceDataType = FStateTreeFlowFieldMoveInstanceData;
+	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
+
 	/** Runs while the owning state is active */
 	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
 
 #if WITH_EDITOR
 	virtual FText GetDescription(const FGuid& ID, FStateTreeDataView InstanceDataView, const IStateTreeBindingLookup& BindingLookup, EStateTreeNodeFormatting Formatting = EStateTreeNodeFormatting::Text) const override;
 #endif // WITH_EDITOR
-};
\ No newline at end of file
+};
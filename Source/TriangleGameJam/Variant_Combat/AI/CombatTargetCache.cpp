@@ -0,0 +1,246 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatTargetCache.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/World.h"
+#include "Math/VectorRegister.h"
+
+int32 UCombatTargetCache::RegisterAgent(AActor* Agent)
+{
+	int32 AgentHandle;
+
+	// reuse a free slot if we have one
+	if (FreeAgentHandles.Num() > 0)
+	{
+		AgentHandle = FreeAgentHandles.Pop(EAllowShrinking::No);
+		Agents[AgentHandle] = Agent;
+	}
+	else
+	{
+		AgentHandle = Agents.Add(Agent);
+		AgentRegistered.Add(false);
+	}
+
+	AgentRegistered[AgentHandle] = true;
+
+	// invalidate any results computed this frame for a previous owner of this slot
+	if (AgentNearestIndex.IsValidIndex(AgentHandle))
+	{
+		AgentNearestIndex[AgentHandle] = -1.0f;
+	}
+
+	return AgentHandle;
+}
+
+void UCombatTargetCache::UnregisterAgent(int32 AgentHandle)
+{
+	// free the slot even if the agent is already gone, but only once
+	if (AgentRegistered.IsValidIndex(AgentHandle) && AgentRegistered[AgentHandle])
+	{
+		Agents[AgentHandle].Reset();
+		AgentRegistered[AgentHandle] = false;
+		FreeAgentHandles.Add(AgentHandle);
+	}
+}
+
+bool UCombatTargetCache::GetNearestTarget(int32 AgentHandle, FCombatTargetInfo& OutTarget)
+{
+	Refresh();
+
+	if (!Agents.IsValidIndex(AgentHandle))
+	{
+		return false;
+	}
+
+	// use the batched result if this agent was part of this frame's batch
+	if (AgentNearestIndex.IsValidIndex(AgentHandle) && AgentNearestIndex[AgentHandle] >= 0.0f)
+	{
+		FillTargetInfo(static_cast<int32>(AgentNearestIndex[AgentHandle]), AgentNearestDistanceSquared[AgentHandle], AgentNearestDistance[AgentHandle], OutTarget);
+		return true;
+	}
+
+	// agents registered after the batch ran fall back to a single query
+	if (const AActor* Agent = Agents[AgentHandle].Get())
+	{
+		return FindNearestTarget(Agent->GetActorLocation(), OutTarget);
+	}
+
+	return false;
+}
+
+bool UCombatTargetCache::FindNearestTarget(const FVector& Location, FCombatTargetInfo& OutTarget)
+{
+	Refresh();
+
+	int32 NearestIndex = INDEX_NONE;
+	float NearestDistanceSquared = UE_BIG_NUMBER;
+
+	for (int32 TargetIndex = 0; TargetIndex < TargetLocations.Num(); ++TargetIndex)
+	{
+		const float DistanceSquared = static_cast<float>(FVector::DistSquared(Location, TargetLocations[TargetIndex]));
+
+		if (DistanceSquared < NearestDistanceSquared)
+		{
+			NearestDistanceSquared = DistanceSquared;
+			NearestIndex = TargetIndex;
+		}
+	}
+
+	if (NearestIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	FillTargetInfo(NearestIndex, NearestDistanceSquared, FMath::Sqrt(NearestDistanceSquared), OutTarget);
+	return true;
+}
+
+int32 UCombatTargetCache::GetNumTargets()
+{
+	Refresh();
+
+	return TargetLocations.Num();
+}
+
+const TArray<FVector>& UCombatTargetCache::GetTargetLocations()
+{
+	Refresh();
+
+	return TargetLocations;
+}
+
+const TArray<TWeakObjectPtr<APawn>>& UCombatTargetCache::GetTargetPawns()
+{
+	Refresh();
+
+	return TargetPawns;
+}
+
+void UCombatTargetCache::Refresh()
+{
+	// only rebuild once per frame, on the first query
+	if (CachedFrame == GFrameCounter)
+	{
+		return;
+	}
+
+	CachedFrame = GFrameCounter;
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatTargetCache::Refresh);
+
+	RefreshTargets();
+	RefreshAgents();
+}
+
+void UCombatTargetCache::RefreshTargets()
+{
+	TargetPawns.Reset();
+	TargetLocations.Reset();
+	TargetVelocities.Reset();
+	TargetX.Reset();
+	TargetY.Reset();
+	TargetZ.Reset();
+
+	// every player controlled pawn is a valid target
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+
+		if (!IsValid(Pawn))
+		{
+			continue;
+		}
+
+		const FVector Location = Pawn->GetActorLocation();
+
+		TargetPawns.Add(Pawn);
+		TargetLocations.Add(Location);
+		TargetVelocities.Add(Pawn->GetVelocity());
+		TargetX.Add(static_cast<float>(Location.X));
+		TargetY.Add(static_cast<float>(Location.Y));
+		TargetZ.Add(static_cast<float>(Location.Z));
+	}
+}
+
+void UCombatTargetCache::RefreshAgents()
+{
+	// pad the agent arrays to the SIMD width
+	const int32 NumAgents = Agents.Num();
+	const int32 NumPadded = Align(NumAgents, 4);
+
+	AgentX.SetNumUninitialized(NumPadded);
+	AgentY.SetNumUninitialized(NumPadded);
+	AgentZ.SetNumUninitialized(NumPadded);
+	AgentNearestIndex.SetNumUninitialized(NumPadded);
+	AgentNearestDistanceSquared.SetNumUninitialized(NumPadded);
+	AgentNearestDistance.SetNumUninitialized(NumPadded);
+
+	// gather the agent locations
+	for (int32 AgentIndex = 0; AgentIndex < NumPadded; ++AgentIndex)
+	{
+		const AActor* Agent = AgentIndex < NumAgents ? Agents[AgentIndex].Get() : nullptr;
+		const FVector Location = Agent ? Agent->GetActorLocation() : FVector::ZeroVector;
+
+		AgentX[AgentIndex] = static_cast<float>(Location.X);
+		AgentY[AgentIndex] = static_cast<float>(Location.Y);
+		AgentZ[AgentIndex] = static_cast<float>(Location.Z);
+	}
+
+	const int32 NumTargets = TargetLocations.Num();
+
+	// test four agents against each target at a time
+	for (int32 Base = 0; Base < NumPadded; Base += 4)
+	{
+		const VectorRegister4Float X = VectorLoadAligned(&AgentX[Base]);
+		const VectorRegister4Float Y = VectorLoadAligned(&AgentY[Base]);
+		const VectorRegister4Float Z = VectorLoadAligned(&AgentZ[Base]);
+
+		VectorRegister4Float BestDistanceSquared = VectorSetFloat1(UE_BIG_NUMBER);
+		VectorRegister4Float BestIndex = VectorSetFloat1(-1.0f);
+
+		for (int32 TargetIndex = 0; TargetIndex < NumTargets; ++TargetIndex)
+		{
+			const VectorRegister4Float DeltaX = VectorSubtract(X, VectorSetFloat1(TargetX[TargetIndex]));
+			const VectorRegister4Float DeltaY = VectorSubtract(Y, VectorSetFloat1(TargetY[TargetIndex]));
+			const VectorRegister4Float DeltaZ = VectorSubtract(Z, VectorSetFloat1(TargetZ[TargetIndex]));
+
+			const VectorRegister4Float DistanceSquared = VectorMultiplyAdd(DeltaX, DeltaX, VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaZ, DeltaZ)));
+
+			// keep the closer of the current best and this target
+			const VectorRegister4Float CloserMask = VectorCompareLT(DistanceSquared, BestDistanceSquared);
+
+			BestDistanceSquared = VectorSelect(CloserMask, DistanceSquared, BestDistanceSquared);
+			BestIndex = VectorSelect(CloserMask, VectorSetFloat1(static_cast<float>(TargetIndex)), BestIndex);
+		}
+
+		VectorStoreAligned(BestIndex, &AgentNearestIndex[Base]);
+		VectorStoreAligned(BestDistanceSquared, &AgentNearestDistanceSquared[Base]);
+		VectorStoreAligned(VectorSqrt(BestDistanceSquared), &AgentNearestDistance[Base]);
+	}
+
+	// empty slots have no result
+	for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+	{
+		if (!Agents[AgentIndex].IsValid())
+		{
+			AgentNearestIndex[AgentIndex] = -1.0f;
+		}
+	}
+}
+
+void UCombatTargetCache::FillTargetInfo(int32 TargetIndex, float DistanceSquared, float Distance, FCombatTargetInfo& OutTarget) const
+{
+	OutTarget.Pawn = TargetPawns[TargetIndex].Get();
+	OutTarget.Location = TargetLocations[TargetIndex];
+	OutTarget.Velocity = TargetVelocities[TargetIndex];
+	OutTarget.DistanceSquared = DistanceSquared;
+	OutTarget.Distance = Distance;
+}
+
+bool UCombatTargetCache::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
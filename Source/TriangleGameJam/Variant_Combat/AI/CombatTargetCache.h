@@ -0,0 +1,115 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatTargetCache.generated.h"
+
+class APawn;
+
+/**
+ *  Result of a nearest target query
+ */
+struct FCombatTargetInfo
+{
+	/** Target pawn */
+	APawn* Pawn = nullptr;
+
+	/** Target location this frame */
+	FVector Location = FVector::ZeroVector;
+
+	/** Target velocity this frame */
+	FVector Velocity = FVector::ZeroVector;
+
+	/** Squared distance from the querying agent to the target */
+	float DistanceSquared = 0.0f;
+
+	/** Distance from the querying agent to the target */
+	float Distance = 0.0f;
+};
+
+/**
+ *  Publishes the player pawns AI can target once per frame in packed arrays,
+ *  and answers nearest target queries for all registered agents in a single SIMD batch.
+ *  Every player pawn is a target, so splitscreen and multiplayer sessions aren't limited to player 0.
+ */
+UCLASS()
+class UCombatTargetCache : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Frame the cache was last refreshed on */
+	uint64 CachedFrame = MAX_uint64;
+
+	/** Targets for the current frame */
+	TArray<TWeakObjectPtr<APawn>> TargetPawns;
+	TArray<FVector> TargetLocations;
+	TArray<FVector> TargetVelocities;
+
+	/** Target locations split per axis for vectorized distance tests */
+	TArray<float> TargetX;
+	TArray<float> TargetY;
+	TArray<float> TargetZ;
+
+	/** Registered agents, indexed by handle. Empty slots are null */
+	TArray<TWeakObjectPtr<AActor>> Agents;
+
+	/** If true, the slot at this handle is registered, even if its agent has since been destroyed */
+	TArray<bool> AgentRegistered;
+
+	/** Free agent handles */
+	TArray<int32> FreeAgentHandles;
+
+	/** Agent locations split per axis, padded to a multiple of the SIMD width */
+	TArray<float, TAlignedHeapAllocator<16>> AgentX;
+	TArray<float, TAlignedHeapAllocator<16>> AgentY;
+	TArray<float, TAlignedHeapAllocator<16>> AgentZ;
+
+	/** Nearest target results per agent */
+	TArray<float, TAlignedHeapAllocator<16>> AgentNearestIndex;
+	TArray<float, TAlignedHeapAllocator<16>> AgentNearestDistanceSquared;
+	TArray<float, TAlignedHeapAllocator<16>> AgentNearestDistance;
+
+public:
+
+	/** Registers an agent for batched nearest target queries and returns its handle */
+	int32 RegisterAgent(AActor* Agent);
+
+	/** Releases an agent handle */
+	void UnregisterAgent(int32 AgentHandle);
+
+	/** Returns the nearest target to a registered agent. Returns false if there are no targets */
+	bool GetNearestTarget(int32 AgentHandle, FCombatTargetInfo& OutTarget);
+
+	/** Returns the nearest target to an arbitrary location. Returns false if there are no targets */
+	bool FindNearestTarget(const FVector& Location, FCombatTargetInfo& OutTarget);
+
+	/** Returns the number of targets this frame */
+	int32 GetNumTargets();
+
+	/** Returns the target locations for this frame */
+	const TArray<FVector>& GetTargetLocations();
+
+	/** Returns the target pawns for this frame, in the same order as their locations */
+	const TArray<TWeakObjectPtr<APawn>>& GetTargetPawns();
+
+protected:
+
+	/** Rebuilds the target arrays and agent results if this is the first query this frame */
+	void Refresh();
+
+	/** Gathers the player pawns */
+	void RefreshTargets();
+
+	/** Finds the nearest target for every registered agent, four agents at a time */
+	void RefreshAgents();
+
+	/** Fills a query result for the given target */
+	void FillTargetInfo(int32 TargetIndex, float DistanceSquared, float Distance, FCombatTargetInfo& OutTarget) const;
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+};
@@ -0,0 +1,208 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatWaveDirector.h"
+#include "CombatEnemy.h"
+#include "CombatEnemySpawner.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "HAL/IConsoleManager.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<float> CVarWaveSpawnBudgetMs(
+	TEXT("Combat.WaveDirector.SpawnBudgetMs"),
+	2.0f,
+	TEXT("Game thread time in milliseconds the wave director may spend spawning enemies each frame."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarWaveLoadTimeout(
+	TEXT("Combat.WaveDirector.LoadTimeout"),
+	30.0f,
+	TEXT("Seconds a queued spawn waits for its enemy class to load before it is dropped."),
+	ECVF_Default
+);
+
+void UCombatWaveDirector::LoadEnemyClass(const TSoftClassPtr<ACombatEnemy>& EnemyClass)
+{
+	const FSoftObjectPath& ClassPath = EnemyClass.ToSoftObjectPath();
+
+	// ignore null classes and classes that are already loading
+	if (ClassPath.IsNull() || LoadHandles.Contains(ClassPath))
+	{
+		return;
+	}
+
+	// the montages are soft references, so they're requested separately once the class is in
+	TSharedPtr<FStreamableHandle> Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ClassPath,
+		FStreamableDelegate::CreateWeakLambda(this, [this, EnemyClass]() { PreloadEnemyAssets(EnemyClass); }), FStreamableManager::AsyncLoadHighPriority);
+
+	LoadHandles.Add(ClassPath, Handle);
+}
+
+void UCombatWaveDirector::PreloadEnemyAssets(const TSoftClassPtr<ACombatEnemy>& EnemyClass)
+{
+	const UClass* LoadedClass = EnemyClass.Get();
+
+	// ignore classes that haven't loaded and classes whose montages were already requested
+	if (!LoadedClass || AssetHandles.Contains(EnemyClass.ToSoftObjectPath()))
+	{
+		return;
+	}
+
+	TArray<FSoftObjectPath> AssetPaths = LoadedClass->GetDefaultObject<ACombatEnemy>()->GetAttackAssetPaths();
+	AssetPaths.RemoveAll([](const FSoftObjectPath& AssetPath) { return AssetPath.IsNull(); });
+
+	TSharedPtr<FStreamableHandle> Handle;
+
+	if (AssetPaths.Num() > 0)
+	{
+		Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(MoveTemp(AssetPaths), FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
+	}
+
+	AssetHandles.Add(EnemyClass.ToSoftObjectPath(), Handle);
+}
+
+void UCombatWaveDirector::RequestSpawn(ACombatEnemySpawner* Spawner, bool bPrewarm)
+{
+	// clients get their enemies through replication
+	if (!IsValid(Spawner) || GetWorld()->IsNetMode(NM_Client))
+	{
+		return;
+	}
+
+	FCombatWaveSpawnRequest& Request = SpawnQueue.AddDefaulted_GetRef();
+	Request.Spawner = Spawner;
+	Request.bPrewarm = bPrewarm;
+	Request.QueueTime = FPlatformTime::Seconds();
+
+	// make sure the montages are on their way before the enemy is spawned.
+	// Classes still loading request them once they're in
+	PreloadEnemyAssets(Spawner->GetEnemyClass());
+}
+
+bool UCombatWaveDirector::HasEnemyClassFailedToLoad(const TSoftClassPtr<ACombatEnemy>& EnemyClass) const
+{
+	// classes that were never requested, or whose request couldn't be made, will never load
+	const TSharedPtr<FStreamableHandle>* Handle = LoadHandles.Find(EnemyClass.ToSoftObjectPath());
+
+	if (!Handle || !Handle->IsValid())
+	{
+		return true;
+	}
+
+	// the load is over but didn't produce the class, e.g. the asset is missing
+	return ((*Handle)->HasLoadCompleted() || (*Handle)->WasCanceled()) && EnemyClass.Get() == nullptr;
+}
+
+bool UCombatWaveDirector::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatWaveDirector::Deinitialize()
+{
+	SpawnQueue.Empty();
+
+	// release the loaded classes and montages
+	for (TPair<FSoftObjectPath, TSharedPtr<FStreamableHandle>>& Pair : LoadHandles)
+	{
+		if (Pair.Value.IsValid())
+		{
+			Pair.Value->ReleaseHandle();
+		}
+	}
+
+	for (TPair<FSoftObjectPath, TSharedPtr<FStreamableHandle>>& Pair : AssetHandles)
+	{
+		if (Pair.Value.IsValid())
+		{
+			Pair.Value->ReleaseHandle();
+		}
+	}
+
+	LoadHandles.Empty();
+	AssetHandles.Empty();
+
+	Super::Deinitialize();
+}
+
+void UCombatWaveDirector::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatWaveDirector::Tick);
+
+	const double BudgetSeconds = CVarWaveSpawnBudgetMs.GetValueOnGameThread() / 1000.0;
+	const double LoadTimeout = CVarWaveLoadTimeout.GetValueOnGameThread();
+
+	const double StartTime = FPlatformTime::Seconds();
+	int32 NumSpawned = 0;
+
+	// requests still waiting on their class are written back to the front of the queue as we go,
+	// and everything consumed is removed in one go at the end, so draining stays linear
+	int32 ReadIndex = 0;
+	int32 WriteIndex = 0;
+
+	for (; ReadIndex < SpawnQueue.Num(); ++ReadIndex)
+	{
+		// stop once we're out of budget. The first spawn always goes through so the queue can't stall
+		if (NumSpawned > 0 && FPlatformTime::Seconds() - StartTime >= BudgetSeconds)
+		{
+			break;
+		}
+
+		ACombatEnemySpawner* Spawner = SpawnQueue[ReadIndex].Spawner.Get();
+
+		// drop requests from spawners that have been removed
+		if (!IsValid(Spawner))
+		{
+			continue;
+		}
+
+		// leave the request queued until the enemy class finishes loading
+		if (!Spawner->IsEnemyClassLoaded())
+		{
+			// drop it if the class failed to load or is taking too long
+			const bool bFailed = HasEnemyClassFailedToLoad(Spawner->GetEnemyClass());
+
+			if (bFailed || StartTime - SpawnQueue[ReadIndex].QueueTime >= LoadTimeout)
+			{
+				UE_LOG(LogTriangleGameJam, Warning, TEXT("Wave director dropped a spawn from %s: enemy class %s %s"),
+					*Spawner->GetName(), *Spawner->GetEnemyClass().ToString(), bFailed ? TEXT("failed to load") : TEXT("timed out loading"));
+
+				continue;
+			}
+
+			// keep the request, in order
+			if (WriteIndex != ReadIndex)
+			{
+				SpawnQueue[WriteIndex] = MoveTemp(SpawnQueue[ReadIndex]);
+			}
+
+			++WriteIndex;
+			continue;
+		}
+
+		const bool bPrewarm = SpawnQueue[ReadIndex].bPrewarm;
+
+		if (bPrewarm)
+		{
+			Spawner->PrewarmEnemy();
+		}
+		else
+		{
+			Spawner->SpawnEnemy();
+		}
+
+		++NumSpawned;
+	}
+
+	// close the gap left by the consumed requests, keeping the ones we didn't get to this frame
+	SpawnQueue.RemoveAt(WriteIndex, ReadIndex - WriteIndex, EAllowShrinking::No);
+}
+
+TStatId UCombatWaveDirector::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatWaveDirector, STATGROUP_Tickables);
+}
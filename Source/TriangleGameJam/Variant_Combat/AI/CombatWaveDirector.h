@@ -0,0 +1,82 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatWaveDirector.generated.h"
+
+class ACombatEnemy;
+class ACombatEnemySpawner;
+struct FStreamableHandle;
+
+/**
+ *  A spawn scheduled by the wave director
+ */
+struct FCombatWaveSpawnRequest
+{
+	/** Spawner that will perform the spawn */
+	TWeakObjectPtr<ACombatEnemySpawner> Spawner;
+
+	/** If true, the spawner will only create an inactive enemy for the pool */
+	bool bPrewarm = false;
+
+	/** Time the request was queued, so it can be dropped if its class never finishes loading */
+	double QueueTime = 0.0;
+};
+
+/**
+ *  Schedules enemy spawns from all spawners in the level against a per-frame time budget.
+ *  Enemy classes and their attack montages are loaded asynchronously ahead of time, and queued spawns wait until their class is resident,
+ *  so activating many spawners at once is spread over several frames instead of producing a spike.
+ *  Spawns whose class fails to load, or takes too long to load, are dropped so they don't stay queued forever.
+ */
+UCLASS()
+class UCombatWaveDirector : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Spawns waiting to be processed, in request order */
+	TArray<FCombatWaveSpawnRequest> SpawnQueue;
+
+	/** Handles keeping loaded enemy classes resident */
+	TMap<FSoftObjectPath, TSharedPtr<FStreamableHandle>> LoadHandles;
+
+	/** Handles keeping each loaded enemy class's attack montages resident, keyed by class */
+	TMap<FSoftObjectPath, TSharedPtr<FStreamableHandle>> AssetHandles;
+
+public:
+
+	/** Starts loading an enemy class in the background, followed by its attack montages */
+	void LoadEnemyClass(const TSoftClassPtr<ACombatEnemy>& EnemyClass);
+
+	/** Queues an enemy spawn for the given spawner. Ignored on clients */
+	void RequestSpawn(ACombatEnemySpawner* Spawner, bool bPrewarm = false);
+
+	/** Returns the number of spawns waiting to be processed */
+	int32 GetNumQueuedSpawns() const { return SpawnQueue.Num(); }
+
+protected:
+
+	/** Starts streaming in the attack montages of a loaded enemy class, so its enemies don't load them when spawned */
+	void PreloadEnemyAssets(const TSoftClassPtr<ACombatEnemy>& EnemyClass);
+
+	/** Returns true if the enemy class has finished or abandoned loading without producing a class */
+	bool HasEnemyClassFailedToLoad(const TSoftClassPtr<ACombatEnemy>& EnemyClass) const;
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Cleanup */
+	virtual void Deinitialize() override;
+
+public:
+
+	/** Processes queued spawns within the frame budget */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
@@ -2,17 +2,28 @@
 
 
 #include "EnvQueryContext_Player.h"
-#include "Kismet/GameplayStatics.h"
+#include "CombatTargetCache.h"
 #include "EnvironmentQuery/EnvQueryTypes.h"
 #include "EnvironmentQuery/Items/EnvQueryItemType_Actor.h"
 #include "GameFramework/Pawn.h"
+#include "Engine/World.h"
 
 void UEnvQueryContext_Player::ProvideContext(FEnvQueryInstance& QueryInstance, FEnvQueryContextData& ContextData) const
 {
-	// get the player pawn for the first local player
-	AActor* PlayerPawn = UGameplayStatics::GetPlayerPawn(QueryInstance.Owner.Get(), 0);
-	check(PlayerPawn);
+	const AActor* QueryOwner = Cast<AActor>(QueryInstance.Owner.Get());
+	UCombatTargetCache* TargetCache = QueryInstance.World ? QueryInstance.World->GetSubsystem<UCombatTargetCache>() : nullptr;
 
-	// add the actor data to the context
-	UEnvQueryItemType_Actor::SetContextHelper(ContextData, PlayerPawn);
+	if (!QueryOwner || !TargetCache)
+	{
+		return;
+	}
+
+	// get the player pawn closest to the querier
+	FCombatTargetInfo Target;
+
+	if (TargetCache->FindNearestTarget(QueryOwner->GetActorLocation(), Target))
+	{
+		// add the actor data to the context
+		UEnvQueryItemType_Actor::SetContextHelper(ContextData, Target.Pawn);
+	}
 }
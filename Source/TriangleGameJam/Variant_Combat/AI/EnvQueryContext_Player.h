@@ -8,7 +8,7 @@
 
 /**
  *  UEnvQueryContext_Player
- *  Basic EnvQuery Context that returns the first local player
+ *  Basic EnvQuery Context that returns the player pawn closest to the querier
  */
 UCLASS()
 class UEnvQueryContext_Player : public UEnvQueryContext
@@ -7,8 +7,10 @@
 
 void UAnimNotify_CheckChargedAttack::Notify(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, const FAnimNotifyEventReference& EventReference)
 {
-	// cast the owner to the attacker interface
-	if (ICombatAttacker* AttackerInterface = Cast<ICombatAttacker>(MeshComp->GetOwner()))
+	// cast the owner to the attacker interface. Attackers running on an attack timeline fire this event from gameplay instead
+	ICombatAttacker* AttackerInterface = Cast<ICombatAttacker>(MeshComp->GetOwner());
+
+	if (AttackerInterface && !AttackerInterface->UsesAttackTimeline())
 	{
 		// tell the actor to check for a charged attack loop
 		AttackerInterface->CheckChargedAttack();
@@ -27,4 +27,7 @@ public:
 
 	/** Get the notify name */
 	virtual FString GetNotifyName_Implementation() const override;
+
+	/** Returns the source bone for the attack trace */
+	FName GetAttackBoneName() const { return AttackBoneName; }
 };
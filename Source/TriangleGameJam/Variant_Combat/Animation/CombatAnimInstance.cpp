@@ -0,0 +1,117 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatAnimInstance.h"
+#include "CombatHitReactionComponent.h"
+#include "Animation/AnimNodeBase.h"
+#include "BonePose.h"
+#include "GameFramework/Actor.h"
+#include "Misc/ScopeExit.h"
+#include <atomic>
+
+/** Cycles spent evaluating combat anim graphs on any thread, since the last time they were consumed */
+static std::atomic<uint64> CombatAnimEvaluationCycles { 0 };
+
+/** Nesting depth of evaluations on this thread, so linked graphs aren't counted twice */
+static thread_local int32 CombatAnimEvaluationDepth = 0;
+
+double FCombatAnimInstanceProxy::ConsumeEvaluationSeconds()
+{
+	return FPlatformTime::ToSeconds64(CombatAnimEvaluationCycles.exchange(0));
+}
+
+bool FCombatAnimInstanceProxy::Evaluate_WithRoot(FPoseContext& Output, FAnimNode_Base* InRootNode)
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	++CombatAnimEvaluationDepth;
+
+	ON_SCOPE_EXIT
+	{
+		if (--CombatAnimEvaluationDepth == 0)
+		{
+			CombatAnimEvaluationCycles += FPlatformTime::Cycles64() - StartCycles;
+		}
+	};
+
+	// run the AnimGraph as usual
+	EvaluateAnimationNode_WithRoot(Output, InRootNode);
+
+	// only lean the main graph's output, and only while a reaction is playing
+	if (HitReactionAlpha <= 0.0f || InRootNode != GetRootNode())
+	{
+		return true;
+	}
+
+	const FBoneContainer& BoneContainer = Output.Pose.GetBoneContainer();
+	const int32 MeshBoneIndex = BoneContainer.GetPoseBoneIndexForBoneName(HitReactionBoneName);
+
+	if (MeshBoneIndex == INDEX_NONE)
+	{
+		return true;
+	}
+
+	const FCompactPoseBoneIndex BoneIndex = BoneContainer.MakeCompactPoseIndex(FMeshPoseBoneIndex(MeshBoneIndex));
+
+	if (BoneIndex == INDEX_NONE)
+	{
+		return true;
+	}
+
+	// rotate the bone around its own pivot in component space, same as a Transform (Modify) Bone node in Add to Existing mode
+	FCSPose<FCompactPose> ComponentSpacePose;
+	ComponentSpacePose.InitPose(Output.Pose);
+
+	FTransform BoneTransform = ComponentSpacePose.GetComponentSpaceTransform(BoneIndex);
+	BoneTransform.SetRotation(HitReactionRotation * BoneTransform.GetRotation());
+
+	TArray<FBoneTransform> BoneTransforms;
+	BoneTransforms.Emplace(BoneIndex, BoneTransform);
+
+	ComponentSpacePose.LocalBlendCSBoneTransforms(BoneTransforms, HitReactionAlpha);
+
+	FCSPose<FCompactPose>::ConvertComponentPosesToLocalPoses(MoveTemp(ComponentSpacePose), Output.Pose);
+
+	return true;
+}
+
+void UCombatAnimInstance::NativeInitializeAnimation()
+{
+	Super::NativeInitializeAnimation();
+
+	if (AActor* Owner = GetOwningActor())
+	{
+		HitReaction = Owner->FindComponentByClass<UCombatHitReactionComponent>();
+	}
+}
+
+void UCombatAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
+{
+	Super::NativeUpdateAnimation(DeltaSeconds);
+
+	if (HitReaction && HitReaction->IsReacting())
+	{
+		HitReactionRotation = HitReaction->GetLeanRotation();
+		HitReactionAlpha = 1.0f;
+	}
+	else
+	{
+		HitReactionRotation = FRotator::ZeroRotator;
+		HitReactionAlpha = 0.0f;
+	}
+
+	// hand this frame's lean to the proxy before the worker thread evaluates the pose
+	FCombatAnimInstanceProxy& Proxy = GetProxyOnGameThread<FCombatAnimInstanceProxy>();
+	Proxy.HitReactionBoneName = HitReactionBoneName;
+	Proxy.HitReactionRotation = HitReactionRotation.Quaternion();
+	Proxy.HitReactionAlpha = bApplyHitReaction ? HitReactionAlpha : 0.0f;
+}
+
+FAnimInstanceProxy* UCombatAnimInstance::CreateAnimInstanceProxy()
+{
+	return new FCombatAnimInstanceProxy(this);
+}
+
+void UCombatAnimInstance::DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy)
+{
+	delete static_cast<FCombatAnimInstanceProxy*>(InProxy);
+}
@@ -0,0 +1,90 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "CombatAnimInstance.generated.h"
+
+class UCombatHitReactionComponent;
+
+/**
+ *  Anim instance proxy for combat characters.
+ *  Adds the hit reaction lean to a spine bone after the AnimGraph has been evaluated, so the reaction shows
+ *  without any nodes in the AnimBP.
+ */
+USTRUCT()
+struct FCombatAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+	/** Constructors */
+	FCombatAnimInstanceProxy() = default;
+	FCombatAnimInstanceProxy(UAnimInstance* InAnimInstance) : FAnimInstanceProxy(InAnimInstance) {}
+
+	/** Bone the lean is applied to */
+	FName HitReactionBoneName;
+
+	/** Component space rotation to add to the bone */
+	FQuat HitReactionRotation = FQuat::Identity;
+
+	/** Blend alpha for the lean. Zero skips the bone modification */
+	float HitReactionAlpha = 0.0f;
+
+	/** Returns the time spent evaluating combat anim graphs, summed over all threads, since the last call. Used by the combat benchmark */
+	static double ConsumeEvaluationSeconds();
+
+protected:
+
+	/** Evaluates the AnimGraph, then applies the hit reaction lean */
+	virtual bool Evaluate_WithRoot(FPoseContext& Output, FAnimNode_Base* InRootNode) override;
+};
+
+/**
+ *  Base AnimInstance for combat characters.
+ *  Applies the procedural hit reaction as an additive component space rotation on a spine bone through its proxy,
+ *  after the AnimGraph runs. The rotation and alpha are also exposed in case an AnimGraph prefers to apply them itself,
+ *  e.g. with a Transform (Modify) Bone node, in which case the native lean should be turned off.
+ */
+UCLASS()
+class UCombatAnimInstance : public UAnimInstance
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** If true, the hit reaction lean is applied natively after the AnimGraph evaluates */
+	UPROPERTY(EditDefaultsOnly, Category="Hit Reaction")
+	bool bApplyHitReaction = true;
+
+	/** Bone the hit reaction lean is applied to */
+	UPROPERTY(EditDefaultsOnly, Category="Hit Reaction", meta = (EditCondition = "bApplyHitReaction"))
+	FName HitReactionBoneName = FName("spine_03");
+
+	/** Hit reaction component on the owning actor */
+	UPROPERTY(Transient)
+	UCombatHitReactionComponent* HitReaction;
+
+	/** Component space rotation to add to the hit reaction bone */
+	UPROPERTY(BlueprintReadOnly, Category="Hit Reaction")
+	FRotator HitReactionRotation = FRotator::ZeroRotator;
+
+	/** Blend alpha for the hit reaction. Zero while no reaction is playing, so the node can be skipped */
+	UPROPERTY(BlueprintReadOnly, Category="Hit Reaction")
+	float HitReactionAlpha = 0.0f;
+
+protected:
+
+	/** Finds the hit reaction component */
+	virtual void NativeInitializeAnimation() override;
+
+	/** Copies the hit reaction state, and passes it to the proxy */
+	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
+
+	/** Creates our proxy so the lean can be applied during evaluation */
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+
+	/** Destroys our proxy */
+	virtual void DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy) override;
+};
@@ -0,0 +1,415 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatAnimSharingSubsystem.h"
+#include "CombatEnemy.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<bool> CVarAnimSharingEnabled(
+	TEXT("Combat.AnimSharing.Enabled"),
+	true,
+	TEXT("If true, combat enemies in the same locomotion state share one evaluated pose."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarAnimSharingUpdateInterval(
+	TEXT("Combat.AnimSharing.UpdateInterval"),
+	0.1f,
+	TEXT("Seconds between regrouping passes."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<int32> CVarAnimSharingFollowersPerLeader(
+	TEXT("Combat.AnimSharing.FollowersPerLeader"),
+	8,
+	TEXT("Number of enemies copying each leader's pose. Larger groups are split between several leaders so they don't all move in step."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarAnimSharingWalkSpeed(
+	TEXT("Combat.AnimSharing.WalkSpeed"),
+	10.0f,
+	TEXT("Ground speed above which an enemy is considered walking instead of idle."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarAnimSharingRunSpeed(
+	TEXT("Combat.AnimSharing.RunSpeed"),
+	350.0f,
+	TEXT("Ground speed above which an enemy is considered running instead of walking."),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorldAndArgs AnimSharingStatsCommand(
+	TEXT("Combat.AnimSharing.Stats"),
+	TEXT("Logs the number of enemies evaluating or copying a pose, and the number of distinct sharing groups."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UCombatAnimSharingSubsystem::DumpStats)
+);
+
+int32 UCombatAnimSharingSubsystem::RegisterEnemy(ACombatEnemy* Enemy)
+{
+	const int32 MemberHandle = FreeMemberHandles.Num() > 0 ? FreeMemberHandles.Pop(EAllowShrinking::No) : Members.AddDefaulted();
+
+	FCombatAnimSharingMember& Member = Members[MemberHandle];
+	Member = FCombatAnimSharingMember();
+	Member.Enemy = Enemy;
+	Member.bRegistered = true;
+
+	return MemberHandle;
+}
+
+void UCombatAnimSharingSubsystem::UnregisterEnemy(int32 MemberHandle)
+{
+	if (!Members.IsValidIndex(MemberHandle) || !Members[MemberHandle].bRegistered)
+	{
+		return;
+	}
+
+	// hand our followers back their own pose before we go
+	StopSharing(MemberHandle);
+
+	Members[MemberHandle] = FCombatAnimSharingMember();
+	FreeMemberHandles.Add(MemberHandle);
+}
+
+void UCombatAnimSharingSubsystem::StopSharing(int32 MemberHandle)
+{
+	if (!Members.IsValidIndex(MemberHandle) || !Members[MemberHandle].bRegistered)
+	{
+		return;
+	}
+
+	// stop copying our leader's pose
+	const int32 OldLeaderHandle = Members[MemberHandle].LeaderHandle;
+
+	SetLeader(MemberHandle, INDEX_NONE);
+
+	if (OldLeaderHandle != INDEX_NONE)
+	{
+		UpdateRole(OldLeaderHandle);
+	}
+
+	// our followers would mirror whatever we do next, so let them evaluate their own pose until the next update
+	if (Members[MemberHandle].NumFollowers > 0)
+	{
+		for (int32 FollowerHandle = 0; FollowerHandle < Members.Num(); ++FollowerHandle)
+		{
+			if (Members[FollowerHandle].LeaderHandle == MemberHandle)
+			{
+				SetLeader(FollowerHandle, INDEX_NONE);
+				UpdateRole(FollowerHandle);
+			}
+		}
+	}
+
+	UpdateRole(MemberHandle);
+}
+
+ECombatAnimSharingState UCombatAnimSharingSubsystem::ComputeState(const ACombatEnemy* Enemy)
+{
+	// pooled, dead and sleeping enemies aren't animating
+	if (!IsValid(Enemy) || Enemy->IsInactiveInPool() || Enemy->IsDead() || Enemy->GetSignificance() == ECombatSignificance::Sleeping)
+	{
+		return ECombatAnimSharingState::None;
+	}
+
+	// attacks, hit reactions and ragdolls need the enemy's own pose
+	if (Enemy->IsEngagedInCombat() || Enemy->GetMesh()->IsSimulatingPhysics())
+	{
+		return ECombatAnimSharingState::None;
+	}
+
+	const UCharacterMovementComponent* Movement = Enemy->GetCharacterMovement();
+
+	if (Movement->IsFalling())
+	{
+		return ECombatAnimSharingState::Falling;
+	}
+
+	const float SpeedSquared = Movement->Velocity.SizeSquared2D();
+
+	if (SpeedSquared < FMath::Square(CVarAnimSharingWalkSpeed.GetValueOnGameThread()))
+	{
+		return ECombatAnimSharingState::Idle;
+	}
+
+	return SpeedSquared < FMath::Square(CVarAnimSharingRunSpeed.GetValueOnGameThread()) ? ECombatAnimSharingState::Walk : ECombatAnimSharingState::Run;
+}
+
+void UCombatAnimSharingSubsystem::DumpStats(const TArray<FString>& Args, UWorld* World)
+{
+	const UCombatAnimSharingSubsystem* AnimSharing = World ? World->GetSubsystem<UCombatAnimSharingSubsystem>() : nullptr;
+
+	if (!AnimSharing)
+	{
+		return;
+	}
+
+	int32 NumSolo = 0;
+	int32 NumLeaders = 0;
+	int32 NumFollowers = 0;
+
+	for (const FCombatAnimSharingMember& Member : AnimSharing->Members)
+	{
+		if (!Member.bRegistered)
+		{
+			continue;
+		}
+
+		if (Member.LeaderHandle != INDEX_NONE)
+		{
+			++NumFollowers;
+		}
+		else if (Member.NumFollowers > 0)
+		{
+			++NumLeaders;
+		}
+		else
+		{
+			++NumSolo;
+		}
+	}
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Anim sharing: %d poses evaluated (%d leaders, %d solo), %d copied, %d groups"), NumLeaders + NumSolo, NumLeaders, NumSolo, NumFollowers, AnimSharing->Groups.Num());
+}
+
+void UCombatAnimSharingSubsystem::UpdateGroups()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatAnimSharingSubsystem::UpdateGroups);
+
+	Groups.Reset();
+
+	for (int32 MemberHandle = 0; MemberHandle < Members.Num(); ++MemberHandle)
+	{
+		const FCombatAnimSharingMember& Member = Members[MemberHandle];
+
+		if (!Member.bRegistered)
+		{
+			continue;
+		}
+
+		const ACombatEnemy* Enemy = Member.Enemy.Get();
+		const ECombatAnimSharingState State = ComputeState(Enemy);
+
+		if (State == ECombatAnimSharingState::None)
+		{
+			StopSharing(MemberHandle);
+			continue;
+		}
+
+		FCombatAnimSharingKey Key;
+		Key.Mesh = Enemy->GetMesh()->GetSkeletalMeshAsset();
+		Key.AnimClass = Enemy->GetMesh()->GetAnimClass();
+		Key.State = State;
+
+		Groups.FindOrAdd(Key).Add(MemberHandle);
+	}
+
+	for (const TPair<FCombatAnimSharingKey, TArray<int32>>& Group : Groups)
+	{
+		UpdateGroup(Group.Value);
+	}
+
+	for (int32 MemberHandle = 0; MemberHandle < Members.Num(); ++MemberHandle)
+	{
+		if (Members[MemberHandle].bRegistered)
+		{
+			UpdateRole(MemberHandle);
+		}
+	}
+}
+
+void UCombatAnimSharingSubsystem::UpdateGroup(const TArray<int32>& GroupHandles)
+{
+	const int32 FollowersPerLeader = FMath::Max(1, CVarAnimSharingFollowersPerLeader.GetValueOnGameThread());
+	const int32 NumLeaders = FMath::DivideAndRoundUp(GroupHandles.Num(), FollowersPerLeader + 1);
+
+	GroupLeaders.Reset();
+
+	// keep the current leaders, so their followers don't jump to a pose in a different phase
+	for (const int32 MemberHandle : GroupHandles)
+	{
+		if (GroupLeaders.Num() < NumLeaders && Members[MemberHandle].LeaderHandle == INDEX_NONE && Members[MemberHandle].NumFollowers > 0)
+		{
+			GroupLeaders.Add(MemberHandle);
+		}
+	}
+
+	// promote the most significant of the others, since leaders evaluate at their own tier's rate
+	while (GroupLeaders.Num() < NumLeaders)
+	{
+		int32 BestHandle = INDEX_NONE;
+		ECombatSignificance BestSignificance = ECombatSignificance::Sleeping;
+
+		for (const int32 MemberHandle : GroupHandles)
+		{
+			const ECombatSignificance MemberSignificance = Members[MemberHandle].Enemy->GetSignificance();
+
+			if (!GroupLeaders.Contains(MemberHandle) && (BestHandle == INDEX_NONE || MemberSignificance < BestSignificance))
+			{
+				BestHandle = MemberHandle;
+				BestSignificance = MemberSignificance;
+			}
+		}
+
+		GroupLeaders.Add(BestHandle);
+	}
+
+	// leaders evaluate their own pose
+	for (const int32 LeaderHandle : GroupLeaders)
+	{
+		SetLeader(LeaderHandle, INDEX_NONE);
+	}
+
+	for (const int32 MemberHandle : GroupHandles)
+	{
+		// skip leaders, and followers whose leader still leads this group
+		if (GroupLeaders.Contains(MemberHandle) || GroupLeaders.Contains(Members[MemberHandle].LeaderHandle))
+		{
+			continue;
+		}
+
+		// join the leader with the fewest followers
+		int32 NewLeaderHandle = GroupLeaders[0];
+
+		for (const int32 LeaderHandle : GroupLeaders)
+		{
+			if (Members[LeaderHandle].NumFollowers < Members[NewLeaderHandle].NumFollowers)
+			{
+				NewLeaderHandle = LeaderHandle;
+			}
+		}
+
+		SetLeader(MemberHandle, NewLeaderHandle);
+	}
+}
+
+void UCombatAnimSharingSubsystem::SetLeader(int32 MemberHandle, int32 LeaderHandle)
+{
+	FCombatAnimSharingMember& Member = Members[MemberHandle];
+
+	if (Member.LeaderHandle == LeaderHandle)
+	{
+		return;
+	}
+
+	if (Members.IsValidIndex(Member.LeaderHandle))
+	{
+		--Members[Member.LeaderHandle].NumFollowers;
+	}
+
+	Member.LeaderHandle = LeaderHandle;
+
+	ACombatEnemy* Leader = nullptr;
+
+	if (Members.IsValidIndex(LeaderHandle))
+	{
+		++Members[LeaderHandle].NumFollowers;
+		Leader = Members[LeaderHandle].Enemy.Get();
+	}
+
+	// copy the leader's bone transforms instead of evaluating our own graph
+	if (ACombatEnemy* Enemy = Member.Enemy.Get())
+	{
+		Enemy->GetMesh()->SetLeaderPoseComponent(Leader ? Leader->GetMesh() : nullptr);
+	}
+}
+
+void UCombatAnimSharingSubsystem::UpdateRole(int32 MemberHandle)
+{
+	const FCombatAnimSharingMember& Member = Members[MemberHandle];
+
+	ACombatEnemy* Enemy = Member.Enemy.Get();
+
+	if (!Enemy)
+	{
+		return;
+	}
+
+	if (Member.LeaderHandle != INDEX_NONE)
+	{
+		Enemy->SetAnimSharingRole(ECombatAnimSharingRole::Follower);
+	}
+	else
+	{
+		Enemy->SetAnimSharingRole(Member.NumFollowers > 0 ? ECombatAnimSharingRole::Leader : ECombatAnimSharingRole::Solo);
+	}
+}
+
+void UCombatAnimSharingSubsystem::StopSharingAll()
+{
+	for (int32 MemberHandle = 0; MemberHandle < Members.Num(); ++MemberHandle)
+	{
+		if (Members[MemberHandle].bRegistered)
+		{
+			SetLeader(MemberHandle, INDEX_NONE);
+		}
+	}
+
+	for (int32 MemberHandle = 0; MemberHandle < Members.Num(); ++MemberHandle)
+	{
+		if (Members[MemberHandle].bRegistered)
+		{
+			UpdateRole(MemberHandle);
+		}
+	}
+
+	Groups.Reset();
+}
+
+bool UCombatAnimSharingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatAnimSharingSubsystem::Deinitialize()
+{
+	Members.Reset();
+	FreeMemberHandles.Reset();
+	Groups.Reset();
+
+	Super::Deinitialize();
+}
+
+void UCombatAnimSharingSubsystem::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatAnimSharingSubsystem::Tick);
+
+	Super::Tick(DeltaTime);
+
+	const bool bEnabled = CVarAnimSharingEnabled.GetValueOnGameThread();
+
+	// give every enemy its own pose back once sharing is turned off
+	if (!bEnabled)
+	{
+		if (bWasEnabled)
+		{
+			StopSharingAll();
+		}
+
+		bWasEnabled = false;
+		return;
+	}
+
+	bWasEnabled = true;
+
+	TimeSinceLastUpdate += DeltaTime;
+
+	if (TimeSinceLastUpdate < CVarAnimSharingUpdateInterval.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	TimeSinceLastUpdate = 0.0f;
+
+	UpdateGroups();
+}
+
+TStatId UCombatAnimSharingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatAnimSharingSubsystem, STATGROUP_Tickables);
+}
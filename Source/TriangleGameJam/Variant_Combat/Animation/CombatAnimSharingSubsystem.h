@@ -0,0 +1,168 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatAnimSharingSubsystem.generated.h"
+
+class ACombatEnemy;
+class USkeletalMesh;
+
+/**
+ *  Locomotion states combat enemies can share a pose in
+ */
+UENUM(BlueprintType)
+enum class ECombatAnimSharingState : uint8
+{
+	/** Attacking, reacting to hits, dead or asleep: evaluates its own pose */
+	None,
+
+	/** Standing still */
+	Idle,
+
+	/** Moving below the run speed */
+	Walk,
+
+	/** Moving at or above the run speed */
+	Run,
+
+	/** In the air */
+	Falling
+};
+
+/**
+ *  How a combat enemy's pose is currently evaluated
+ */
+UENUM(BlueprintType)
+enum class ECombatAnimSharingRole : uint8
+{
+	/** Evaluates its own pose for itself only */
+	Solo,
+
+	/** Evaluates its own pose, which is also copied by its followers */
+	Leader,
+
+	/** Copies a leader's pose instead of evaluating its own */
+	Follower
+};
+
+/**
+ *  Enemies with the same mesh, anim class and locomotion state share a pose
+ */
+struct FCombatAnimSharingKey
+{
+	const USkeletalMesh* Mesh = nullptr;
+	const UClass* AnimClass = nullptr;
+	ECombatAnimSharingState State = ECombatAnimSharingState::None;
+
+	bool operator==(const FCombatAnimSharingKey& Other) const
+	{
+		return Mesh == Other.Mesh && AnimClass == Other.AnimClass && State == Other.State;
+	}
+
+	friend uint32 GetTypeHash(const FCombatAnimSharingKey& Key)
+	{
+		return HashCombine(HashCombine(PointerHash(Key.Mesh), PointerHash(Key.AnimClass)), ::GetTypeHash(Key.State));
+	}
+};
+
+/**
+ *  A registered enemy and its place in the sharing groups
+ */
+struct FCombatAnimSharingMember
+{
+	/** Enemy sharing its pose */
+	TWeakObjectPtr<ACombatEnemy> Enemy;
+
+	/** Handle of the member we copy the pose from. None if we evaluate our own */
+	int32 LeaderHandle = INDEX_NONE;
+
+	/** Number of members copying our pose */
+	int32 NumFollowers = 0;
+
+	/** If true, this slot holds a registered enemy */
+	bool bRegistered = false;
+};
+
+/**
+ *  Lets combat enemies in the same locomotion state share one evaluated pose instead of each running its own anim graph.
+ *  Every update, enemies are grouped by mesh, anim class and locomotion state. One leader per group, or a few for large groups,
+ *  evaluates its graph and the rest follow its pose through the leader pose component.
+ *  Attacking, recently damaged, dead and sleeping enemies always evaluate their own pose.
+ *  Leaders and solo enemies go through the animation budget allocator, so animation cost scales with the number of
+ *  distinct states on screen rather than the number of enemies, and degrades gracefully under load.
+ */
+UCLASS()
+class UCombatAnimSharingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Registered enemies, indexed by handle */
+	TArray<FCombatAnimSharingMember> Members;
+
+	/** Free member handles */
+	TArray<int32> FreeMemberHandles;
+
+	/** Members in each sharing group, rebuilt every update */
+	TMap<FCombatAnimSharingKey, TArray<int32>> Groups;
+
+	/** Scratch list of the leaders of the group being updated */
+	TArray<int32> GroupLeaders;
+
+	/** Time accumulated since the last update */
+	float TimeSinceLastUpdate = 0.0f;
+
+	/** If true, sharing was enabled on the last update */
+	bool bWasEnabled = false;
+
+public:
+
+	/** Starts sharing an enemy's pose and returns its handle */
+	int32 RegisterEnemy(ACombatEnemy* Enemy);
+
+	/** Stops sharing an enemy's pose and releases its handle */
+	void UnregisterEnemy(int32 MemberHandle);
+
+	/** Makes an enemy evaluate its own pose right away, e.g. before it plays a montage. It can rejoin a group on the next update */
+	void StopSharing(int32 MemberHandle);
+
+	/** Returns the locomotion state an enemy can share a pose in */
+	static ECombatAnimSharingState ComputeState(const ACombatEnemy* Enemy);
+
+	/** Logs the number of enemies per role and the number of distinct groups. Bound to the Combat.AnimSharing.Stats console command */
+	static void DumpStats(const TArray<FString>& Args, UWorld* World);
+
+protected:
+
+	/** Regroups all registered enemies and reassigns leaders */
+	void UpdateGroups();
+
+	/** Picks the leaders of a group and assigns the rest as their followers */
+	void UpdateGroup(const TArray<int32>& GroupHandles);
+
+	/** Points a member at a new leader, or at none to evaluate its own pose */
+	void SetLeader(int32 MemberHandle, int32 LeaderHandle);
+
+	/** Pushes a member's role to its enemy */
+	void UpdateRole(int32 MemberHandle);
+
+	/** Makes every member evaluate its own pose */
+	void StopSharingAll();
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Cleanup */
+	virtual void Deinitialize() override;
+
+public:
+
+	/** Runs group updates at a fixed interval */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
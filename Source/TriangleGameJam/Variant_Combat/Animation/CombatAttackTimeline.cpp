@@ -0,0 +1,178 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatAttackTimeline.h"
+#include "Animation/AnimMontage.h"
+#include "AnimNotify_DoAttackTrace.h"
+#include "AnimNotify_CheckCombo.h"
+#include "AnimNotify_CheckChargedAttack.h"
+
+bool FCombatAttackTimeline::Build(const UAnimMontage* Montage)
+{
+	Sections.Reset();
+	PlayRate = 1.0f;
+
+	if (!Montage)
+	{
+		return false;
+	}
+
+	PlayRate = Montage->RateScale;
+
+	// copy the section layout
+	for (int32 SectionIndex = 0; SectionIndex < Montage->CompositeSections.Num(); ++SectionIndex)
+	{
+		const FCompositeSection& MontageSection = Montage->CompositeSections[SectionIndex];
+
+		FCombatAttackTimelineSection& Section = Sections.AddDefaulted_GetRef();
+		Section.Name = MontageSection.SectionName;
+		Section.NextSectionIndex = Montage->GetSectionIndex(MontageSection.NextSectionName);
+		Montage->GetSectionStartAndEndTime(SectionIndex, Section.StartTime, Section.EndTime);
+	}
+
+	// sort the gameplay notifies into their sections
+	for (const FAnimNotifyEvent& NotifyEvent : Montage->Notifies)
+	{
+		FCombatAttackTimelineEvent Event;
+		Event.Time = NotifyEvent.GetTriggerTime();
+
+		if (const UAnimNotify_DoAttackTrace* AttackTraceNotify = Cast<UAnimNotify_DoAttackTrace>(NotifyEvent.Notify))
+		{
+			Event.Type = ECombatAttackEvent::AttackTrace;
+			Event.BoneName = AttackTraceNotify->GetAttackBoneName();
+		}
+		else if (Cast<UAnimNotify_CheckCombo>(NotifyEvent.Notify))
+		{
+			Event.Type = ECombatAttackEvent::CheckCombo;
+		}
+		else if (Cast<UAnimNotify_CheckChargedAttack>(NotifyEvent.Notify))
+		{
+			Event.Type = ECombatAttackEvent::CheckChargedAttack;
+		}
+		else
+		{
+			// not a gameplay notify
+			continue;
+		}
+
+		const int32 SectionIndex = Montage->GetSectionIndexFromPosition(Event.Time);
+
+		if (Sections.IsValidIndex(SectionIndex))
+		{
+			Sections[SectionIndex].Events.Add(Event);
+		}
+	}
+
+	for (FCombatAttackTimelineSection& Section : Sections)
+	{
+		Section.Events.Sort([](const FCombatAttackTimelineEvent& A, const FCombatAttackTimelineEvent& B) { return A.Time < B.Time; });
+	}
+
+	return IsValid();
+}
+
+int32 FCombatAttackTimeline::FindSection(FName SectionName) const
+{
+	return Sections.IndexOfByPredicate([SectionName](const FCombatAttackTimelineSection& Section) { return Section.Name == SectionName; });
+}
+
+void FCombatAttackClock::Start(const FCombatAttackTimeline& InTimeline)
+{
+	Timeline = InTimeline.IsValid() ? &InTimeline : nullptr;
+	SectionIndex = 0;
+	Position = Timeline ? Timeline->Sections[0].StartTime : 0.0f;
+	NextEventIndex = 0;
+	FiringEventTime = -1.0f;
+}
+
+void FCombatAttackClock::JumpToSection(FName SectionName)
+{
+	if (!Timeline)
+	{
+		return;
+	}
+
+	const int32 NewSectionIndex = Timeline->FindSection(SectionName);
+
+	if (NewSectionIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	// when jumping from an event, keep the time that has already elapsed past it
+	const float LeftoverTime = FiringEventTime >= 0.0f ? FMath::Max(0.0f, Position - FiringEventTime) : 0.0f;
+
+	SectionIndex = NewSectionIndex;
+	Position = Timeline->Sections[SectionIndex].StartTime + LeftoverTime;
+	NextEventIndex = 0;
+}
+
+bool FCombatAttackClock::Advance(float DeltaTime, TFunctionRef<void(const FCombatAttackTimelineEvent&)> OnEvent)
+{
+	if (!Timeline)
+	{
+		return false;
+	}
+
+	Position += DeltaTime * Timeline->PlayRate;
+
+	// bound the number of section changes per update in case of looping sections
+	constexpr int32 MaxSectionChanges = 32;
+
+	for (int32 SectionChange = 0; SectionChange < MaxSectionChanges; ++SectionChange)
+	{
+		const FCombatAttackTimelineSection& Section = Timeline->Sections[SectionIndex];
+		const int32 PlayingSectionIndex = SectionIndex;
+		bool bJumped = false;
+
+		// fire the events we've passed
+		while (NextEventIndex < Section.Events.Num() && Section.Events[NextEventIndex].Time <= Position)
+		{
+			const FCombatAttackTimelineEvent& Event = Section.Events[NextEventIndex++];
+
+			FiringEventTime = Event.Time;
+			OnEvent(Event);
+			FiringEventTime = -1.0f;
+
+			// the event may have stopped playback
+			if (!Timeline)
+			{
+				return false;
+			}
+
+			// or jumped to another section
+			if (SectionIndex != PlayingSectionIndex || NextEventIndex == 0)
+			{
+				bJumped = true;
+				break;
+			}
+		}
+
+		if (bJumped)
+		{
+			continue;
+		}
+
+		// still inside the section
+		if (Position < Section.EndTime)
+		{
+			return true;
+		}
+
+		// the montage ends here
+		if (!Timeline->Sections.IsValidIndex(Section.NextSectionIndex))
+		{
+			Stop();
+			return false;
+		}
+
+		// move on to the linked section
+		const float LeftoverTime = Position - Section.EndTime;
+
+		SectionIndex = Section.NextSectionIndex;
+		Position = Timeline->Sections[SectionIndex].StartTime + LeftoverTime;
+		NextEventIndex = 0;
+	}
+
+	return true;
+}
@@ -0,0 +1,137 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "CombatAttackTimeline.generated.h"
+
+class UAnimMontage;
+
+/**
+ *  Gameplay events extracted from attack montage notifies
+ */
+UENUM()
+enum class ECombatAttackEvent : uint8
+{
+	/** From UAnimNotify_DoAttackTrace */
+	AttackTrace,
+
+	/** From UAnimNotify_CheckCombo */
+	CheckCombo,
+
+	/** From UAnimNotify_CheckChargedAttack */
+	CheckChargedAttack
+};
+
+/**
+ *  A gameplay event at a point in an attack montage
+ */
+USTRUCT()
+struct FCombatAttackTimelineEvent
+{
+	GENERATED_BODY()
+
+	/** Montage position the event fires at */
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	float Time = 0.0f;
+
+	/** Event type */
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	ECombatAttackEvent Type = ECombatAttackEvent::AttackTrace;
+
+	/** Source bone for attack traces */
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	FName BoneName;
+};
+
+/**
+ *  A montage section and the events that fire in it
+ */
+USTRUCT()
+struct FCombatAttackTimelineSection
+{
+	GENERATED_BODY()
+
+	/** Montage section name */
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	FName Name;
+
+	/** Montage positions the section starts and ends at */
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	float StartTime = 0.0f;
+
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	float EndTime = 0.0f;
+
+	/** Index of the section that plays next, or INDEX_NONE if the montage ends here */
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	int32 NextSectionIndex = INDEX_NONE;
+
+	/** Events in this section, sorted by time */
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	TArray<FCombatAttackTimelineEvent> Events;
+};
+
+/**
+ *  Section layout and gameplay events of an attack montage, extracted ahead of time
+ *  so attacks can run on a gameplay clock regardless of how often the animation updates.
+ */
+USTRUCT()
+struct FCombatAttackTimeline
+{
+	GENERATED_BODY()
+
+	/** Sections in montage order */
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	TArray<FCombatAttackTimelineSection> Sections;
+
+	/** Montage play rate */
+	UPROPERTY(VisibleAnywhere, Category="Timeline")
+	float PlayRate = 1.0f;
+
+	/** Extracts the timeline from a montage. Returns false if the montage has no sections */
+	bool Build(const UAnimMontage* Montage);
+
+	/** Returns true if the timeline holds any sections */
+	bool IsValid() const { return Sections.Num() > 0; }
+
+	/** Returns the index of a section by name, or INDEX_NONE */
+	int32 FindSection(FName SectionName) const;
+};
+
+/**
+ *  Plays back an attack timeline on game time and fires its events
+ */
+struct FCombatAttackClock
+{
+	/** Timeline being played. Null while stopped */
+	const FCombatAttackTimeline* Timeline = nullptr;
+
+	/** Section currently playing */
+	int32 SectionIndex = 0;
+
+	/** Current montage position */
+	float Position = 0.0f;
+
+	/** Next event to fire in the current section */
+	int32 NextEventIndex = 0;
+
+	/** Time of the event being fired, so jumps can carry the leftover time over */
+	float FiringEventTime = -1.0f;
+
+	/** Starts playing a timeline from its first section */
+	void Start(const FCombatAttackTimeline& InTimeline);
+
+	/** Stops playback */
+	void Stop() { Timeline = nullptr; }
+
+	/** Returns true while a timeline is playing */
+	bool IsRunning() const { return Timeline != nullptr; }
+
+	/** Moves playback to the start of a section */
+	void JumpToSection(FName SectionName);
+
+	/** Advances playback and fires every event passed. Returns false once the timeline has ended or was stopped */
+	bool Advance(float DeltaTime, TFunctionRef<void(const FCombatAttackTimelineEvent&)> OnEvent);
+};
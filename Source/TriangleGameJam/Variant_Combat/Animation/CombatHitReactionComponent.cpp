@@ -0,0 +1,65 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatHitReactionComponent.h"
+#include "GameFramework/Actor.h"
+
+UCombatHitReactionComponent::UCombatHitReactionComponent()
+{
+	// only tick while reacting
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+bool UCombatHitReactionComponent::ReactToHit(const FVector& DamageImpulse)
+{
+	// lean along the impulse, in the owner's frame
+	const FVector LocalImpulse = GetOwner()->GetActorTransform().InverseTransformVectorNoScale(DamageImpulse);
+
+	LeanVelocity += FVector2D(LocalImpulse.X, LocalImpulse.Y) * ImpulseToLeanVelocity;
+
+	SetComponentTickEnabled(true);
+
+	return bPartialRagdollOnHeavyHits && DamageImpulse.SizeSquared() >= FMath::Square(HeavyHitImpulse);
+}
+
+void UCombatHitReactionComponent::ResetReaction()
+{
+	Lean = FVector2D::ZeroVector;
+	LeanVelocity = FVector2D::ZeroVector;
+
+	SetComponentTickEnabled(false);
+}
+
+void UCombatHitReactionComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	// substep so the spring stays stable at low tick rates
+	constexpr float MaxStep = 1.0f / 60.0f;
+
+	float RemainingTime = DeltaTime;
+
+	while (RemainingTime > UE_KINDA_SMALL_NUMBER)
+	{
+		const float Step = FMath::Min(RemainingTime, MaxStep);
+		RemainingTime -= Step;
+
+		// semi-implicit Euler damped spring towards rest
+		LeanVelocity += (-Stiffness * Lean - Damping * LeanVelocity) * Step;
+		Lean += LeanVelocity * Step;
+
+		// don't fold the character in half on big hits
+		if (Lean.SizeSquared() > FMath::Square(MaxLeanAngle))
+		{
+			Lean = Lean.GetSafeNormal() * MaxLeanAngle;
+			LeanVelocity = FVector2D::ZeroVector;
+		}
+	}
+
+	// stop ticking once we've come back to rest
+	if (Lean.SizeSquared() < 0.01f && LeanVelocity.SizeSquared() < 0.01f)
+	{
+		ResetReaction();
+	}
+}
@@ -0,0 +1,72 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "CombatHitReactionComponent.generated.h"
+
+/**
+ *  Drives a procedural hit reaction lean from the damage impulse with a damped spring.
+ *  The lean is applied as an additive bone rotation by UCombatAnimInstance, so living characters
+ *  react to hits without turning on physics simulation. Only ticks while a reaction is playing.
+ */
+UCLASS(ClassGroup=(Combat), meta=(BlueprintSpawnableComponent))
+class UCombatHitReactionComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Lean velocity added per cm/s of damage impulse */
+	UPROPERTY(EditAnywhere, Category="Hit Reaction", meta = (ClampMin = 0, ClampMax = 10))
+	float ImpulseToLeanVelocity = 1.5f;
+
+	/** Maximum lean angle */
+	UPROPERTY(EditAnywhere, Category="Hit Reaction", meta = (ClampMin = 0, ClampMax = 90, Units = "Degrees"))
+	float MaxLeanAngle = 25.0f;
+
+	/** Spring stiffness pulling the lean back to rest */
+	UPROPERTY(EditAnywhere, Category="Hit Reaction", meta = (ClampMin = 0, ClampMax = 1000))
+	float Stiffness = 250.0f;
+
+	/** Spring damping. Around 2 * sqrt(Stiffness) gives a single overshoot-free recovery */
+	UPROPERTY(EditAnywhere, Category="Hit Reaction", meta = (ClampMin = 0, ClampMax = 100))
+	float Damping = 22.0f;
+
+	/** If true, heavy hits also blend in partial ragdoll physics on top of the lean */
+	UPROPERTY(EditAnywhere, Category="Hit Reaction")
+	bool bPartialRagdollOnHeavyHits = false;
+
+	/** Minimum damage impulse for a hit to count as heavy. Well above what regular melee combos deal */
+	UPROPERTY(EditAnywhere, Category="Hit Reaction", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm/s", EditCondition = "bPartialRagdollOnHeavyHits"))
+	float HeavyHitImpulse = 1500.0f;
+
+	/** Current lean. X leans forward, Y leans right */
+	FVector2D Lean = FVector2D::ZeroVector;
+
+	/** Current lean velocity */
+	FVector2D LeanVelocity = FVector2D::ZeroVector;
+
+public:
+
+	/** Constructor */
+	UCombatHitReactionComponent();
+
+	/** Starts a hit reaction from a damage impulse. Returns true if the hit is heavy enough for partial ragdoll physics */
+	bool ReactToHit(const FVector& DamageImpulse);
+
+	/** Stops any reaction in progress */
+	void ResetReaction();
+
+	/** Returns the current lean as a component space rotation to apply additively */
+	FRotator GetLeanRotation() const { return FRotator(-Lean.X, 0.0f, Lean.Y); }
+
+	/** Returns true while a reaction is playing */
+	bool IsReacting() const { return IsComponentTickEnabled(); }
+
+public:
+
+	/** Advances the lean spring */
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+};
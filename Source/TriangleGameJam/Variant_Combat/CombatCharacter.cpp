@@ -3,18 +3,24 @@
 
 #include "CombatCharacter.h"
 #include "Components/CapsuleComponent.h"
-#include "Components/WidgetComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Camera/CameraComponent.h"
 #include "EnhancedInputSubsystems.h"
 #include "EnhancedInputComponent.h"
-#include "CombatLifeBar.h"
+#include "CombatLifeBarSubsystem.h"
 #include "Engine/DamageEvents.h"
 #include "TimerManager.h"
 #include "Engine/LocalPlayer.h"
 #include "CombatPlayerController.h"
+#include "CombatMeleeSubsystem.h"
+#include "CombatRagdollSubsystem.h"
+#include "CombatHitReactionComponent.h"
+#include "TriangleGameJamAssetStreaming.h"
+#include "EffectDispatcherSubsystem.h"
+#include "CombatPerceptionSubsystem.h"
+#include "CombatPropSubsystem.h"
 
 ACombatCharacter::ACombatCharacter()
 {
@@ -43,9 +49,8 @@ ACombatCharacter::ACombatCharacter()
 	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
 	FollowCamera->bUsePawnControlRotation = false;
 
-	// create the life bar widget component
-	LifeBar = CreateDefaultSubobject<UWidgetComponent>(TEXT("LifeBar"));
-	LifeBar->SetupAttachment(RootComponent);
+	// create the hit reaction
+	HitReaction = CreateDefaultSubobject<UCombatHitReactionComponent>(TEXT("HitReaction"));
 
 	// set the player tag
 	Tags.Add(FName("Player"));
@@ -170,7 +175,10 @@ void ACombatCharacter::ResetHP()
 	CurrentHP = MaxHP;
 
 	// update the life bar
-	LifeBarWidget->SetLifePercentage(1.0f);
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifePercentage(LifeBarHandle, 1.0f);
+	}
 }
 
 void ACombatCharacter::ComboAttack()
@@ -184,16 +192,24 @@ void ACombatCharacter::ComboAttack()
 	// play the attack montage
 	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 	{
-		const float MontageLength = AnimInstance->Montage_Play(ComboAttackMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
+		// start a new swing
+		++MeleeSwingId;
+
+		// the montage is normally streamed in by now, but load it if we attack before it's done
+		UAnimMontage* AttackMontage = ComboAttackMontage.LoadSynchronous();
+
+		const float MontageLength = AnimInstance->Montage_Play(AttackMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
 
 		// subscribe to montage completed and interrupted events
 		if (MontageLength > 0.0f)
 		{
 			// set the end delegate for the montage
-			AnimInstance->Montage_SetEndDelegate(OnAttackMontageEnded, ComboAttackMontage);
+			AnimInstance->Montage_SetEndDelegate(OnAttackMontageEnded, AttackMontage);
 		}
 	}
 
+	// we're fighting now, so get the charged attack ready
+	PreloadChargedAttackAssets();
 }
 
 void ACombatCharacter::ChargedAttack()
@@ -207,13 +223,19 @@ void ACombatCharacter::ChargedAttack()
 	// play the charged attack montage
 	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 	{
-		const float MontageLength = AnimInstance->Montage_Play(ChargedAttackMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
+		// start a new swing
+		++MeleeSwingId;
+
+		// the montage is normally streamed in after the first combo attack, but load it if we open with a charged attack
+		UAnimMontage* AttackMontage = ChargedAttackMontage.LoadSynchronous();
+
+		const float MontageLength = AnimInstance->Montage_Play(AttackMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
 
 		// subscribe to montage completed and interrupted events
 		if (MontageLength > 0.0f)
 		{
 			// set the end delegate for the montage
-			AnimInstance->Montage_SetEndDelegate(OnAttackMontageEnded, ChargedAttackMontage);
+			AnimInstance->Montage_SetEndDelegate(OnAttackMontageEnded, AttackMontage);
 		}
 	}
 }
@@ -242,49 +264,43 @@ void ACombatCharacter::AttackMontageEnded(UAnimMontage* Montage, bool bInterrupt
 
 void ACombatCharacter::DoAttackTrace(FName DamageSourceBone)
 {
-	// sweep for objects in front of the character to be hit by the attack
-	TArray<FHitResult> OutHits;
+	// sweep for objects in front of the character to be hit by the attack.
+	// The sweep is batched with every other attack this frame and each victim is only damaged once per swing
+	FCombatMeleeSweep Sweep;
+	Sweep.Attacker = this;
+	Sweep.SwingId = MeleeSwingId;
 
 	// start at the provided socket location, sweep forward
-	const FVector TraceStart = GetMesh()->GetSocketLocation(DamageSourceBone);
-	const FVector TraceEnd = TraceStart + (GetActorForwardVector() * MeleeTraceDistance);
+	Sweep.Start = GetMesh()->GetSocketLocation(DamageSourceBone);
+	Sweep.End = Sweep.Start + (GetActorForwardVector() * MeleeTraceDistance);
+	Sweep.Radius = MeleeTraceRadius;
 
 	// check for pawn and world dynamic collision object types
-	FCollisionObjectQueryParams ObjectParams;
-	ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
-	ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
-
-	// use a sphere shape for the sweep
-	FCollisionShape CollisionShape;
-	CollisionShape.SetSphere(MeleeTraceRadius);
+	Sweep.ObjectParams.AddObjectTypesToQuery(ECC_Pawn);
+	Sweep.ObjectParams.AddObjectTypesToQuery(ECC_WorldDynamic);
 
-	// ignore self
-	FCollisionQueryParams QueryParams;
-	QueryParams.AddIgnoredActor(this);
+	Sweep.Damage = MeleeDamage;
+	Sweep.KnockbackImpulse = MeleeKnockbackImpulse;
+	Sweep.LaunchImpulse = MeleeLaunchImpulse;
 
-	if (GetWorld()->SweepMultiByObjectType(OutHits, TraceStart, TraceEnd, FQuat::Identity, ObjectParams, CollisionShape, QueryParams))
+	// the swing can be heard by nearby enemies, even if they can't see us
+	if (UCombatPerceptionSubsystem* Perception = GetWorld()->GetSubsystem<UCombatPerceptionSubsystem>())
 	{
-		// iterate over each object hit
-		for (const FHitResult& CurrentHit : OutHits)
-		{
-			// check if we've hit a damageable actor
-			ICombatDamageable* Damageable = Cast<ICombatDamageable>(CurrentHit.GetActor());
-
-			if (Damageable)
-			{
-				// knock upwards and away from the impact normal
-				const FVector Impulse = (CurrentHit.ImpactNormal * -MeleeKnockbackImpulse) + (FVector::UpVector * MeleeLaunchImpulse);
-
-				// pass the damage event to the actor
-				Damageable->ApplyDamage(MeleeDamage, this, CurrentHit.ImpactPoint, Impulse);
+		Perception->ReportNoise(Sweep.Start, AttackNoiseLoudness, this);
+	}
 
-				// call the BP handler to play effects, etc.
-				DealtDamage(MeleeDamage, CurrentHit.ImpactPoint);
-			}
-		}
+	if (UCombatMeleeSubsystem* MeleeSubsystem = GetWorld()->GetSubsystem<UCombatMeleeSubsystem>())
+	{
+		MeleeSubsystem->QueueSweep(MoveTemp(Sweep));
 	}
 }
 
+void ACombatCharacter::NotifyMeleeHit(AActor* Victim, float Damage, const FVector& ImpactPoint)
+{
+	// call the BP handler to play effects, etc.
+	DealtDamage(Damage, ImpactPoint);
+}
+
 void ACombatCharacter::CheckCombo()
 {
 	// are we playing a non-charge attack animation?
@@ -305,7 +321,8 @@ void ACombatCharacter::CheckCombo()
 				// jump to the next combo section
 				if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 				{
-					AnimInstance->Montage_JumpToSection(ComboSectionNames[ComboCount], ComboAttackMontage);
+					++MeleeSwingId;
+					AnimInstance->Montage_JumpToSection(ComboSectionNames[ComboCount], ComboAttackMontage.Get());
 				}
 			}
 		}
@@ -320,7 +337,8 @@ void ACombatCharacter::CheckChargedAttack()
 	// jump to either the loop or the attack section depending on whether we're still holding the charge button
 	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 	{
-		AnimInstance->Montage_JumpToSection(bIsChargingAttack ? ChargeLoopSection : ChargeAttackSection, ChargedAttackMontage);
+		++MeleeSwingId;
+		AnimInstance->Montage_JumpToSection(bIsChargingAttack ? ChargeLoopSection : ChargeAttackSection, ChargedAttackMontage.Get());
 	}
 }
 
@@ -333,6 +351,14 @@ void ACombatCharacter::ApplyDamage(float Damage, AActor* DamageCauser, const FVe
 	// only process knockback and effects if we received nonzero damage
 	if (ActualDamage > 0.0f)
 	{
+		// play a procedural hit reaction while alive. Only heavy hits fall back to partial ragdoll physics
+		if (CurrentHP > 0.0f && HitReaction->ReactToHit(DamageImpulse))
+		{
+			// enable partial ragdoll physics, but keep the pelvis vertical
+			GetMesh()->SetPhysicsBlendWeight(0.5f);
+			GetMesh()->SetBodySimulatePhysics(PelvisBoneName, false);
+		}
+
 		// apply the knockback impulse
 		GetCharacterMovement()->AddImpulse(DamageImpulse, true);
 
@@ -343,6 +369,12 @@ void ACombatCharacter::ApplyDamage(float Damage, AActor* DamageCauser, const FVe
 			GetMesh()->AddImpulseAtLocation(DamageImpulse * GetMesh()->GetMass(), DamageLocation);
 		}
 
+		// play the pooled impact effects
+		if (UEffectDispatcherSubsystem* EffectDispatcher = GetWorld()->GetSubsystem<UEffectDispatcherSubsystem>())
+		{
+			EffectDispatcher->PlayEffectAtLocation(HitEffect, HitSound, DamageLocation, DamageImpulse.Rotation());
+		}
+
 		// pass control to BP to play effects, etc.
 		ReceivedDamage(ActualDamage, DamageLocation, DamageImpulse.GetSafeNormal());
 	}
@@ -354,11 +386,17 @@ void ACombatCharacter::HandleDeath()
 	// disable movement while we're dead
 	GetCharacterMovement()->DisableMovement();
 
-	// enable full ragdoll physics
-	GetMesh()->SetSimulatePhysics(true);
+	// enable full ragdoll physics. The ragdoll budget freezes it once it comes to rest
+	if (UCombatRagdollSubsystem* RagdollSubsystem = GetWorld()->GetSubsystem<UCombatRagdollSubsystem>())
+	{
+		RagdollSubsystem->StartRagdoll(GetMesh());
+	}
 
 	// hide the life bar
-	LifeBar->SetHiddenInGame(true);
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifeBarVisible(LifeBarHandle, false);
+	}
 
 	// pull back the camera
 	GetCameraBoom()->TargetArmLength = DeathCameraDistance;
@@ -374,8 +412,69 @@ void ACombatCharacter::ApplyHealing(float Healing, AActor* Healer)
 
 void ACombatCharacter::RespawnCharacter()
 {
-	// destroy the character and let it be respawned by the Player Controller
-	Destroy();
+	ACombatPlayerController* PC = Cast<ACombatPlayerController>(GetController());
+
+	// without a combat Player Controller to hold the checkpoint, destroy the character instead
+	if (!PC)
+	{
+		Destroy();
+		return;
+	}
+
+	// stop any attacks in progress
+	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
+	{
+		AnimInstance->StopAllMontages(0.0f);
+	}
+
+	bIsAttacking = false;
+	bIsChargingAttack = false;
+	bHasLoopedChargedAttack = false;
+	ComboCount = 0;
+	CachedAttackInputTime = 0.0f;
+
+	// stop any hit reaction in progress
+	HitReaction->ResetReaction();
+
+	// stop the ragdoll and put the mesh back in place
+	if (UCombatRagdollSubsystem* RagdollSubsystem = GetWorld()->GetSubsystem<UCombatRagdollSubsystem>())
+	{
+		RagdollSubsystem->StopRagdoll(GetMesh());
+	}
+
+	GetMesh()->SetSimulatePhysics(false);
+	GetMesh()->SetPhysicsBlendWeight(0.0f);
+	GetMesh()->AttachToComponent(GetCapsuleComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+	GetMesh()->SetRelativeTransform(MeshStartingTransform);
+
+	// move to the checkpoint
+	const FTransform& RespawnTransform = PC->GetRespawnTransform();
+
+	SetActorLocationAndRotation(RespawnTransform.GetLocation(), RespawnTransform.GetRotation(), false, nullptr, ETeleportType::ResetPhysics);
+	PC->SetControlRotation(RespawnTransform.Rotator());
+
+	// put the breakable props back in place for the next attempt
+	if (HasAuthority())
+	{
+		if (UCombatPropSubsystem* Props = GetWorld()->GetSubsystem<UCombatPropSubsystem>())
+		{
+			Props->ResetProps();
+		}
+	}
+
+	// restore movement
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->SetDefaultMovementMode();
+
+	// restore the camera
+	GetCameraBoom()->TargetArmLength = DefaultCameraDistance;
+
+	// refill and show the life bar
+	ResetHP();
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->SetLifeBarVisible(LifeBarHandle, true);
+	}
 }
 
 float ACombatCharacter::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
@@ -398,11 +497,10 @@ float ACombatCharacter::TakeDamage(float Damage, struct FDamageEvent const& Dama
 	else
 	{
 		// update the life bar
-		LifeBarWidget->SetLifePercentage(CurrentHP / MaxHP);
-
-		// enable partial ragdoll physics, but keep the pelvis vertical
-		GetMesh()->SetPhysicsBlendWeight(0.5f);
-		GetMesh()->SetBodySimulatePhysics(PelvisBoneName, false);
+		if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+		{
+			LifeBars->SetLifePercentage(LifeBarHandle, CurrentHP / MaxHP);
+		}
 	}
 
 	// return the received damage amount
@@ -425,9 +523,14 @@ void ACombatCharacter::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// get the life bar from the widget component
-	LifeBarWidget = Cast<UCombatLifeBar>(LifeBar->GetUserWidgetObject());
-	check(LifeBarWidget);
+	// stream in the combo montage ahead of the first attack. The charged attack streams in once we start fighting
+	PreloadAttackAssets();
+
+	// add our life bar to the batched renderer
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBarHandle = LifeBars->RegisterLifeBar(this, LifeBarOffset, LifeBarColor);
+	}
 
 	// initialize the camera
 	GetCameraBoom()->TargetArmLength = DefaultCameraDistance;
@@ -435,9 +538,6 @@ void ACombatCharacter::BeginPlay()
 	// save the relative transform for the mesh so we can reset the ragdoll later
 	MeshStartingTransform = GetMesh()->GetRelativeTransform();
 
-	// set the life bar color
-	LifeBarWidget->SetBarColor(LifeBarColor);
-
 	// reset HP to maximum
 	ResetHP();
 }
@@ -448,6 +548,32 @@ void ACombatCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 
 	// clear the respawn timer
 	GetWorld()->GetTimerManager().ClearTimer(RespawnTimer);
+
+	// remove the life bar
+	if (UCombatLifeBarSubsystem* LifeBars = GetWorld()->GetSubsystem<UCombatLifeBarSubsystem>())
+	{
+		LifeBars->UnregisterLifeBar(LifeBarHandle);
+	}
+
+	LifeBarHandle = INDEX_NONE;
+
+	// let the attack montages unload once nothing else uses them
+	TriangleGameJamAssetStreaming::ReleaseAssets(AttackAssetsHandle);
+	TriangleGameJamAssetStreaming::ReleaseAssets(ChargedAttackAssetsHandle);
+}
+
+void ACombatCharacter::PreloadAttackAssets()
+{
+	AttackAssetsHandle = TriangleGameJamAssetStreaming::RequestAssets({ ComboAttackMontage.ToSoftObjectPath() });
+}
+
+void ACombatCharacter::PreloadChargedAttackAssets()
+{
+	// only request once
+	if (!ChargedAttackAssetsHandle.IsValid())
+	{
+		ChargedAttackAssetsHandle = TriangleGameJamAssetStreaming::RequestAssets({ ChargedAttackMontage.ToSoftObjectPath() });
+	}
 }
 
 void ACombatCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -13,8 +13,10 @@ class USpringArmComponent;
 class UCameraComponent;
 class UInputAction;
 struct FInputActionValue;
-class UCombatLifeBar;
-class UWidgetComponent;
+class UCombatHitReactionComponent;
+struct FStreamableHandle;
+class UNiagaraSystem;
+class USoundBase;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogCombatCharacter, Log, All);
 
@@ -39,9 +41,9 @@ class ACombatCharacter : public ACharacter, public ICombatAttacker, public IComb
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
 	UCameraComponent* FollowCamera;
 
-	/** Life bar widget component */
+	/** Procedural hit reaction */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
-	UWidgetComponent* LifeBar;
+	UCombatHitReactionComponent* HitReaction;
 	
 protected:
 
@@ -77,17 +79,28 @@ protected:
 	UPROPERTY(VisibleAnywhere, Category="Damage")
 	float CurrentHP = 0.0f;
 
-	/** Life bar widget fill color */
+	/** Life bar fill color */
 	UPROPERTY(EditAnywhere, Category="Damage")
 	FLinearColor LifeBarColor;
 
+	/** Impact effect played through the pooled effect dispatcher when damaged. Leave empty if the Blueprint damage event plays its own */
+	UPROPERTY(EditAnywhere, Category="Damage|Effects")
+	UNiagaraSystem* HitEffect;
+
+	/** Impact sound played through the pooled effect dispatcher when damaged. Leave empty if the Blueprint damage event plays its own */
+	UPROPERTY(EditAnywhere, Category="Damage|Effects")
+	USoundBase* HitSound;
+
+	/** Life bar position relative to the actor */
+	UPROPERTY(EditAnywhere, Category="Damage")
+	FVector LifeBarOffset = FVector(0.0f, 0.0f, 120.0f);
+
 	/** Name of the pelvis bone, for damage ragdoll physics */
 	UPROPERTY(EditAnywhere, Category="Damage")
 	FName PelvisBoneName;
 
-	/** Pointer to the life bar widget */
-	UPROPERTY(EditAnywhere, Category="Damage")
-	TObjectPtr<UCombatLifeBar> LifeBarWidget;
+	/** Handle on the batched life bar renderer */
+	int32 LifeBarHandle = INDEX_NONE;
 
 	/** Max amount of time that may elapse for a non-combo attack input to not be considered stale */
 	UPROPERTY(EditAnywhere, Category="Melee Attack", meta = (ClampMin = 0, ClampMax = 5, Units = "s"))
@@ -119,9 +132,13 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Damage", meta = (ClampMin = 0, ClampMax = 1000, Units = "cm/s"))
 	float MeleeLaunchImpulse = 300.0f;
 
-	/** AnimMontage that will play for combo attacks */
+	/** Loudness of each attack swing. Scales the distance at which enemies hear it */
+	UPROPERTY(EditAnywhere, Category="Melee Attack|Noise", meta = (ClampMin = 0, ClampMax = 10))
+	float AttackNoiseLoudness = 1.0f;
+
+	/** AnimMontage that will play for combo attacks. Streamed in on BeginPlay */
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Combo")
-	UAnimMontage* ComboAttackMontage;
+	TSoftObjectPtr<UAnimMontage> ComboAttackMontage;
 
 	/** Names of the AnimMontage sections that correspond to each stage of the combo attack */
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Combo")
@@ -134,9 +151,9 @@ protected:
 	/** Index of the current stage of the melee attack combo */
 	int32 ComboCount = 0;
 
-	/** AnimMontage that will play for charged attacks */
+	/** AnimMontage that will play for charged attacks. Streamed in on the first combo attack */
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Charged")
-	UAnimMontage* ChargedAttackMontage;
+	TSoftObjectPtr<UAnimMontage> ChargedAttackMontage;
 
 	/** Name of the AnimMontage section that corresponds to the charge loop */
 	UPROPERTY(EditAnywhere, Category="Melee Attack|Charged")
@@ -152,6 +169,9 @@ protected:
 	/** If true, the charged attack hold check has been tested at least once */
 	bool bHasLoopedChargedAttack = false;
 
+	/** Identifies the current attack swing, so batched melee sweeps only hit each victim once per swing */
+	uint32 MeleeSwingId = 0;
+
 	/** Camera boom length while the character is dead */
 	UPROPERTY(EditAnywhere, Category="Camera", meta = (ClampMin = 0, ClampMax = 1000, Units = "cm"))
 	float DeathCameraDistance = 400.0f;
@@ -173,6 +193,12 @@ protected:
 	/** Copy of the mesh's transform so we can reset it after ragdoll animations */
 	FTransform MeshStartingTransform;
 
+	/** Keeps the combo attack montage resident while we're in play */
+	TSharedPtr<FStreamableHandle> AttackAssetsHandle;
+
+	/** Keeps the charged attack montage resident once we've started fighting */
+	TSharedPtr<FStreamableHandle> ChargedAttackAssetsHandle;
+
 public:
 	
 	/** Constructor */
@@ -249,6 +275,9 @@ public:
 	/** Performs the charged attack hold check */
 	virtual void CheckChargedAttack() override;
 
+	/** Plays the damage dealt effects for a batched melee hit */
+	virtual void NotifyMeleeHit(AActor* Victim, float Damage, const FVector& ImpactPoint) override;
+
 	// ~end CombatAttacker interface
 
 	// ~begin CombatDamageable interface
@@ -264,7 +293,7 @@ public:
 
 	// ~end CombatDamageable interface
 
-	/** Called from the respawn timer to destroy and re-create the character */
+	/** Called from the respawn timer to reset the character in place at the checkpoint */
 	void RespawnCharacter();
 
 public:
@@ -285,6 +314,12 @@ protected:
 	UFUNCTION(BlueprintImplementableEvent, Category="Combat")
 	void ReceivedDamage(float Damage, const FVector& ImpactPoint, const FVector& DamageDirection);
 
+	/** Starts streaming in the combo attack montage, which can be used from the first frame */
+	void PreloadAttackAssets();
+
+	/** Starts streaming in the charged attack montage once we've started fighting */
+	void PreloadChargedAttackAssets();
+
 protected:
 
 	/** Initialization */
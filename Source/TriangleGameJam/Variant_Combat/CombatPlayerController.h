@@ -12,7 +12,7 @@ class ACombatCharacter;
 /**
  *  Simple Player Controller for a third person combat game
  *  Manages input mappings
- *  Respawns the player character at the checkpoint when it's destroyed
+ *  Provides the checkpoint the player character respawns at, and spawns a new character if the possessed one is destroyed
  */
 UCLASS(abstract)
 class ACombatPlayerController : public APlayerController
@@ -59,6 +59,9 @@ public:
 	/** Updates the character respawn transform */
 	void SetRespawnTransform(const FTransform& NewRespawn);
 
+	/** Returns the character respawn transform */
+	const FTransform& GetRespawnTransform() const { return RespawnTransform; }
+
 protected:
 
 	/** Called if the possessed pawn is destroyed */
@@ -0,0 +1,486 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatBenchmarkSubsystem.h"
+#include "CombatEnemySpawner.h"
+#include "CombatCharacter.h"
+#include "CombatAnimInstance.h"
+#include "EngineUtils.h"
+#include "RenderCore.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/DateTime.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<float> CVarBenchmarkWarmupTime(
+	TEXT("Combat.Benchmark.WarmupTime"),
+	3.0f,
+	TEXT("Seconds to run the benchmark before recording, so spawning and loading hitches are left out."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarBenchmarkScatterRadius(
+	TEXT("Combat.Benchmark.ScatterRadius"),
+	1500.0f,
+	TEXT("Radius around each spawner that benchmark enemies are scattered in."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarBenchmarkFixedFrameRate(
+	TEXT("Combat.Benchmark.FixedFrameRate"),
+	30.0f,
+	TEXT("Frame rate the game is locked to while the benchmark runs, so every run simulates the same frames. 0 keeps a variable timestep."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<FString> CVarBenchmarkMap(
+	TEXT("Combat.Benchmark.Map"),
+	TEXT("Lvl_Combat"),
+	TEXT("Only this map starts a benchmark requested with -CombatBenchmark. Can be overridden with -CombatBenchmarkMap=<Name>."),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkStartCommand(
+	TEXT("Combat.Benchmark.Start"),
+	TEXT("Runs the combat benchmark. Usage: Combat.Benchmark.Start <EnemyCount> [Duration=30] [Seed=1]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UCombatBenchmarkSubsystem::StartCommand)
+);
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkStopCommand(
+	TEXT("Combat.Benchmark.Stop"),
+	TEXT("Stops the combat benchmark and writes the results recorded so far."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UCombatBenchmarkSubsystem::StopCommand)
+);
+
+/** Player inputs in one loop of the benchmark script */
+enum class ECombatBenchmarkInput : uint8
+{
+	ComboAttack,
+	ChargedAttackStart,
+	ChargedAttackEnd
+};
+
+struct FCombatBenchmarkScriptInput
+{
+	float Time;
+	ECombatBenchmarkInput Input;
+};
+
+/** A three hit combo string followed by a held charged attack */
+static const FCombatBenchmarkScriptInput BenchmarkScript[] = {
+	{ 0.0f, ECombatBenchmarkInput::ComboAttack },
+	{ 0.4f, ECombatBenchmarkInput::ComboAttack },
+	{ 0.8f, ECombatBenchmarkInput::ComboAttack },
+	{ 2.0f, ECombatBenchmarkInput::ChargedAttackStart },
+	{ 3.2f, ECombatBenchmarkInput::ChargedAttackEnd }
+};
+
+/** Length of one loop of the benchmark script */
+static constexpr float BenchmarkScriptLength = 4.0f;
+
+void UCombatBenchmarkSubsystem::StartBenchmark(int32 InEnemyCount, float InDuration, int32 InSeed)
+{
+	if (bRunning)
+	{
+		StopBenchmark();
+	}
+
+	EnemyCount = FMath::Max(0, InEnemyCount);
+	Duration = FMath::Max(1.0f, InDuration);
+	Seed = InSeed;
+
+	// seed both our stream and the global one, so anything still using FMath::Rand is repeatable too
+	Random.Initialize(Seed);
+	FMath::RandInit(Seed);
+
+	ElapsedTime = 0.0f;
+	ScriptTime = 0.0f;
+	NextScriptInput = 0;
+	Frames.Reset();
+	bRunning = true;
+
+	SetFixedTimeStep(true);
+	SetPhysicsTiming(true);
+	LastFrameTime = FPlatformTime::Seconds();
+
+	// only our own enemies should be in the run
+	SetSpawnersSuspended(true);
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Combat benchmark: %d enemies, %.0f s, seed %d"), EnemyCount, Duration, Seed);
+
+	SpawnEnemies();
+}
+
+void UCombatBenchmarkSubsystem::StopBenchmark()
+{
+	if (!bRunning)
+	{
+		return;
+	}
+
+	bRunning = false;
+
+	SetFixedTimeStep(false);
+	SetPhysicsTiming(false);
+	SetSpawnersSuspended(false);
+
+#if CSV_PROFILER
+	if (FCsvProfiler::Get()->IsCapturing())
+	{
+		FCsvProfiler::Get()->EndCapture();
+	}
+#endif
+
+	WriteResults();
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UCombatBenchmarkSubsystem::StartCommand(const TArray<FString>& Args, UWorld* World)
+{
+	UCombatBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<UCombatBenchmarkSubsystem>() : nullptr;
+
+	if (!Benchmark || Args.Num() < 1)
+	{
+		return;
+	}
+
+	const int32 InEnemyCount = FCString::Atoi(*Args[0]);
+	const float InDuration = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 30.0f;
+	const int32 InSeed = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 1;
+
+	Benchmark->StartBenchmark(InEnemyCount, InDuration, InSeed);
+}
+
+void UCombatBenchmarkSubsystem::StopCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (UCombatBenchmarkSubsystem* Benchmark = World ? World->GetSubsystem<UCombatBenchmarkSubsystem>() : nullptr)
+	{
+		Benchmark->StopBenchmark();
+	}
+}
+
+void UCombatBenchmarkSubsystem::SpawnEnemies()
+{
+	// sort the spawners by name so the enemies are always split the same way
+	TArray<ACombatEnemySpawner*> Spawners;
+
+	for (TActorIterator<ACombatEnemySpawner> It(GetWorld()); It; ++It)
+	{
+		Spawners.Add(*It);
+	}
+
+	if (Spawners.Num() == 0)
+	{
+		UE_LOG(LogTriangleGameJam, Warning, TEXT("Combat benchmark: no enemy spawners in the level."));
+		return;
+	}
+
+	Spawners.Sort([](const ACombatEnemySpawner& A, const ACombatEnemySpawner& B) { return A.GetFName().LexicalLess(B.GetFName()); });
+
+	const float ScatterRadius = CVarBenchmarkScatterRadius.GetValueOnGameThread();
+	int32 NumSpawned = 0;
+
+	for (int32 SpawnerIndex = 0; SpawnerIndex < Spawners.Num(); ++SpawnerIndex)
+	{
+		// split the count evenly, giving the remainder to the first spawners
+		const int32 SpawnerCount = EnemyCount / Spawners.Num() + (SpawnerIndex < EnemyCount % Spawners.Num() ? 1 : 0);
+
+		NumSpawned += Spawners[SpawnerIndex]->SpawnBenchmarkEnemies(SpawnerCount, ScatterRadius, Random);
+	}
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Combat benchmark: spawned %d enemies across %d spawners"), NumSpawned, Spawners.Num());
+}
+
+void UCombatBenchmarkSubsystem::DriveScriptedPlayer(float DeltaTime)
+{
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	ACombatCharacter* Player = PlayerController ? Cast<ACombatCharacter>(PlayerController->GetPawn()) : nullptr;
+
+	if (!Player)
+	{
+		return;
+	}
+
+	ScriptTime += DeltaTime;
+
+	// feed every input we've passed, wrapping around at the end of the loop
+	while (true)
+	{
+		if (NextScriptInput >= UE_ARRAY_COUNT(BenchmarkScript))
+		{
+			if (ScriptTime < BenchmarkScriptLength)
+			{
+				break;
+			}
+
+			ScriptTime -= BenchmarkScriptLength;
+			NextScriptInput = 0;
+		}
+
+		const FCombatBenchmarkScriptInput& ScriptInput = BenchmarkScript[NextScriptInput];
+
+		if (ScriptInput.Time > ScriptTime)
+		{
+			break;
+		}
+
+		switch (ScriptInput.Input)
+		{
+		case ECombatBenchmarkInput::ComboAttack:
+			Player->DoComboAttackStart();
+			Player->DoComboAttackEnd();
+			break;
+
+		case ECombatBenchmarkInput::ChargedAttackStart:
+			Player->DoChargedAttackStart();
+			break;
+
+		case ECombatBenchmarkInput::ChargedAttackEnd:
+			Player->DoChargedAttackEnd();
+			break;
+		}
+
+		++NextScriptInput;
+	}
+}
+
+void UCombatBenchmarkSubsystem::RecordFrame(float FrameSeconds, float PhysicsMs, float AnimationMs)
+{
+	FCombatBenchmarkFrame& Frame = Frames.AddDefaulted_GetRef();
+	Frame.FrameMs = FrameSeconds * 1000.0f;
+	Frame.GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	Frame.RenderThreadMs = FPlatformTime::ToMilliseconds(GRenderThreadTime);
+	Frame.PhysicsMs = PhysicsMs;
+	Frame.AnimationMs = AnimationMs;
+	Frame.UsedPhysicalMB = FPlatformMemory::GetStats().UsedPhysical / (1024.0f * 1024.0f);
+}
+
+void UCombatBenchmarkSubsystem::SetSpawnersSuspended(bool bSuspend)
+{
+	for (TActorIterator<ACombatEnemySpawner> It(GetWorld()); It; ++It)
+	{
+		It->SetSuspended(bSuspend);
+	}
+}
+
+void UCombatBenchmarkSubsystem::SetPhysicsTiming(bool bEnable)
+{
+	FPhysScene_Chaos* PhysScene = GetWorld()->GetPhysicsScene();
+
+	if (!PhysScene)
+	{
+		return;
+	}
+
+	if (bEnable)
+	{
+		PhysicsSeconds = 0.0;
+		PhysicsPreTickHandle = PhysScene->OnPhysScenePreTick.AddUObject(this, &UCombatBenchmarkSubsystem::OnPhysicsPreTick);
+		PhysicsPostTickHandle = PhysScene->OnPhysScenePostTick.AddUObject(this, &UCombatBenchmarkSubsystem::OnPhysicsPostTick);
+	}
+	else
+	{
+		PhysScene->OnPhysScenePreTick.Remove(PhysicsPreTickHandle);
+		PhysScene->OnPhysScenePostTick.Remove(PhysicsPostTickHandle);
+	}
+}
+
+void UCombatBenchmarkSubsystem::OnPhysicsPreTick(FPhysScene_Chaos* PhysScene, float DeltaSeconds)
+{
+	PhysicsStartTime = FPlatformTime::Seconds();
+}
+
+void UCombatBenchmarkSubsystem::OnPhysicsPostTick(FChaosScene* PhysScene)
+{
+	if (PhysicsStartTime > 0.0)
+	{
+		PhysicsSeconds += FPlatformTime::Seconds() - PhysicsStartTime;
+		PhysicsStartTime = 0.0;
+	}
+}
+
+void UCombatBenchmarkSubsystem::SetFixedTimeStep(bool bEnable)
+{
+	const float FixedFrameRate = CVarBenchmarkFixedFrameRate.GetValueOnGameThread();
+
+	if (bEnable)
+	{
+		bSavedUseFixedTimeStep = FApp::UseFixedTimeStep();
+		SavedFixedDeltaTime = FApp::GetFixedDeltaTime();
+
+		if (FixedFrameRate > 0.0f)
+		{
+			FApp::SetUseFixedTimeStep(true);
+			FApp::SetFixedDeltaTime(1.0 / FixedFrameRate);
+		}
+	}
+	else
+	{
+		FApp::SetUseFixedTimeStep(bSavedUseFixedTimeStep);
+		FApp::SetFixedDeltaTime(SavedFixedDeltaTime);
+	}
+}
+
+void UCombatBenchmarkSubsystem::WriteResults() const
+{
+	if (Frames.Num() == 0)
+	{
+		UE_LOG(LogTriangleGameJam, Warning, TEXT("Combat benchmark: no frames recorded."));
+		return;
+	}
+
+	// write the frames
+	FString Csv = TEXT("Frame,FrameMs,GameThreadMs,RenderThreadMs,PhysicsMs,AnimationMs,UsedPhysicalMB\n");
+
+	for (int32 FrameIndex = 0; FrameIndex < Frames.Num(); ++FrameIndex)
+	{
+		const FCombatBenchmarkFrame& Frame = Frames[FrameIndex];
+		Csv += FString::Printf(TEXT("%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f\n"), FrameIndex, Frame.FrameMs, Frame.GameThreadMs, Frame.RenderThreadMs, Frame.PhysicsMs, Frame.AnimationMs, Frame.UsedPhysicalMB);
+	}
+
+	const FString FileName = FPaths::ProfilingDir() / TEXT("CombatBenchmark") / FString::Printf(TEXT("CombatBenchmark_%d_Seed%d_%s.csv"), EnemyCount, Seed, *FDateTime::Now().ToString());
+
+	if (!FFileHelper::SaveStringToFile(Csv, *FileName))
+	{
+		UE_LOG(LogTriangleGameJam, Error, TEXT("Combat benchmark: could not write %s"), *FileName);
+	}
+
+	// log a summary
+	TArray<float> GameThreadTimes;
+	float TotalFrameMs = 0.0f;
+	float TotalGameThreadMs = 0.0f;
+	float TotalPhysicsMs = 0.0f;
+	float TotalAnimationMs = 0.0f;
+	float PeakMemoryMB = 0.0f;
+
+	for (const FCombatBenchmarkFrame& Frame : Frames)
+	{
+		GameThreadTimes.Add(Frame.GameThreadMs);
+		TotalFrameMs += Frame.FrameMs;
+		TotalGameThreadMs += Frame.GameThreadMs;
+		TotalPhysicsMs += Frame.PhysicsMs;
+		TotalAnimationMs += Frame.AnimationMs;
+		PeakMemoryMB = FMath::Max(PeakMemoryMB, Frame.UsedPhysicalMB);
+	}
+
+	GameThreadTimes.Sort();
+
+	const float P95GameThreadMs = GameThreadTimes[FMath::Min(GameThreadTimes.Num() - 1, FMath::FloorToInt(GameThreadTimes.Num() * 0.95f))];
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Combat benchmark: %d enemies, %d frames, avg frame %.2f ms, avg game thread %.2f ms, p95 game thread %.2f ms, avg physics %.2f ms, avg animation %.2f ms, peak memory %.0f MB. Written to %s"),
+		EnemyCount, Frames.Num(), TotalFrameMs / Frames.Num(), TotalGameThreadMs / Frames.Num(), P95GameThreadMs, TotalPhysicsMs / Frames.Num(), TotalAnimationMs / Frames.Num(), PeakMemoryMB, *FileName);
+}
+
+void UCombatBenchmarkSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// check for a benchmark requested on the command line
+	int32 InEnemyCount = 0;
+
+	if (!FParse::Value(FCommandLine::Get(), TEXT("CombatBenchmark="), InEnemyCount))
+	{
+		return;
+	}
+
+	// every world goes through here, e.g. the main menu, so wait for the benchmark map
+	FString BenchmarkMap = CVarBenchmarkMap.GetValueOnGameThread();
+	FParse::Value(FCommandLine::Get(), TEXT("CombatBenchmarkMap="), BenchmarkMap);
+
+	if (UGameplayStatics::GetCurrentLevelName(&InWorld, true) != BenchmarkMap)
+	{
+		return;
+	}
+
+	float InDuration = 30.0f;
+	int32 InSeed = 1;
+
+	FParse::Value(FCommandLine::Get(), TEXT("CombatBenchmarkDuration="), InDuration);
+	FParse::Value(FCommandLine::Get(), TEXT("CombatBenchmarkSeed="), InSeed);
+
+	bExitWhenDone = true;
+
+	StartBenchmark(InEnemyCount, InDuration, InSeed);
+}
+
+bool UCombatBenchmarkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatBenchmarkSubsystem::Deinitialize()
+{
+	if (bRunning)
+	{
+		bRunning = false;
+		SetFixedTimeStep(false);
+		SetPhysicsTiming(false);
+	}
+
+	Super::Deinitialize();
+}
+
+void UCombatBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bRunning)
+	{
+		return;
+	}
+
+	// the timestep is fixed, so measure how long the frame really took
+	const double Now = FPlatformTime::Seconds();
+	const float FrameSeconds = static_cast<float>(Now - LastFrameTime);
+	LastFrameTime = Now;
+
+	ElapsedTime += DeltaTime;
+
+	// collect this frame's physics and animation time, even during the warmup, so nothing carries over into the first recorded frame
+	const float PhysicsMs = static_cast<float>(PhysicsSeconds * 1000.0);
+	const float AnimationMs = static_cast<float>(FCombatAnimInstanceProxy::ConsumeEvaluationSeconds() * 1000.0);
+	PhysicsSeconds = 0.0;
+
+	DriveScriptedPlayer(DeltaTime);
+
+	// skip the warmup
+	const float WarmupTime = CVarBenchmarkWarmupTime.GetValueOnGameThread();
+
+	if (ElapsedTime < WarmupTime)
+	{
+		return;
+	}
+
+#if CSV_PROFILER
+	// also capture the engine's own per-frame categories, for a breakdown of anything our columns flag
+	if (Frames.Num() == 0 && !FCsvProfiler::Get()->IsCapturing())
+	{
+		FCsvProfiler::Get()->BeginCapture(-1, FPaths::ProfilingDir() / TEXT("CombatBenchmark"), FString::Printf(TEXT("CombatBenchmark_%d_Seed%d_Profile.csv"), EnemyCount, Seed));
+	}
+#endif
+
+	RecordFrame(FrameSeconds, PhysicsMs, AnimationMs);
+
+	if (ElapsedTime >= WarmupTime + Duration)
+	{
+		StopBenchmark();
+	}
+}
+
+TStatId UCombatBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatBenchmarkSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,157 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Math/RandomStream.h"
+#include "CombatBenchmarkSubsystem.generated.h"
+
+class FPhysScene_Chaos;
+class FChaosScene;
+
+/**
+ *  Timings and memory sampled for one benchmark frame
+ */
+struct FCombatBenchmarkFrame
+{
+	float FrameMs = 0.0f;
+	float GameThreadMs = 0.0f;
+	float RenderThreadMs = 0.0f;
+
+	/** Game thread time from the start to the end of the physics step, including waiting on the solver */
+	float PhysicsMs = 0.0f;
+
+	/** Time spent evaluating combat anim graphs, summed over all threads */
+	float AnimationMs = 0.0f;
+
+	float UsedPhysicalMB = 0.0f;
+};
+
+/**
+ *  Combat stress benchmark.
+ *  Spawns a fixed number of enemies through the level's spawners, drives the player through a scripted loop
+ *  of combo and charged attacks, and records per-frame timings, including physics and animation, and memory to CSV.
+ *  The level's spawners are suspended during the run, so only the benchmark's own enemies are simulated.
+ *  All random choices come from seeded streams and the game runs at a fixed timestep, so runs with the same seed
+ *  simulate the same frames and are comparable. Frame times are measured on the wall clock.
+ *  Runs from the Combat.Benchmark.Start console command, or from the command line with -CombatBenchmark=<EnemyCount>
+ *  once the benchmark map loads, in which case the game exits when the run completes, e.g. for -nullrhi automation.
+ */
+UCLASS()
+class UCombatBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** If true, a benchmark is running */
+	bool bRunning = false;
+
+	/** If true, the game exits once the benchmark completes */
+	bool bExitWhenDone = false;
+
+	/** Number of enemies spawned for this run */
+	int32 EnemyCount = 0;
+
+	/** Seed for this run */
+	int32 Seed = 0;
+
+	/** Time to record for, after the warmup */
+	float Duration = 0.0f;
+
+	/** Time since the benchmark started */
+	float ElapsedTime = 0.0f;
+
+	/** Wall clock time of the last benchmark tick */
+	double LastFrameTime = 0.0;
+
+	/** Engine timestep settings to restore when the benchmark stops */
+	bool bSavedUseFixedTimeStep = false;
+	double SavedFixedDeltaTime = 0.0;
+
+	/** Position in the scripted attack loop */
+	float ScriptTime = 0.0f;
+
+	/** Index of the next scripted input in the loop */
+	int32 NextScriptInput = 0;
+
+	/** Random stream for everything the benchmark decides */
+	FRandomStream Random;
+
+	/** Wall clock time the current physics step started */
+	double PhysicsStartTime = 0.0;
+
+	/** Physics time accumulated since the last benchmark tick */
+	double PhysicsSeconds = 0.0;
+
+	/** Physics scene delegate handles */
+	FDelegateHandle PhysicsPreTickHandle;
+	FDelegateHandle PhysicsPostTickHandle;
+
+	/** Recorded frames */
+	TArray<FCombatBenchmarkFrame> Frames;
+
+public:
+
+	/** Spawns the enemies and starts recording */
+	void StartBenchmark(int32 InEnemyCount, float InDuration, int32 InSeed);
+
+	/** Stops recording and writes the results */
+	void StopBenchmark();
+
+	/** Returns true while a benchmark is running */
+	bool IsRunning() const { return bRunning; }
+
+	/** Starts a benchmark. Bound to the Combat.Benchmark.Start console command */
+	static void StartCommand(const TArray<FString>& Args, UWorld* World);
+
+	/** Stops the benchmark. Bound to the Combat.Benchmark.Stop console command */
+	static void StopCommand(const TArray<FString>& Args, UWorld* World);
+
+protected:
+
+	/** Spreads the enemies across the level's spawners */
+	void SpawnEnemies();
+
+	/** Feeds the scripted attack inputs to the player character */
+	void DriveScriptedPlayer(float DeltaTime);
+
+	/** Samples this frame's timings and memory */
+	void RecordFrame(float FrameSeconds, float PhysicsMs, float AnimationMs);
+
+	/** Suspends or resumes the level's enemy spawners */
+	void SetSpawnersSuspended(bool bSuspend);
+
+	/** Starts or stops timing the world's physics step */
+	void SetPhysicsTiming(bool bEnable);
+
+	/** Marks the start of the physics step */
+	void OnPhysicsPreTick(FPhysScene_Chaos* PhysScene, float DeltaSeconds);
+
+	/** Adds the physics step to this frame's physics time */
+	void OnPhysicsPostTick(FChaosScene* PhysScene);
+
+	/** Forces the engine to a fixed timestep for the run, or restores the previous timestep settings */
+	void SetFixedTimeStep(bool bEnable);
+
+	/** Writes the recorded frames to CSV and logs a summary */
+	void WriteResults() const;
+
+	/** Starts the benchmark if it was requested on the command line and this is the benchmark map */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Restores the engine timestep if the world goes away mid-run */
+	virtual void Deinitialize() override;
+
+public:
+
+	/** Runs the benchmark */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
@@ -0,0 +1,171 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatDamageSubsystem.h"
+#include "CombatDamageable.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<bool> CVarDamageCoalesce(
+	TEXT("Combat.Damage.Coalesce"),
+	true,
+	TEXT("If true, damage is deferred to the end of the frame and applied once per victim. If false, it's applied as soon as it's queued."),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorldAndArgs DamageStatsCommand(
+	TEXT("Combat.Damage.Stats"),
+	TEXT("Logs the number of hits queued and damage events applied since the last call."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UCombatDamageSubsystem::DumpStats)
+);
+
+void FCombatDamageBatch::Reset()
+{
+	Victims.Reset();
+	Causers.Reset();
+	Damage.Reset();
+	StrongestHitDamage.Reset();
+	Locations.Reset();
+	Impulses.Reset();
+	HitCounts.Reset();
+	VictimIndices.Reset();
+}
+
+void UCombatDamageSubsystem::QueueDamage(AActor* Victim, float Damage, AActor* DamageCauser, const FVector& DamageLocation, const FVector& DamageImpulse)
+{
+	// damage is only applied on the server, and the results replicate to clients
+	if (!IsValid(Victim) || GetWorld()->IsNetMode(NM_Client))
+	{
+		return;
+	}
+
+	++NumHitsQueued;
+
+	// apply right away if coalescing is disabled
+	if (!IsCoalescingEnabled())
+	{
+		if (ICombatDamageable* Damageable = Cast<ICombatDamageable>(Victim))
+		{
+			++NumDamageEventsApplied;
+			Damageable->ApplyDamage(Damage, DamageCauser, DamageLocation, DamageImpulse);
+		}
+
+		return;
+	}
+
+	FCombatDamageBatch& Batch = PendingBatch;
+
+	if (const int32* ExistingIndex = Batch.VictimIndices.Find(Victim))
+	{
+		// accumulate into the victim's entry
+		const int32 Index = *ExistingIndex;
+
+		Batch.Damage[Index] += Damage;
+		Batch.Impulses[Index] += DamageImpulse;
+		++Batch.HitCounts[Index];
+
+		// effects play at the strongest hit
+		if (Damage > Batch.StrongestHitDamage[Index])
+		{
+			Batch.StrongestHitDamage[Index] = Damage;
+			Batch.Locations[Index] = DamageLocation;
+			Batch.Causers[Index] = DamageCauser;
+		}
+
+		return;
+	}
+
+	// first hit on this victim this frame
+	Batch.VictimIndices.Add(Victim, Batch.Victims.Num());
+	Batch.Victims.Add(Victim);
+	Batch.Causers.Add(DamageCauser);
+	Batch.Damage.Add(Damage);
+	Batch.StrongestHitDamage.Add(Damage);
+	Batch.Locations.Add(DamageLocation);
+	Batch.Impulses.Add(DamageImpulse);
+	Batch.HitCounts.Add(1);
+}
+
+void UCombatDamageSubsystem::Flush()
+{
+	if (PendingBatch.Num() == 0)
+	{
+		return;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatDamageSubsystem::Flush);
+
+	// damage events may queue more damage, e.g. through death effects. That goes into the next batch
+	Swap(PendingBatch, ApplyingBatch);
+
+	for (int32 Index = 0; Index < ApplyingBatch.Num(); ++Index)
+	{
+		AActor* Victim = ApplyingBatch.Victims[Index].Get();
+
+		// the victim may have been destroyed by an earlier entry
+		if (!IsValid(Victim))
+		{
+			continue;
+		}
+
+		if (ICombatDamageable* Damageable = Cast<ICombatDamageable>(Victim))
+		{
+			++NumDamageEventsApplied;
+			Damageable->ApplyDamage(ApplyingBatch.Damage[Index], ApplyingBatch.Causers[Index].Get(), ApplyingBatch.Locations[Index], ApplyingBatch.Impulses[Index]);
+		}
+	}
+
+	ApplyingBatch.Reset();
+}
+
+void UCombatDamageSubsystem::DumpStats(const TArray<FString>& Args, UWorld* World)
+{
+	UCombatDamageSubsystem* DamageSubsystem = World ? World->GetSubsystem<UCombatDamageSubsystem>() : nullptr;
+
+	if (!DamageSubsystem)
+	{
+		return;
+	}
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Damage: %d hits queued, %d damage events applied"), DamageSubsystem->NumHitsQueued, DamageSubsystem->NumDamageEventsApplied);
+
+	DamageSubsystem->NumHitsQueued = 0;
+	DamageSubsystem->NumDamageEventsApplied = 0;
+}
+
+bool UCombatDamageSubsystem::IsCoalescingEnabled()
+{
+	return CVarDamageCoalesce.GetValueOnGameThread();
+}
+
+bool UCombatDamageSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatDamageSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UCombatDamageSubsystem::HandlePostActorTick);
+}
+
+void UCombatDamageSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	PendingBatch.Reset();
+	ApplyingBatch.Reset();
+
+	Super::Deinitialize();
+}
+
+void UCombatDamageSubsystem::HandlePostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	// the delegate is global, so ignore other worlds
+	if (InWorld == GetWorld())
+	{
+		Flush();
+	}
+}
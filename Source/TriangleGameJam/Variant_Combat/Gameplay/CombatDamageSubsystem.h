@@ -0,0 +1,100 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineBaseTypes.h"
+#include "CombatDamageSubsystem.generated.h"
+
+/**
+ *  Damage gathered during a frame, coalesced per victim in packed arrays
+ */
+struct FCombatDamageBatch
+{
+	/** Damaged actors */
+	TArray<TWeakObjectPtr<AActor>> Victims;
+
+	/** Causer of the strongest hit on each victim */
+	TArray<TWeakObjectPtr<AActor>> Causers;
+
+	/** Total damage per victim */
+	TArray<float> Damage;
+
+	/** Damage of the strongest hit on each victim */
+	TArray<float> StrongestHitDamage;
+
+	/** Location of the strongest hit on each victim */
+	TArray<FVector> Locations;
+
+	/** Total knockback impulse per victim */
+	TArray<FVector> Impulses;
+
+	/** Number of hits coalesced into each victim's entry */
+	TArray<int32> HitCounts;
+
+	/** Maps victims to their index in the arrays */
+	TMap<AActor*, int32> VictimIndices;
+
+	/** Returns the number of victims in the batch */
+	int32 Num() const { return Victims.Num(); }
+
+	/** Empties the batch, keeping its memory */
+	void Reset();
+};
+
+/**
+ *  Defers ICombatDamageable damage to the end of the frame and coalesces it per victim,
+ *  so each victim takes damage, knockback, ragdoll blend changes and Blueprint damage events at most once per frame
+ *  no matter how many hits land on it.
+ */
+UCLASS()
+class UCombatDamageSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Damage queued this frame */
+	FCombatDamageBatch PendingBatch;
+
+	/** Batch being applied. Damage queued while applying goes to the pending batch */
+	FCombatDamageBatch ApplyingBatch;
+
+	/** Handle for the end of frame flush */
+	FDelegateHandle PostActorTickHandle;
+
+	/** Hits queued since the last stats dump */
+	int32 NumHitsQueued = 0;
+
+	/** Damage events applied since the last stats dump */
+	int32 NumDamageEventsApplied = 0;
+
+public:
+
+	/** Queues damage for a victim. Applied once per victim at the end of the frame. Ignored on clients */
+	void QueueDamage(AActor* Victim, float Damage, AActor* DamageCauser, const FVector& DamageLocation, const FVector& DamageImpulse);
+
+	/** Applies all queued damage immediately */
+	void Flush();
+
+	/** Logs the number of hits queued and damage events applied since the last call */
+	static void DumpStats(const TArray<FString>& Args, UWorld* World);
+
+	/** Returns true if damage is deferred and coalesced */
+	static bool IsCoalescingEnabled();
+
+protected:
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Hooks the end of frame flush */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Unhooks the end of frame flush */
+	virtual void Deinitialize() override;
+
+	/** Applies the queued damage once all actors and tickables have ticked */
+	void HandlePostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+};
@@ -2,9 +2,10 @@
 
 
 #include "CombatDamageableBox.h"
+#include "CombatPropSubsystem.h"
 #include "Components/StaticMeshComponent.h"
-#include "TimerManager.h"
 #include "Engine/World.h"
+#include "EffectDispatcherSubsystem.h"
 
 ACombatDamageableBox::ACombatDamageableBox()
 {
@@ -23,18 +24,59 @@ ACombatDamageableBox::ACombatDamageableBox()
 	Mesh->bNavigationRelevant = false;
 }
 
-void ACombatDamageableBox::RemoveFromLevel()
+void ACombatDamageableBox::DeactivateProp()
 {
-	// destroy this actor
-	Destroy();
+	// stop simulating and hide
+	Mesh->SetSimulatePhysics(false);
+	Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+void ACombatDamageableBox::ResetProp()
+{
+	CurrentHP = StartingHP;
+
+	// move back home before re-enabling physics so we don't sweep through anything
+	Mesh->SetSimulatePhysics(false);
+	SetActorTransform(HomeTransform, false, nullptr, ETeleportType::ResetPhysics);
+
+	Mesh->SetCollisionObjectType(StartingObjectType);
+	Mesh->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	Mesh->SetSimulatePhysics(true);
+	Mesh->SetPhysicsLinearVelocity(FVector::ZeroVector);
+	Mesh->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+}
+
+void ACombatDamageableBox::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// save the starting state so we can be reset in place
+	StartingHP = CurrentHP;
+	HomeTransform = GetActorTransform();
+	StartingObjectType = Mesh->GetCollisionObjectType();
+
+	if (UCombatPropSubsystem* Props = GetWorld()->GetSubsystem<UCombatPropSubsystem>())
+	{
+		Props->RegisterBox(this);
+	}
 }
 
 void ACombatDamageableBox::EndPlay(EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
-	// clear the death timer
-	GetWorld()->GetTimerManager().ClearTimer(DeathTimer);
+	// stop being managed
+	if (UCombatPropSubsystem* Props = GetWorld()->GetSubsystem<UCombatPropSubsystem>())
+	{
+		Props->UnregisterBox(this);
+	}
 }
 
 void ACombatDamageableBox::ApplyDamage(float Damage, AActor* DamageCauser, const FVector& DamageLocation, const FVector& DamageImpulse)
@@ -50,10 +92,24 @@ void ACombatDamageableBox::ApplyDamage(float Damage, AActor* DamageCauser, const
 		{
 			HandleDeath();
 		}
+		else
+		{
+			// watch the box so it's put to sleep once it settles
+			if (UCombatPropSubsystem* Props = GetWorld()->GetSubsystem<UCombatPropSubsystem>())
+			{
+				Props->WakeBox(this);
+			}
+		}
 
 		// apply a physics impulse to the box, ignoring its mass
 		Mesh->AddImpulseAtLocation(DamageImpulse * Mesh->GetMass(), DamageLocation);
 
+		// play the pooled impact effects
+		if (UEffectDispatcherSubsystem* EffectDispatcher = GetWorld()->GetSubsystem<UEffectDispatcherSubsystem>())
+		{
+			EffectDispatcher->PlayEffectAtLocation(HitEffect, HitSound, DamageLocation, DamageImpulse.Rotation());
+		}
+
 		// call the BP handler to play effects, etc.
 		OnBoxDamaged(DamageLocation, DamageImpulse);
 	}
@@ -67,12 +123,14 @@ void ACombatDamageableBox::HandleDeath()
 	// call the BP handler to play effects, etc.
 	OnBoxDestroyed();
 
-	// set up the death cleanup timer
-	GetWorld()->GetTimerManager().SetTimer(DeathTimer, this, &ACombatDamageableBox::RemoveFromLevel, DeathDelayTime);
+	// hand the box over as debris. It's deactivated after the delay, or earlier if the debris budget is exceeded
+	if (UCombatPropSubsystem* Props = GetWorld()->GetSubsystem<UCombatPropSubsystem>())
+	{
+		Props->BreakBox(this, DeathDelayTime);
+	}
 }
 
 void ACombatDamageableBox::ApplyHealing(float Healing, AActor* Healer)
 {
 	// stub
 }
-
@@ -7,8 +7,12 @@
 #include "CombatDamageable.h"
 #include "CombatDamageableBox.generated.h"
 
+class UNiagaraSystem;
+class USoundBase;
+
 /**
- *  A simple physics box that reacts to damage through the ICombatDamageable interface
+ *  A simple physics box that reacts to damage through the ICombatDamageable interface.
+ *  Boxes are managed by UCombatPropSubsystem, which sleeps, deactivates and resets them.
  */
 UCLASS(abstract)
 class ACombatDamageableBox : public AActor, public ICombatDamageable
@@ -34,8 +38,22 @@ protected:
 	UPROPERTY(EditAnywhere, Category="Damage", meta = (ClampMin = 0, ClampMax = 10, Units = "s"))
 	float DeathDelayTime = 6.0f;
 
-	/** Timer to defer destruction of this box after its HP are depleted */
-	FTimerHandle DeathTimer;
+	/** Impact effect played through the pooled effect dispatcher when damaged. Leave empty if the Blueprint damage event plays its own */
+	UPROPERTY(EditAnywhere, Category="Damage|Effects")
+	UNiagaraSystem* HitEffect;
+
+	/** Impact sound played through the pooled effect dispatcher when damaged. Leave empty if the Blueprint damage event plays its own */
+	UPROPERTY(EditAnywhere, Category="Damage|Effects")
+	USoundBase* HitSound;
+
+	/** HP the box is reset to */
+	float StartingHP = 0.0f;
+
+	/** Transform the box is reset to */
+	FTransform HomeTransform;
+
+	/** Collision object type the box is reset to */
+	TEnumAsByte<ECollisionChannel> StartingObjectType = ECC_WorldDynamic;
 
 	/** Blueprint damage handler for effect playback */
 	UFUNCTION(BlueprintImplementableEvent, Category="Damage")
@@ -45,11 +63,20 @@ protected:
 	UFUNCTION(BlueprintImplementableEvent, Category="Damage")
 	void OnBoxDestroyed();
 
-	/** Timer callback to remove the box from the level after it dies */
-	void RemoveFromLevel();
-
 public:
 
+	/** Returns the box mesh */
+	UStaticMeshComponent* GetMesh() const { return Mesh; }
+
+	/** Hides the box and disables its collision and physics until it's reset */
+	void DeactivateProp();
+
+	/** Restores the box's HP, collision and physics at its home transform */
+	void ResetProp();
+
+	/** Initialization */
+	virtual void BeginPlay() override;
+
 	/** EndPlay cleanup */
 	void EndPlay(EEndPlayReason::Type EndPlayReason) override;
 
@@ -3,7 +3,12 @@
 
 #include "CombatLavaFloor.h"
 #include "CombatDamageable.h"
+#include "CombatDamageSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/StaticMesh.h"
 #include "Components/StaticMeshComponent.h"
+#include "Components/BoxComponent.h"
+#include "TimerManager.h"
 
 ACombatLavaFloor::ACombatLavaFloor()
 {
@@ -12,16 +17,126 @@ ACombatLavaFloor::ACombatLavaFloor()
 	// create the mesh
 	RootComponent = Mesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Mesh"));
 
-	// bind the hit handler
-	Mesh->OnComponentHit.AddDynamic(this, &ACombatLavaFloor::OnFloorHit);
+	// create the damage zone
+	DamageZone = CreateDefaultSubobject<UBoxComponent>(TEXT("DamageZone"));
+	DamageZone->SetupAttachment(Mesh);
+	DamageZone->SetCollisionProfileName(FName("OverlapAllDynamic"));
+
+	// bind the overlap handlers
+	DamageZone->OnComponentBeginOverlap.AddDynamic(this, &ACombatLavaFloor::OnZoneBeginOverlap);
+	DamageZone->OnComponentEndOverlap.AddDynamic(this, &ACombatLavaFloor::OnZoneEndOverlap);
+}
+
+void ACombatLavaFloor::OnConstruction(const FTransform& Transform)
+{
+	Super::OnConstruction(Transform);
+
+	if (!bFitDamageZoneToMesh || !Mesh->GetStaticMesh())
+	{
+		return;
+	}
+
+	// cover the top of the mesh. The zone inherits the mesh scale, so convert the height to local space
+	const FBox LocalBounds = Mesh->GetStaticMesh()->GetBoundingBox();
+	const float ScaleZ = FMath::Max(KINDA_SMALL_NUMBER, FMath::Abs(Mesh->GetComponentScale().Z));
+	const float LocalHalfHeight = DamageZoneHeight * 0.5f / ScaleZ;
+
+	DamageZone->SetRelativeLocation(FVector(LocalBounds.GetCenter().X, LocalBounds.GetCenter().Y, LocalBounds.Max.Z + LocalHalfHeight));
+	DamageZone->SetBoxExtent(FVector(LocalBounds.GetExtent().X, LocalBounds.GetExtent().Y, LocalHalfHeight));
+}
+
+void ACombatLavaFloor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	// stop the damage pass
+	GetWorld()->GetTimerManager().ClearTimer(DamageTimer);
+}
+
+void ACombatLavaFloor::OnZoneBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	// only track damageable actors, once each
+	if (!IsValid(OtherActor) || !OtherActor->Implements<UCombatDamageable>() || Occupants.Contains(OtherActor))
+	{
+		return;
+	}
+
+	Occupants.Add(OtherActor);
+
+	// damage on contact if the actor's interval has elapsed
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+	const double* NextDamageTime = NextDamageTimes.Find(OtherActor);
+
+	if (!NextDamageTime || *NextDamageTime <= CurrentTime)
+	{
+		DamageOccupant(OtherActor, CurrentTime);
+	}
+
+	// start the damage pass
+	if (!DamageTimer.IsValid())
+	{
+		GetWorld()->GetTimerManager().SetTimer(DamageTimer, this, &ACombatLavaFloor::ApplyZoneDamage, DamageInterval, true);
+	}
+}
+
+void ACombatLavaFloor::OnZoneEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	// actors with several overlapping components stay in the zone until the last one leaves
+	if (DamageZone->IsOverlappingActor(OtherActor))
+	{
+		return;
+	}
+
+	Occupants.RemoveSingleSwap(OtherActor);
+}
+
+void ACombatLavaFloor::ApplyZoneDamage()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACombatLavaFloor::ApplyZoneDamage);
+
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+
+	for (int32 OccupantIndex = Occupants.Num() - 1; OccupantIndex >= 0; --OccupantIndex)
+	{
+		AActor* Occupant = Occupants[OccupantIndex].Get();
+
+		// drop actors that were destroyed or pooled without ending the overlap
+		if (!IsValid(Occupant) || Occupant->IsHidden())
+		{
+			Occupants.RemoveAtSwap(OccupantIndex, EAllowShrinking::No);
+			continue;
+		}
+
+		if (NextDamageTimes.FindRef(Occupant) <= CurrentTime)
+		{
+			DamageOccupant(Occupant, CurrentTime);
+		}
+	}
+
+	// forget expired cooldowns
+	for (auto It = NextDamageTimes.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || It.Value() <= CurrentTime)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// stop the pass until someone steps on the floor again
+	if (Occupants.Num() == 0)
+	{
+		GetWorld()->GetTimerManager().ClearTimer(DamageTimer);
+	}
 }
 
-void ACombatLavaFloor::OnFloorHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
+void ACombatLavaFloor::DamageOccupant(AActor* Occupant, double CurrentTime)
 {
-	// check if the hit actor is damageable by casting to the interface
-	if (ICombatDamageable* Damageable = Cast<ICombatDamageable>(OtherActor))
+	// queue the damage so it's applied with the rest of this frame's damage
+	if (UCombatDamageSubsystem* DamageSubsystem = GetWorld()->GetSubsystem<UCombatDamageSubsystem>())
 	{
-		// damage the actor
-		Damageable->ApplyDamage(Damage, this, Hit.ImpactPoint, FVector::ZeroVector);
+		DamageSubsystem->QueueDamage(Occupant, Damage, this, Occupant->GetActorLocation(), FVector::ZeroVector);
 	}
+
+	// allow a little slack so timer jitter doesn't skip a whole interval
+	NextDamageTimes.Add(Occupant, CurrentTime + DamageInterval * 0.9f);
 }
@@ -7,10 +7,12 @@
 #include "CombatLavaFloor.generated.h"
 
 class UStaticMeshComponent;
+class UBoxComponent;
 class UPrimitiveComponent;
 
 /**
- *  A basic actor that applies damage on contact through the ICombatDamageable interface. 
+ *  A damage-over-time floor that damages actors standing on it through the ICombatDamageable interface.
+ *  Occupants are tracked through an overlap zone over the mesh and damaged on a fixed interval in one batched pass.
  */
 UCLASS(abstract)
 class ACombatLavaFloor : public AActor
@@ -21,20 +23,61 @@ class ACombatLavaFloor : public AActor
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
 	UStaticMeshComponent* Mesh;
 
+	/** Overlap zone covering the top of the floor */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Components", meta = (AllowPrivateAccess = "true"))
+	UBoxComponent* DamageZone;
+
 protected:
 
-	/** Amount of damage to deal on contact */
+	/** Amount of damage to deal on each damage interval */
 	UPROPERTY(EditAnywhere, Category="Damage")
 	float Damage = 10000.0f;
 
+	/** Minimum time between damage applications to the same actor */
+	UPROPERTY(EditAnywhere, Category="Damage", meta = (ClampMin = 0.05, ClampMax = 10, Units = "s"))
+	float DamageInterval = 0.5f;
+
+	/** If true, the damage zone is sized to cover the top of the floor mesh */
+	UPROPERTY(EditAnywhere, Category="Damage")
+	bool bFitDamageZoneToMesh = true;
+
+	/** Height of the damage zone above the floor mesh when it's fitted to the mesh */
+	UPROPERTY(EditAnywhere, Category="Damage", meta = (ClampMin = 1, ClampMax = 500, Units = "cm", EditCondition = "bFitDamageZoneToMesh"))
+	float DamageZoneHeight = 20.0f;
+
+	/** Damageable actors currently inside the zone */
+	TArray<TWeakObjectPtr<AActor>> Occupants;
+
+	/** Earliest time each actor can be damaged again. Kept after they leave so hopping in and out doesn't bypass the interval */
+	TMap<TWeakObjectPtr<AActor>, double> NextDamageTimes;
+
+	/** Timer driving the batched damage pass while the zone is occupied */
+	FTimerHandle DamageTimer;
+
 public:	
 
 	/** Constructor */
 	ACombatLavaFloor();
 
+	/** Fits the damage zone to the mesh */
+	virtual void OnConstruction(const FTransform& Transform) override;
+
 protected:
 
-	/** Blocking hit handler */
+	/** Cleanup */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Starts tracking damageable actors entering the zone */
 	UFUNCTION()
-	void OnFloorHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+	void OnZoneBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+	/** Stops tracking actors leaving the zone */
+	UFUNCTION()
+	void OnZoneEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+
+	/** Damages every occupant whose interval has elapsed */
+	void ApplyZoneDamage();
+
+	/** Queues damage for one occupant and restarts its interval */
+	void DamageOccupant(AActor* Occupant, double CurrentTime);
 };
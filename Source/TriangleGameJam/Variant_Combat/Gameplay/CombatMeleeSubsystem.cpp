@@ -0,0 +1,190 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatMeleeSubsystem.h"
+#include "CombatAttacker.h"
+#include "CombatDamageable.h"
+#include "CombatDamageSubsystem.h"
+#include "Engine/World.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<bool> CVarMeleeParallelSweeps(
+	TEXT("Combat.Melee.ParallelSweeps"),
+	true,
+	TEXT("If true, the melee sweeps queued during a frame run across worker threads."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarMeleeSwingMemory(
+	TEXT("Combat.Melee.SwingMemory"),
+	2.0f,
+	TEXT("Seconds a swing remembers its victims after its last sweep."),
+	ECVF_Default
+);
+
+void UCombatMeleeSubsystem::QueueSweep(FCombatMeleeSweep&& Sweep)
+{
+	PendingSweeps.Add(MoveTemp(Sweep));
+}
+
+void UCombatMeleeSubsystem::Flush()
+{
+	if (PendingSweeps.Num() > 0)
+	{
+		RunSweeps();
+		DispatchHits();
+
+		// apply the damage now instead of relying on the order of the end of frame handlers
+		if (UCombatDamageSubsystem* DamageSubsystem = GetWorld()->GetSubsystem<UCombatDamageSubsystem>())
+		{
+			DamageSubsystem->Flush();
+		}
+	}
+
+	ExpireSwings();
+}
+
+void UCombatMeleeSubsystem::RunSweeps()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatMeleeSubsystem::RunSweeps);
+
+	UWorld* World = GetWorld();
+
+	// scene queries only read from the physics scene, so they can run concurrently.
+	// Each sweep only writes to its own hit array
+	const EParallelForFlags Flags = CVarMeleeParallelSweeps.GetValueOnGameThread() ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+
+	ParallelFor(TEXT("CombatMeleeSweeps"), PendingSweeps.Num(), 1,
+		[this, World](int32 SweepIndex)
+		{
+			FCombatMeleeSweep& Sweep = PendingSweeps[SweepIndex];
+
+			// ignore the attacker
+			FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(CombatMeleeSweep), false, Sweep.Attacker.Get());
+
+			World->SweepMultiByObjectType(Sweep.Hits, Sweep.Start, Sweep.End, FQuat::Identity, Sweep.ObjectParams, FCollisionShape::MakeSphere(Sweep.Radius), QueryParams);
+		},
+		Flags);
+}
+
+void UCombatMeleeSubsystem::DispatchHits()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatMeleeSubsystem::DispatchHits);
+
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+
+	// damage is coalesced per victim and applied at the end of the frame.
+	// Clients still resolve their sweeps so attackers get their hit effects right away, but only the server deals damage
+	UCombatDamageSubsystem* DamageSubsystem = GetWorld()->GetSubsystem<UCombatDamageSubsystem>();
+	check(DamageSubsystem);
+
+	const bool bAppliesDamage = !GetWorld()->IsNetMode(NM_Client);
+
+	for (FCombatMeleeSweep& Sweep : PendingSweeps)
+	{
+		AActor* Attacker = Sweep.Attacker.Get();
+
+		// the attacker may have been removed since queuing the sweep
+		if (!IsValid(Attacker))
+		{
+			continue;
+		}
+
+		FCombatMeleeSwingRecord& Swing = Swings.FindOrAdd(TPair<TWeakObjectPtr<AActor>, uint32>(Sweep.Attacker, Sweep.SwingId));
+		Swing.LastSweepTime = CurrentTime;
+
+		for (const FHitResult& CurrentHit : Sweep.Hits)
+		{
+			AActor* Victim = CurrentHit.GetActor();
+
+			if (!IsValid(Victim))
+			{
+				continue;
+			}
+
+			// only hit actors with the required tag
+			if (!Sweep.RequiredVictimTag.IsNone() && !Victim->ActorHasTag(Sweep.RequiredVictimTag))
+			{
+				continue;
+			}
+
+			// only hit each actor once per swing, no matter how many of its components we overlapped
+			if (Swing.Victims.Contains(Victim))
+			{
+				continue;
+			}
+
+			// check if the actor is damageable
+			if (!Victim->Implements<UCombatDamageable>())
+			{
+				continue;
+			}
+
+			Swing.Victims.Add(Victim);
+
+			// knock upwards and away from the impact normal
+			const FVector Impulse = (CurrentHit.ImpactNormal * -Sweep.KnockbackImpulse) + (FVector::UpVector * Sweep.LaunchImpulse);
+
+			// queue the damage event for the actor
+			if (bAppliesDamage)
+			{
+				DamageSubsystem->QueueDamage(Victim, Sweep.Damage, Attacker, CurrentHit.ImpactPoint, Impulse);
+			}
+
+			// let the attacker play its hit effects
+			if (ICombatAttacker* CombatAttacker = Cast<ICombatAttacker>(Attacker))
+			{
+				CombatAttacker->NotifyMeleeHit(Victim, Sweep.Damage, CurrentHit.ImpactPoint);
+			}
+		}
+	}
+
+	PendingSweeps.Reset();
+}
+
+void UCombatMeleeSubsystem::ExpireSwings()
+{
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+	const double SwingMemory = CVarMeleeSwingMemory.GetValueOnGameThread();
+
+	// forget swings that have ended
+	for (auto It = Swings.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().Key.IsValid() || CurrentTime - It.Value().LastSweepTime > SwingMemory)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+bool UCombatMeleeSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatMeleeSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UCombatMeleeSubsystem::HandlePostActorTick);
+}
+
+void UCombatMeleeSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	PendingSweeps.Reset();
+	Swings.Reset();
+
+	Super::Deinitialize();
+}
+
+void UCombatMeleeSubsystem::HandlePostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	// the delegate is global, so ignore other worlds
+	if (InWorld == GetWorld())
+	{
+		Flush();
+	}
+}
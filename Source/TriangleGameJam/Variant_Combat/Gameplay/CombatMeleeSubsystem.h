@@ -0,0 +1,113 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CollisionQueryParams.h"
+#include "Engine/HitResult.h"
+#include "CombatMeleeSubsystem.generated.h"
+
+/**
+ *  A melee attack sweep queued for batched resolution
+ */
+struct FCombatMeleeSweep
+{
+	/** Actor performing the attack */
+	TWeakObjectPtr<AActor> Attacker;
+
+	/** Identifies the swing this sweep belongs to. Each victim is only hit once per swing */
+	uint32 SwingId = 0;
+
+	/** Sweep start and end */
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+
+	/** Sweep sphere radius */
+	float Radius = 0.0f;
+
+	/** Object types the sweep can hit */
+	FCollisionObjectQueryParams ObjectParams;
+
+	/** If set, only actors with this tag will be damaged */
+	FName RequiredVictimTag;
+
+	/** Damage dealt to each victim */
+	float Damage = 0.0f;
+
+	/** Knockback impulse away from the impact normal */
+	float KnockbackImpulse = 0.0f;
+
+	/** Upwards launch impulse */
+	float LaunchImpulse = 0.0f;
+
+	/** Sweep results, filled in by the batch */
+	TArray<FHitResult> Hits;
+};
+
+/**
+ *  Victims already hit by a swing
+ */
+struct FCombatMeleeSwingRecord
+{
+	/** Actors damaged by this swing */
+	TArray<TWeakObjectPtr<AActor>, TInlineAllocator<4>> Victims;
+
+	/** Last time a sweep for this swing was resolved, used to expire the record */
+	double LastSweepTime = 0.0;
+};
+
+/**
+ *  Collects all melee attack sweeps issued during a frame and resolves them as a single batch.
+ *  Sweeps run in parallel, then victims are deduplicated per attacker swing before damage is dispatched,
+ *  so an actor hit on several components, or by several notifies of the same swing, only takes damage once.
+ *  The batch is resolved once every actor and anim notify of the frame has run, and its damage applied right away,
+ *  so hits land in the same frame as the notify that queued them.
+ */
+UCLASS()
+class UCombatMeleeSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Sweeps queued this frame */
+	TArray<FCombatMeleeSweep> PendingSweeps;
+
+	/** Recent swings, keyed by attacker and swing ID */
+	TMap<TPair<TWeakObjectPtr<AActor>, uint32>, FCombatMeleeSwingRecord> Swings;
+
+	/** Handle for the end of frame flush */
+	FDelegateHandle PostActorTickHandle;
+
+public:
+
+	/** Queues a melee sweep to be resolved at the end of the frame */
+	void QueueSweep(FCombatMeleeSweep&& Sweep);
+
+	/** Resolves all queued sweeps and applies their damage immediately */
+	void Flush();
+
+protected:
+
+	/** Runs all queued sweeps */
+	void RunSweeps();
+
+	/** Deduplicates victims and applies damage */
+	void DispatchHits();
+
+	/** Forgets the victims of swings that have ended */
+	void ExpireSwings();
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Hooks the end of frame flush */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/** Unhooks the end of frame flush */
+	virtual void Deinitialize() override;
+
+	/** Resolves the sweeps queued this frame once all actors and anim notifies have run */
+	void HandlePostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+};
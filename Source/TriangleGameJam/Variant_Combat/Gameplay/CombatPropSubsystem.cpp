@@ -0,0 +1,232 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatPropSubsystem.h"
+#include "CombatDamageableBox.h"
+#include "Components/StaticMeshComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "TriangleGameJam.h"
+
+static TAutoConsoleVariable<int32> CVarPropsMaxDebris(
+	TEXT("Combat.Props.MaxDebris"),
+	12,
+	TEXT("Maximum number of broken boxes simulating as debris at the same time. The oldest are removed first."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarPropsSettleSpeed(
+	TEXT("Combat.Props.SettleSpeed"),
+	5.0f,
+	TEXT("Boxes moving slower than this, in cm/s, are considered at rest."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarPropsSettleTime(
+	TEXT("Combat.Props.SettleTime"),
+	0.5f,
+	TEXT("Seconds a box must stay at rest before its body is put to sleep."),
+	ECVF_Default
+);
+
+static FAutoConsoleCommandWithWorldAndArgs PropsStatsCommand(
+	TEXT("Combat.Props.Stats"),
+	TEXT("Logs the number of managed, awake, debris and inactive boxes."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UCombatPropSubsystem::DumpStats)
+);
+
+static FAutoConsoleCommandWithWorldAndArgs PropsResetCommand(
+	TEXT("Combat.Props.Reset"),
+	TEXT("Restores every breakable box to its starting transform and HP."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UCombatPropSubsystem::ResetPropsCommand)
+);
+
+void UCombatPropSubsystem::RegisterBox(ACombatDamageableBox* Box)
+{
+	Boxes.AddUnique(Box);
+}
+
+void UCombatPropSubsystem::UnregisterBox(ACombatDamageableBox* Box)
+{
+	Boxes.RemoveSwap(Box);
+	AwakeProps.RemoveAllSwap([Box](const FCombatSimulatingProp& Prop) { return Prop.Box == Box; });
+	Debris.RemoveAll([Box](const FCombatSimulatingProp& Prop) { return Prop.Box == Box; });
+}
+
+void UCombatPropSubsystem::WakeBox(ACombatDamageableBox* Box)
+{
+	// already watched?
+	FCombatSimulatingProp* Prop = AwakeProps.FindByPredicate([Box](const FCombatSimulatingProp& AwakeProp) { return AwakeProp.Box == Box; });
+
+	if (!Prop)
+	{
+		Prop = &AwakeProps.AddDefaulted_GetRef();
+		Prop->Box = Box;
+	}
+
+	Prop->SettledTime = 0.0f;
+	Prop->bAsleep = false;
+}
+
+void UCombatPropSubsystem::BreakBox(ACombatDamageableBox* Box, float RemoveDelay)
+{
+	// debris is watched on its own list
+	AwakeProps.RemoveAllSwap([Box](const FCombatSimulatingProp& Prop) { return Prop.Box == Box; });
+
+	// make room for the new debris
+	EnforceDebrisBudget(FMath::Max(0, CVarPropsMaxDebris.GetValueOnGameThread() - 1));
+
+	FCombatSimulatingProp& Prop = Debris.AddDefaulted_GetRef();
+	Prop.Box = Box;
+	Prop.RemoveTime = GetWorld()->GetTimeSeconds() + RemoveDelay;
+}
+
+void UCombatPropSubsystem::Release(ACombatDamageableBox* Box)
+{
+	if (!IsValid(Box))
+	{
+		return;
+	}
+
+	AwakeProps.RemoveAllSwap([Box](const FCombatSimulatingProp& Prop) { return Prop.Box == Box; });
+	Debris.RemoveAll([Box](const FCombatSimulatingProp& Prop) { return Prop.Box == Box; });
+
+	Box->DeactivateProp();
+}
+
+void UCombatPropSubsystem::ResetProps()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatPropSubsystem::ResetProps);
+
+	AwakeProps.Reset();
+	Debris.Reset();
+
+	// every box goes back into play where it started, and is put to sleep again once it settles
+	for (const TWeakObjectPtr<ACombatDamageableBox>& Box : Boxes)
+	{
+		if (Box.IsValid())
+		{
+			Box->ResetProp();
+			WakeBox(Box.Get());
+		}
+	}
+}
+
+void UCombatPropSubsystem::DumpStats(const TArray<FString>& Args, UWorld* World)
+{
+	const UCombatPropSubsystem* Props = World ? World->GetSubsystem<UCombatPropSubsystem>() : nullptr;
+
+	if (!Props)
+	{
+		return;
+	}
+
+	int32 NumInactive = 0;
+
+	for (const TWeakObjectPtr<ACombatDamageableBox>& Box : Props->Boxes)
+	{
+		NumInactive += Box.IsValid() && Box->IsHidden() ? 1 : 0;
+	}
+
+	UE_LOG(LogTriangleGameJam, Display, TEXT("Props: %d managed, %d awake, %d debris, %d inactive"), Props->Boxes.Num(), Props->AwakeProps.Num(), Props->Debris.Num(), NumInactive);
+}
+
+void UCombatPropSubsystem::ResetPropsCommand(const TArray<FString>& Args, UWorld* World)
+{
+	if (UCombatPropSubsystem* Props = World ? World->GetSubsystem<UCombatPropSubsystem>() : nullptr)
+	{
+		Props->ResetProps();
+	}
+}
+
+void UCombatPropSubsystem::EnforceDebrisBudget(int32 MaxDebris)
+{
+	// we keep the debris ordered by age, so the oldest go first
+	while (Debris.Num() > MaxDebris)
+	{
+		ACombatDamageableBox* Box = Debris[0].Box.Get();
+		Debris.RemoveAt(0, EAllowShrinking::No);
+
+		Release(Box);
+	}
+}
+
+bool UCombatPropSubsystem::UpdateSleep(FCombatSimulatingProp& Prop, float DeltaTime, float SettleSpeedSquared, float SettleTime) const
+{
+	if (Prop.bAsleep)
+	{
+		return true;
+	}
+
+	UStaticMeshComponent* Mesh = Prop.Box->GetMesh();
+
+	const bool bAtRest = !Mesh->RigidBodyIsAwake() || Mesh->GetPhysicsLinearVelocity().SizeSquared() < SettleSpeedSquared;
+
+	Prop.SettledTime = bAtRest ? Prop.SettledTime + DeltaTime : 0.0f;
+
+	if (Prop.SettledTime >= SettleTime)
+	{
+		Mesh->PutRigidBodyToSleep();
+		Prop.bAsleep = true;
+		return true;
+	}
+
+	return false;
+}
+
+bool UCombatPropSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatPropSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatPropSubsystem::Tick);
+
+	const float SettleSpeedSquared = FMath::Square(CVarPropsSettleSpeed.GetValueOnGameThread());
+	const float SettleTime = CVarPropsSettleTime.GetValueOnGameThread();
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+
+	// put intact boxes to sleep once they settle and stop watching them
+	for (int32 PropIndex = AwakeProps.Num() - 1; PropIndex >= 0; --PropIndex)
+	{
+		FCombatSimulatingProp& Prop = AwakeProps[PropIndex];
+
+		if (!Prop.Box.IsValid() || UpdateSleep(Prop, DeltaTime, SettleSpeedSquared, SettleTime))
+		{
+			AwakeProps.RemoveAtSwap(PropIndex, EAllowShrinking::No);
+		}
+	}
+
+	// put debris to sleep as well, and return it to the pool once its time is up. Keep the order for the budget
+	for (int32 PropIndex = 0; PropIndex < Debris.Num(); )
+	{
+		FCombatSimulatingProp& Prop = Debris[PropIndex];
+
+		if (!Prop.Box.IsValid())
+		{
+			Debris.RemoveAt(PropIndex, EAllowShrinking::No);
+			continue;
+		}
+
+		if (CurrentTime >= Prop.RemoveTime)
+		{
+			// release removes the entry
+			Release(Prop.Box.Get());
+			continue;
+		}
+
+		UpdateSleep(Prop, DeltaTime, SettleSpeedSquared, SettleTime);
+		++PropIndex;
+	}
+
+	// apply budget changes made from the console
+	EnforceDebrisBudget(FMath::Max(0, CVarPropsMaxDebris.GetValueOnGameThread()));
+}
+
+TStatId UCombatPropSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatPropSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,95 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatPropSubsystem.generated.h"
+
+class ACombatDamageableBox;
+
+/**
+ *  A box whose physics body is being watched
+ */
+struct FCombatSimulatingProp
+{
+	/** Box being watched */
+	TWeakObjectPtr<ACombatDamageableBox> Box;
+
+	/** Time the box has been moving slower than the settle speed */
+	float SettledTime = 0.0f;
+
+	/** Time the debris gets removed from the level. Zero for intact boxes */
+	double RemoveTime = 0.0;
+
+	/** If true, the body has been put to sleep */
+	bool bAsleep = false;
+};
+
+/**
+ *  Manages breakable combat props:
+ *  puts settled boxes to sleep, caps the number of broken boxes simulating as debris at the same time,
+ *  deactivates removed debris instead of destroying it, and resets every box in place when a player respawns.
+ */
+UCLASS()
+class UCombatPropSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Every box in play or deactivated */
+	TArray<TWeakObjectPtr<ACombatDamageableBox>> Boxes;
+
+	/** Intact boxes knocked around by damage */
+	TArray<FCombatSimulatingProp> AwakeProps;
+
+	/** Broken boxes, oldest first */
+	TArray<FCombatSimulatingProp> Debris;
+
+public:
+
+	/** Starts managing a box */
+	void RegisterBox(ACombatDamageableBox* Box);
+
+	/** Stops managing a box */
+	void UnregisterBox(ACombatDamageableBox* Box);
+
+	/** Watches a box that was knocked around so it can be put to sleep once it settles */
+	void WakeBox(ACombatDamageableBox* Box);
+
+	/** Turns a box into debris that will be removed after a delay, removing the oldest debris if we're over budget */
+	void BreakBox(ACombatDamageableBox* Box, float RemoveDelay);
+
+	/** Deactivates a box until the props are reset */
+	void Release(ACombatDamageableBox* Box);
+
+	/** Restores every box to its starting transform and HP. Called when a player respawns */
+	UFUNCTION(BlueprintCallable, Category="Props")
+	void ResetProps();
+
+	/** Logs the prop counts. Bound to the Combat.Props.Stats console command */
+	static void DumpStats(const TArray<FString>& Args, UWorld* World);
+
+	/** Resets the props. Bound to the Combat.Props.Reset console command */
+	static void ResetPropsCommand(const TArray<FString>& Args, UWorld* World);
+
+protected:
+
+	/** Removes the oldest debris until we're within the budget */
+	void EnforceDebrisBudget(int32 MaxDebris);
+
+	/** Puts settled bodies to sleep. Returns true if the prop should stop being watched */
+	bool UpdateSleep(FCombatSimulatingProp& Prop, float DeltaTime, float SettleSpeedSquared, float SettleTime) const;
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Updates sleeping and debris removal */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
@@ -0,0 +1,165 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatRagdollSubsystem.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "SkeletalMeshComponentBudgeted.h"
+#include "IAnimationBudgetAllocator.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarRagdollMaxSimulated(
+	TEXT("Combat.Ragdoll.MaxSimulated"),
+	8,
+	TEXT("Maximum number of death ragdolls simulating at the same time. The oldest are frozen first."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarRagdollSettleSpeed(
+	TEXT("Combat.Ragdoll.SettleSpeed"),
+	10.0f,
+	TEXT("Ragdolls moving slower than this, in cm/s, are considered at rest."),
+	ECVF_Default
+);
+
+static TAutoConsoleVariable<float> CVarRagdollSettleTime(
+	TEXT("Combat.Ragdoll.SettleTime"),
+	0.5f,
+	TEXT("Seconds a ragdoll must stay at rest before it's frozen."),
+	ECVF_Default
+);
+
+void UCombatRagdollSubsystem::StartRagdoll(USkeletalMeshComponent* Mesh)
+{
+	if (!IsValid(Mesh))
+	{
+		return;
+	}
+
+	// make room for the new ragdoll
+	EnforceBudget(FMath::Max(0, CVarRagdollMaxSimulated.GetValueOnGameThread() - 1));
+
+	FrozenRagdolls.RemoveSwap(Mesh);
+
+	// the animation budget owns the tick of the meshes registered with it, and would undo the freeze
+	USkeletalMeshComponentBudgeted* BudgetedMesh = Cast<USkeletalMeshComponentBudgeted>(Mesh);
+
+	if (BudgetedMesh && BudgetedMesh->GetAnimationBudgetHandle() != INDEX_NONE)
+	{
+		if (IAnimationBudgetAllocator* AnimationBudget = IAnimationBudgetAllocator::Get(GetWorld()))
+		{
+			AnimationBudget->UnregisterComponent(BudgetedMesh);
+			UnbudgetedRagdolls.AddUnique(Mesh);
+		}
+	}
+
+	// enable full ragdoll physics
+	Mesh->SetSimulatePhysics(true);
+
+	FCombatRagdoll& Ragdoll = SimulatedRagdolls.AddDefaulted_GetRef();
+	Ragdoll.Mesh = Mesh;
+}
+
+void UCombatRagdollSubsystem::StopRagdoll(USkeletalMeshComponent* Mesh)
+{
+	SimulatedRagdolls.RemoveAll([Mesh](const FCombatRagdoll& Ragdoll) { return Ragdoll.Mesh == Mesh; });
+
+	if (FrozenRagdolls.RemoveSwap(Mesh) > 0 && IsValid(Mesh))
+	{
+		// resume animation
+		Mesh->bPauseAnims = false;
+		Mesh->SetComponentTickEnabled(true);
+	}
+
+	// hand the mesh back to the animation budget
+	if (UnbudgetedRagdolls.RemoveSwap(Mesh) > 0 && IsValid(Mesh))
+	{
+		if (IAnimationBudgetAllocator* AnimationBudget = IAnimationBudgetAllocator::Get(GetWorld()))
+		{
+			AnimationBudget->RegisterComponent(CastChecked<USkeletalMeshComponentBudgeted>(Mesh));
+		}
+	}
+}
+
+void UCombatRagdollSubsystem::FreezeRagdoll(USkeletalMeshComponent* Mesh)
+{
+	// stop simulating. With the mesh no longer ticking, the bones keep the last simulated pose
+	Mesh->SetSimulatePhysics(false);
+	Mesh->bPauseAnims = true;
+	Mesh->SetComponentTickEnabled(false);
+
+	FrozenRagdolls.Add(Mesh);
+}
+
+void UCombatRagdollSubsystem::EnforceBudget(int32 MaxSimulated)
+{
+	// we keep the ragdolls ordered by age, so the oldest go first
+	const int32 NumToFreeze = SimulatedRagdolls.Num() - MaxSimulated;
+
+	for (int32 RagdollIndex = 0; RagdollIndex < NumToFreeze; ++RagdollIndex)
+	{
+		if (USkeletalMeshComponent* Mesh = SimulatedRagdolls[RagdollIndex].Mesh.Get())
+		{
+			FreezeRagdoll(Mesh);
+		}
+	}
+
+	if (NumToFreeze > 0)
+	{
+		SimulatedRagdolls.RemoveAt(0, NumToFreeze, EAllowShrinking::No);
+	}
+}
+
+bool UCombatRagdollSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatRagdollSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatRagdollSubsystem::Tick);
+
+	const float SettleSpeedSquared = FMath::Square(CVarRagdollSettleSpeed.GetValueOnGameThread());
+	const float SettleTime = CVarRagdollSettleTime.GetValueOnGameThread();
+
+	// freeze ragdolls that have come to rest. Keep the order so the budget still drops the oldest first
+	for (int32 RagdollIndex = 0; RagdollIndex < SimulatedRagdolls.Num(); )
+	{
+		FCombatRagdoll& Ragdoll = SimulatedRagdolls[RagdollIndex];
+		USkeletalMeshComponent* Mesh = Ragdoll.Mesh.Get();
+
+		// drop ragdolls that were destroyed or stopped simulating on their own
+		if (!IsValid(Mesh) || !Mesh->IsSimulatingPhysics())
+		{
+			SimulatedRagdolls.RemoveAt(RagdollIndex, EAllowShrinking::No);
+			continue;
+		}
+
+		const bool bAtRest = !Mesh->RigidBodyIsAwake() || Mesh->GetPhysicsLinearVelocity().SizeSquared() < SettleSpeedSquared;
+
+		Ragdoll.SettledTime = bAtRest ? Ragdoll.SettledTime + DeltaTime : 0.0f;
+
+		if (Ragdoll.SettledTime >= SettleTime)
+		{
+			FreezeRagdoll(Mesh);
+			SimulatedRagdolls.RemoveAt(RagdollIndex, EAllowShrinking::No);
+			continue;
+		}
+
+		++RagdollIndex;
+	}
+
+	// apply budget changes made from the console
+	EnforceBudget(FMath::Max(0, CVarRagdollMaxSimulated.GetValueOnGameThread()));
+
+	// forget frozen ragdolls that have been destroyed
+	FrozenRagdolls.RemoveAllSwap([](const TWeakObjectPtr<USkeletalMeshComponent>& Mesh) { return !Mesh.IsValid(); }, EAllowShrinking::No);
+	UnbudgetedRagdolls.RemoveAllSwap([](const TWeakObjectPtr<USkeletalMeshComponent>& Mesh) { return !Mesh.IsValid(); }, EAllowShrinking::No);
+}
+
+TStatId UCombatRagdollSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatRagdollSubsystem, STATGROUP_Tickables);
+}
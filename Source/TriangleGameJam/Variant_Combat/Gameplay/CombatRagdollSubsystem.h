@@ -0,0 +1,73 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatRagdollSubsystem.generated.h"
+
+class USkeletalMeshComponent;
+
+/**
+ *  A ragdoll currently simulating physics
+ */
+struct FCombatRagdoll
+{
+	/** Simulated mesh */
+	TWeakObjectPtr<USkeletalMeshComponent> Mesh;
+
+	/** Time the mesh has been moving slower than the settle speed */
+	float SettledTime = 0.0f;
+};
+
+/**
+ *  Caps the number of death ragdolls simulating at the same time.
+ *  Ragdolls that come to rest are frozen into a static pose with physics and animation disabled,
+ *  and when the budget is exceeded the oldest simulated ragdolls are frozen first.
+ */
+UCLASS()
+class UCombatRagdollSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Simulated ragdolls, oldest first */
+	TArray<FCombatRagdoll> SimulatedRagdolls;
+
+	/** Ragdolls frozen in place */
+	TArray<TWeakObjectPtr<USkeletalMeshComponent>> FrozenRagdolls;
+
+	/** Ragdolls taken out of the animation budget, so it doesn't turn their tick back on once frozen */
+	TArray<TWeakObjectPtr<USkeletalMeshComponent>> UnbudgetedRagdolls;
+
+public:
+
+	/** Starts simulating a death ragdoll, freezing the oldest ones if we're over budget. Budgeted meshes are taken out of the animation budget until the ragdoll stops */
+	void StartRagdoll(USkeletalMeshComponent* Mesh);
+
+	/** Stops tracking a ragdoll, restores animation if it was frozen and puts it back in the animation budget if it was in it. Physics simulation is left to the caller */
+	void StopRagdoll(USkeletalMeshComponent* Mesh);
+
+	/** Returns the number of ragdolls currently simulating */
+	int32 GetNumSimulatedRagdolls() const { return SimulatedRagdolls.Num(); }
+
+protected:
+
+	/** Stops simulating a ragdoll and keeps its current pose */
+	void FreezeRagdoll(USkeletalMeshComponent* Mesh);
+
+	/** Freezes the oldest simulated ragdolls until we're within the budget */
+	void EnforceBudget(int32 MaxSimulated);
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+public:
+
+	/** Freezes settled ragdolls */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
@@ -33,4 +33,10 @@ public:
 	/** Performs a charged attack's check to loop the charge animation. Usually called from a montage's AnimNotify */
 	UFUNCTION(BlueprintCallable, Category="Attacker")
 	virtual void CheckChargedAttack() = 0;
+
+	/** Notifies the attacker that one of its batched melee sweeps damaged a victim */
+	virtual void NotifyMeleeHit(AActor* Victim, float Damage, const FVector& ImpactPoint) {}
+
+	/** Returns true if the attacker fires its attack events from a precompiled attack timeline, so anim notifies should be ignored */
+	virtual bool UsesAttackTimeline() const { return false; }
 };
@@ -0,0 +1,212 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "CombatLifeBarSubsystem.h"
+#include "SCombatLifeBarOverlay.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/Canvas.h"
+#include "GameFramework/HUD.h"
+#include "SceneView.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+
+static TAutoConsoleVariable<float> CVarLifeBarsMaxDistance(
+	TEXT("Combat.LifeBars.MaxDistance"),
+	4000.0f,
+	TEXT("Life bars further than this from the camera are not drawn."),
+	ECVF_Default
+);
+
+int32 UCombatLifeBarSubsystem::RegisterLifeBar(const AActor* Owner, const FVector& Offset, const FLinearColor& Color)
+{
+	int32 Handle;
+
+	if (FreeHandles.Num() > 0)
+	{
+		Handle = FreeHandles.Pop(EAllowShrinking::No);
+	}
+	else
+	{
+		Handle = Owners.AddDefaulted();
+		Offsets.AddDefaulted();
+		Percents.AddDefaulted();
+		Colors.AddDefaulted();
+		Visible.AddDefaulted();
+	}
+
+	Owners[Handle] = Owner;
+	Offsets[Handle] = Offset;
+	Percents[Handle] = 1.0f;
+	Colors[Handle] = Color;
+	Visible[Handle] = true;
+
+	return Handle;
+}
+
+void UCombatLifeBarSubsystem::UnregisterLifeBar(int32 Handle)
+{
+	if (!Owners.IsValidIndex(Handle) || Owners[Handle].IsExplicitlyNull())
+	{
+		return;
+	}
+
+	Owners[Handle].Reset();
+	Visible[Handle] = false;
+	FreeHandles.Add(Handle);
+}
+
+void UCombatLifeBarSubsystem::SetLifePercentage(int32 Handle, float Percent)
+{
+	if (Percents.IsValidIndex(Handle))
+	{
+		Percents[Handle] = Percent;
+	}
+}
+
+void UCombatLifeBarSubsystem::SetBarColor(int32 Handle, const FLinearColor& Color)
+{
+	if (Colors.IsValidIndex(Handle))
+	{
+		Colors[Handle] = Color;
+	}
+}
+
+void UCombatLifeBarSubsystem::SetLifeBarVisible(int32 Handle, bool bVisible)
+{
+	if (Visible.IsValidIndex(Handle))
+	{
+		Visible[Handle] = bVisible;
+	}
+}
+
+void UCombatLifeBarSubsystem::CreateOverlay()
+{
+	UGameViewportClient* ViewportClient = GetWorld()->GetGameViewport();
+
+	if (!ViewportClient)
+	{
+		return;
+	}
+
+	Overlay = SNew(SCombatLifeBarOverlay);
+	ViewportClient->AddViewportWidgetContent(Overlay.ToSharedRef());
+}
+
+void UCombatLifeBarSubsystem::AddDrawItems(const FSceneView& View)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCombatLifeBarSubsystem::AddDrawItems);
+
+	TArray<FCombatLifeBarDrawItem>& DrawItems = Overlay->GetDrawItems();
+
+	// project into this player's part of the viewport
+	const FMatrix ViewProjectionMatrix = View.ViewMatrices.GetViewProjectionMatrix();
+	const FIntRect ViewRect = View.UnscaledViewRect;
+	const FVector ViewOrigin = View.ViewMatrices.GetViewOrigin();
+	const float MaxDistanceSquared = FMath::Square(CVarLifeBarsMaxDistance.GetValueOnGameThread());
+
+	// cull and project every bar in one pass
+	for (int32 Handle = 0; Handle < Owners.Num(); ++Handle)
+	{
+		if (!Visible[Handle])
+		{
+			continue;
+		}
+
+		const AActor* Owner = Owners[Handle].Get();
+
+		if (!Owner || Owner->IsHidden())
+		{
+			continue;
+		}
+
+		const FVector WorldLocation = Owner->GetActorLocation() + Offsets[Handle];
+
+		if (FVector::DistSquared(WorldLocation, ViewOrigin) > MaxDistanceSquared)
+		{
+			continue;
+		}
+
+		// skip bars behind the camera or off screen
+		FVector2D ScreenPosition;
+
+		if (!FSceneView::ProjectWorldToScreen(WorldLocation, ViewRect, ViewProjectionMatrix, ScreenPosition))
+		{
+			continue;
+		}
+
+		if (ScreenPosition.X < ViewRect.Min.X || ScreenPosition.Y < ViewRect.Min.Y || ScreenPosition.X > ViewRect.Max.X || ScreenPosition.Y > ViewRect.Max.Y)
+		{
+			continue;
+		}
+
+		FCombatLifeBarDrawItem& Item = DrawItems.AddDefaulted_GetRef();
+		Item.ScreenPosition = FVector2f(ScreenPosition);
+		Item.Percent = Percents[Handle];
+		Item.Color = Colors[Handle];
+	}
+}
+
+void UCombatLifeBarSubsystem::OnHUDPostRender(AHUD* HUD, UCanvas* Canvas)
+{
+	// the delegate is shared by every world, e.g. with multiple PIE instances
+	if (!Overlay.IsValid() || !HUD || HUD->GetWorld() != GetWorld() || !Canvas || !Canvas->SceneView)
+	{
+		return;
+	}
+
+	AddDrawItems(*Canvas->SceneView);
+}
+
+bool UCombatLifeBarSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCombatLifeBarSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// each local player's HUD is drawn once per frame with that player's view
+	HUDPostRenderHandle = AHUD::OnHUDPostRender.AddUObject(this, &UCombatLifeBarSubsystem::OnHUDPostRender);
+}
+
+void UCombatLifeBarSubsystem::Deinitialize()
+{
+	AHUD::OnHUDPostRender.Remove(HUDPostRenderHandle);
+
+	// remove the overlay from the viewport
+	if (Overlay.IsValid())
+	{
+		if (UGameViewportClient* ViewportClient = GetWorld()->GetGameViewport())
+		{
+			ViewportClient->RemoveViewportWidgetContent(Overlay.ToSharedRef());
+		}
+
+		Overlay.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+void UCombatLifeBarSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!Overlay.IsValid())
+	{
+		CreateOverlay();
+
+		if (!Overlay.IsValid())
+		{
+			return;
+		}
+	}
+
+	// the bars are projected again for each local player when the viewport draws
+	Overlay->GetDrawItems().Reset();
+}
+
+TStatId UCombatLifeBarSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatLifeBarSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,89 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatLifeBarSubsystem.generated.h"
+
+class SCombatLifeBarOverlay;
+class AHUD;
+class UCanvas;
+class FSceneView;
+
+/**
+ *  Keeps the life bars of every combat character in packed arrays and draws them through a single viewport overlay.
+ *  Bars are culled and projected in one loop per local player view each frame, once the cameras have updated,
+ *  so the UI cost doesn't depend on per-actor widgets and split screen views each get their own bars.
+ */
+UCLASS()
+class UCombatLifeBarSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+protected:
+
+	/** Life bar fields, indexed by handle */
+	TArray<TWeakObjectPtr<const AActor>> Owners;
+	TArray<FVector> Offsets;
+	TArray<float> Percents;
+	TArray<FLinearColor> Colors;
+	TArray<bool> Visible;
+
+	/** Free life bar handles */
+	TArray<int32> FreeHandles;
+
+	/** Overlay drawing the bars */
+	TSharedPtr<SCombatLifeBarOverlay> Overlay;
+
+	/** HUD post render delegate handle */
+	FDelegateHandle HUDPostRenderHandle;
+
+public:
+
+	/** Adds a life bar that follows an actor and returns its handle */
+	int32 RegisterLifeBar(const AActor* Owner, const FVector& Offset, const FLinearColor& Color);
+
+	/** Removes a life bar */
+	void UnregisterLifeBar(int32 Handle);
+
+	/** Sets the life bar to the provided 0-1 percentage value */
+	void SetLifePercentage(int32 Handle, float Percent);
+
+	/** Sets the life bar fill color */
+	void SetBarColor(int32 Handle, const FLinearColor& Color);
+
+	/** Shows or hides the life bar */
+	void SetLifeBarVisible(int32 Handle, bool bVisible);
+
+protected:
+
+	/** Adds the overlay to the game viewport */
+	void CreateOverlay();
+
+	/** Culls and projects the visible bars for one local player's view into the overlay's draw list */
+	void AddDrawItems(const FSceneView& View);
+
+	/** Projects the bars for each local player after its camera has updated and its view is being drawn */
+	void OnHUDPostRender(AHUD* HUD, UCanvas* Canvas);
+
+	/** Only create for game worlds */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+	/** Starts projecting the bars for each local player's view */
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/** Cleanup */
+	virtual void Deinitialize() override;
+
+public:
+
+	/** Creates the overlay and clears last frame's bars */
+	virtual void Tick(float DeltaTime) override;
+
+	/** Keep clearing the bars while paused, since the HUD still draws */
+	virtual bool IsTickableWhenPaused() const override { return true; }
+
+	/** Stat ID for the tickable */
+	virtual TStatId GetStatId() const override;
+};
@@ -0,0 +1,46 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+
+#include "SCombatLifeBarOverlay.h"
+#include "Rendering/DrawElements.h"
+#include "Styling/CoreStyle.h"
+
+void SCombatLifeBarOverlay::Construct(const FArguments& InArgs)
+{
+	BarSize = InArgs._BarSize;
+	BackgroundColor = InArgs._BackgroundColor;
+	BarBrush = FCoreStyle::Get().GetBrush("WhiteBrush");
+
+	// the overlay never takes input
+	SetVisibility(EVisibility::HitTestInvisible);
+	SetCanTick(false);
+}
+
+int32 SCombatLifeBarOverlay::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(SCombatLifeBarOverlay::OnPaint);
+
+	// positions come in viewport pixels, convert them to our local space
+	const float InverseScale = AllottedGeometry.Scale > 0.0f ? 1.0f / AllottedGeometry.Scale : 1.0f;
+	const FVector2f HalfBarSize = BarSize * 0.5f;
+
+	// draw all backgrounds on one layer and all fills on the next, so each layer batches into a single draw
+	const int32 BackgroundLayer = LayerId;
+	const int32 FillLayer = LayerId + 1;
+
+	for (const FCombatLifeBarDrawItem& Item : DrawItems)
+	{
+		const FVector2f TopLeft = Item.ScreenPosition * InverseScale - HalfBarSize;
+
+		FSlateDrawElement::MakeBox(OutDrawElements, BackgroundLayer, AllottedGeometry.ToPaintGeometry(BarSize, FSlateLayoutTransform(TopLeft)), BarBrush, ESlateDrawEffect::None, BackgroundColor);
+
+		const FVector2f FillSize(BarSize.X * FMath::Clamp(Item.Percent, 0.0f, 1.0f), BarSize.Y);
+
+		if (FillSize.X > 0.0f)
+		{
+			FSlateDrawElement::MakeBox(OutDrawElements, FillLayer, AllottedGeometry.ToPaintGeometry(FillSize, FSlateLayoutTransform(TopLeft)), BarBrush, ESlateDrawEffect::None, Item.Color);
+		}
+	}
+
+	return FillLayer;
+}
@@ -0,0 +1,69 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SLeafWidget.h"
+
+/**
+ *  A projected life bar, ready to be drawn
+ */
+struct FCombatLifeBarDrawItem
+{
+	/** Bar center in viewport pixels */
+	FVector2f ScreenPosition = FVector2f::ZeroVector;
+
+	/** Fill amount, 0-1 */
+	float Percent = 1.0f;
+
+	/** Fill color */
+	FLinearColor Color = FLinearColor::Red;
+};
+
+/**
+ *  Viewport overlay that draws every visible life bar from one packed array in a single paint pass.
+ *  All bars share the same brush and layers so Slate can batch them together.
+ */
+class SCombatLifeBarOverlay : public SLeafWidget
+{
+public:
+
+	SLATE_BEGIN_ARGS(SCombatLifeBarOverlay)
+		: _BarSize(FVector2f(80.0f, 8.0f))
+		, _BackgroundColor(FLinearColor(0.0f, 0.0f, 0.0f, 0.6f))
+		{}
+
+		/** Size of each bar, in slate units */
+		SLATE_ARGUMENT(FVector2f, BarSize)
+
+		/** Color drawn behind the fill */
+		SLATE_ARGUMENT(FLinearColor, BackgroundColor)
+
+	SLATE_END_ARGS()
+
+	/** Constructs the overlay */
+	void Construct(const FArguments& InArgs);
+
+	/** Returns the draw list so it can be refilled for this frame */
+	TArray<FCombatLifeBarDrawItem>& GetDrawItems() { return DrawItems; }
+
+	/** Draws all bars */
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements, int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+
+	/** The overlay fills whatever it's placed in */
+	virtual FVector2D ComputeDesiredSize(float LayoutScaleMultiplier) const override { return FVector2D::ZeroVector; }
+
+protected:
+
+	/** Bars to draw this frame */
+	TArray<FCombatLifeBarDrawItem> DrawItems;
+
+	/** Bar size, in slate units */
+	FVector2f BarSize;
+
+	/** Bar background color */
+	FLinearColor BackgroundColor;
+
+	/** Flat brush shared by every bar */
+	const FSlateBrush* BarBrush = nullptr;
+};
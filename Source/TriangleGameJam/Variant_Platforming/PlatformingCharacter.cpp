@@ -5,6 +5,7 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Camera/CameraComponent.h"
+#include "GhostRecorderComponent.h"
 #include "EnhancedInputSubsystems.h"
 #include "EnhancedInputComponent.h"
 #include "TimerManager.h"
@@ -12,7 +13,8 @@
 #include "DrawDebugHelpers.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Engine/EngineTypes.h"
-#include "Kismet/GameplayStatics.h"
+#include "TriangleGameJamAssetStreaming.h"
+#include "EffectDispatcherSubsystem.h"
 
 
 APlatformingCharacter::APlatformingCharacter()
@@ -77,6 +79,9 @@ APlatformingCharacter::APlatformingCharacter()
 	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
 	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
 	FollowCamera->bUsePawnControlRotation = false;
+
+	// create the ghost recorder
+	GhostRecorder = CreateDefaultSubobject<UGhostRecorderComponent>(TEXT("GhostRecorder"));
 }
 
 void APlatformingCharacter::Move(const FInputActionValue& Value)
@@ -111,7 +116,12 @@ void APlatformingCharacter::DoDash()
 	if (bHasDashed || bIsDashing || bIsMantled)
 		return;
 	
-	UGameplayStatics::PlaySound2D(this, DashSound);
+	// play the dash sound from the pooled dispatcher instead of spawning a new audio component per dash.
+	// The dash assets are normally streamed in by now, but load them if we dash before it's done
+	if (UEffectDispatcherSubsystem* EffectDispatcher = GetWorld()->GetSubsystem<UEffectDispatcherSubsystem>())
+	{
+		EffectDispatcher->PlaySound2D(DashSound.LoadSynchronous());
+	}
 
 	// raise the dash flags
 	bIsDashing = true;
@@ -128,17 +138,19 @@ void APlatformingCharacter::DoDash()
 	// play the dash montage
 	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 	{
+		UAnimMontage* DashAnimMontage = DashMontage.LoadSynchronous();
+
 		// don't restart the montage if it's already playing
-		if (AnimInstance->Montage_IsPlaying(DashMontage))
+		if (AnimInstance->Montage_IsPlaying(DashAnimMontage))
 			return;
 
 		UE_LOG(LogTemp, Display, TEXT("Dashed - Gravity disabled"));
-		const float MontageLength = AnimInstance->Montage_Play(DashMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
+		const float MontageLength = AnimInstance->Montage_Play(DashAnimMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
 
 		// has the montage played successfully?
 		if (MontageLength > 0.0f)
 		{
-			AnimInstance->Montage_SetEndDelegate(OnDashMontageEnded, DashMontage);
+			AnimInstance->Montage_SetEndDelegate(OnDashMontageEnded, DashAnimMontage);
 		}
 	}
 }
@@ -265,11 +277,14 @@ void APlatformingCharacter::StartLedgeGrab(const FVector& LedgeLocation, const F
 
 	if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 	{
-		if (AnimInstance->Montage_IsPlaying(LedgeGrabMontage))
+		// the montage started streaming when we began falling, but load it if it isn't done yet
+		UAnimMontage* GrabMontage = LedgeGrabMontage.LoadSynchronous();
+
+		if (AnimInstance->Montage_IsPlaying(GrabMontage))
 			return;
 
 		UE_LOG(LogTemp, Display, TEXT("Mantling"));
-		const float MontageLength = AnimInstance->Montage_Play(LedgeGrabMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
+		const float MontageLength = AnimInstance->Montage_Play(GrabMontage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, true);
 	}
 }
 
@@ -292,10 +307,13 @@ void APlatformingCharacter::StopLedgeGrab()
 	{
 		if (UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
 		{
-			if (AnimInstance->Montage_IsPlaying(LedgeGrabMontage))
+			// a montage that hasn't loaded can't be playing
+			UAnimMontage* GrabMontage = LedgeGrabMontage.Get();
+
+			if (GrabMontage && AnimInstance->Montage_IsPlaying(GrabMontage))
 			{
 				const float BlendOutTime = 0.15f;
-				AnimInstance->Montage_Stop(BlendOutTime, LedgeGrabMontage);
+				AnimInstance->Montage_Stop(BlendOutTime, GrabMontage);
 			}
 		}
 
@@ -569,12 +587,57 @@ bool APlatformingCharacter::HasWallJumped() const
 	return bHasWallJumped;
 }
 
+EGhostAbilityFlags APlatformingCharacter::GetGhostAbilityFlags() const
+{
+	EGhostAbilityFlags Flags = EGhostAbilityFlags::None;
+
+	if (bIsDashing)
+	{
+		Flags |= EGhostAbilityFlags::Dashing;
+	}
+
+	if (bHasDoubleJumped)
+	{
+		Flags |= EGhostAbilityFlags::DoubleJumped;
+	}
+
+	if (bHasWallJumped)
+	{
+		Flags |= EGhostAbilityFlags::WallJumped;
+	}
+
+	if (bIsMantled)
+	{
+		Flags |= EGhostAbilityFlags::Mantled;
+	}
+
+	return Flags;
+}
+
 void APlatformingCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
 	// clear the wall jump reset timer
 	GetWorld()->GetTimerManager().ClearTimer(WallJumpTimer);
+
+	// let the ability assets unload once nothing else uses them
+	TriangleGameJamAssetStreaming::ReleaseAssets(AbilityAssetsHandle);
+	TriangleGameJamAssetStreaming::ReleaseAssets(LedgeGrabAssetsHandle);
+}
+
+void APlatformingCharacter::PreloadAbilityAssets()
+{
+	AbilityAssetsHandle = TriangleGameJamAssetStreaming::RequestAssets({ DashMontage.ToSoftObjectPath(), DashSound.ToSoftObjectPath() });
+}
+
+void APlatformingCharacter::PreloadLedgeGrabAssets()
+{
+	// only request once
+	if (!LedgeGrabAssetsHandle.IsValid())
+	{
+		LedgeGrabAssetsHandle = TriangleGameJamAssetStreaming::RequestAssets({ LedgeGrabMontage.ToSoftObjectPath() });
+	}
 }
 
 void APlatformingCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -624,6 +687,9 @@ void APlatformingCharacter::OnMovementModeChanged(EMovementMode PrevMovementMode
 	{
 		// save the game time when we started falling, so we can check it later for coyote time jumps
 		LastFallTime = GetWorld()->GetTimeSeconds();
+
+		// ledges can only be grabbed while airborne, so start streaming the grab montage now
+		PreloadLedgeGrabAssets();
 	}
 }
 
@@ -640,6 +706,9 @@ void APlatformingCharacter::BeginPlay()
 
 	// Store the default speed
 	DefaultMaxWalkSpeed = GetCharacterMovement()->MaxWalkSpeed;
+
+	// stream in the dash assets ahead of their first use. The rest stream in once they can first be used
+	PreloadAbilityAssets();
 }
 
 void APlatformingCharacter::UpdateCheckpoint(FVector NewLocation)
@@ -5,14 +5,18 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Animation/AnimInstance.h"
+#include "GhostRecordable.h"
 #include "PlatformingCharacter.generated.h"
 
 
 class USpringArmComponent;
 class UCameraComponent;
+class UGhostRecorderComponent;
 class UInputAction;
 struct FInputActionValue;
 class UAnimMontage;
+class USoundBase;
+struct FStreamableHandle;
 
 /**
  * An enhanced Third Person Character with the following functionality:
@@ -32,7 +36,7 @@ enum class EPlatformingMovementState : uint8
 };
 
 UCLASS(abstract)
-class APlatformingCharacter : public ACharacter
+class APlatformingCharacter : public ACharacter, public IGhostRecordable
 {
 	GENERATED_BODY()
 
@@ -44,6 +48,10 @@ class APlatformingCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components", meta = (AllowPrivateAccess = "true"))
 	UCameraComponent* FollowCamera;
 
+	/** Records time trial ghosts */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Components", meta = (AllowPrivateAccess = "true"))
+	UGhostRecorderComponent* GhostRecorder;
+
 protected:
 
 	/** Jump Input Action */
@@ -152,6 +160,12 @@ protected:
 	/** Called from a delegate when the dash montage ends */
 	void DashMontageEnded(UAnimMontage* Montage, bool bInterrupted);
 
+	/** Starts streaming in the dash montage and sound, which can be used from the first frame */
+	void PreloadAbilityAssets();
+
+	/** Starts streaming in the ledge grab montage the first time we're airborne, since we can't grab a ledge before that */
+	void PreloadLedgeGrabAssets();
+
 
 public:
 
@@ -171,6 +185,9 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Platforming")
 	bool HasWallJumped() const;
 
+	/** Returns the ability state to record into time trial ghosts */
+	virtual EGhostAbilityFlags GetGhostAbilityFlags() const override;
+
 public:
 
 	/** EndPlay cleanup */
@@ -226,17 +243,23 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "Wall Jump", meta = (ClampMin = 0, ClampMax = 5, Units = "s"))
 	float DelayBetweenWallJumps = 0.1f;
 
-	/** AnimMontage to use for the Dash action */
+	/** AnimMontage to use for the Dash action. Streamed in on BeginPlay */
 	UPROPERTY(EditAnywhere, Category = "Dash")
-	UAnimMontage* DashMontage;
+	TSoftObjectPtr<UAnimMontage> DashMontage;
 
-	/** AnimMontage to use for the Ledge Grab action */
+	/** AnimMontage to use for the Ledge Grab action. Streamed in the first time we fall */
 	UPROPERTY(EditAnywhere, Category = "Mantle")
-	UAnimMontage* LedgeGrabMontage;
+	TSoftObjectPtr<UAnimMontage> LedgeGrabMontage;
 
-	/** AnimMontage to use for the Ledge Grab action */
+	/** AnimMontage to use for the Climb Ledge action. Not played by the character, so it's only loaded by whatever plays it */
 	UPROPERTY(EditAnywhere, Category = "Mantle")
-	UAnimMontage* ClimbLedgeMontage;
+	TSoftObjectPtr<UAnimMontage> ClimbLedgeMontage;
+
+	/** Keeps the dash montage and sound resident while we're in play */
+	TSharedPtr<FStreamableHandle> AbilityAssetsHandle;
+
+	/** Keeps the ledge grab montage resident once we've been airborne */
+	TSharedPtr<FStreamableHandle> LedgeGrabAssetsHandle;
 
 	/** Last recorded time when this character started falling */
 	float LastFallTime = 0.0f;
@@ -277,6 +300,9 @@ public:
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 
+	/** Returns GhostRecorder subobject **/
+	FORCEINLINE UGhostRecorderComponent* GetGhostRecorder() const { return GhostRecorder; }
+
 	// =====================================================================
 	// [Game Jam Additions] - 2D/3D Mode Switching
 	// =====================================================================
@@ -333,9 +359,9 @@ private:
 		// Record the respawn rotation
 		FRotator RespawnRotation;
 	
-		//Sound File
+		//Sound File. Streamed in on BeginPlay
 		UPROPERTY(EditAnywhere, Category = "Audio")
-		class USoundBase* DashSound;
+		TSoftObjectPtr<USoundBase> DashSound;
 
 public:
 	// === For outside ===
@@ -5,20 +5,66 @@
 #include "StateTreeExecutionContext.h"
 #include "StateTreeExecutionTypes.h"
 #include "AIController.h"
-#include "Kismet/GameplayStatics.h"
+#include "CombatTargetCache.h"
+#include "Engine/World.h"
+
+EStateTreeRunStatus FStateTreeGetPlayerTask::EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// get the instance data
+	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+	// register with the target cache so the query is batched with all other agents
+	if (InstanceData.TargetCacheHandle == INDEX_NONE && IsValid(InstanceData.NPC))
+	{
+		if (UCombatTargetCache* TargetCache = InstanceData.NPC->GetWorld()->GetSubsystem<UCombatTargetCache>())
+		{
+			InstanceData.TargetCacheHandle = TargetCache->RegisterAgent(InstanceData.NPC);
+		}
+	}
+
+	return EStateTreeRunStatus::Running;
+}
+
+void FStateTreeGetPlayerTask::ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const
+{
+	// have we transitioned to another state?
+	if (Transition.ChangeType == EStateTreeStateChangeType::Changed)
+	{
+		// get the instance data
+		FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
+
+		// release the target cache handle
+		if (UCombatTargetCache* TargetCache = IsValid(InstanceData.NPC) ? InstanceData.NPC->GetWorld()->GetSubsystem<UCombatTargetCache>() : nullptr)
+		{
+			TargetCache->UnregisterAgent(InstanceData.TargetCacheHandle);
+		}
+
+		InstanceData.TargetCacheHandle = INDEX_NONE;
+	}
+}
 
 EStateTreeRunStatus FStateTreeGetPlayerTask::Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const
 {
 	// get the instance data
 	FInstanceDataType& InstanceData = Context.GetInstanceData(*this);
 
-	// set the player pawn as the target
-	InstanceData.TargetPlayer = UGameplayStatics::GetPlayerPawn(InstanceData.Controller.Get(), 0);
+	InstanceData.TargetPlayer = nullptr;
+	InstanceData.bValidTarget = false;
+
+	if (!IsValid(InstanceData.NPC))
+	{
+		return EStateTreeRunStatus::Running;
+	}
+
+	// get the nearest player from this frame's batch
+	UCombatTargetCache* TargetCache = InstanceData.NPC->GetWorld()->GetSubsystem<UCombatTargetCache>();
+	FCombatTargetInfo Target;
 
-	// are the NPC and target valid?
-	if (IsValid(InstanceData.TargetPlayer) && IsValid(InstanceData.NPC))
+	if (TargetCache && TargetCache->GetNearestTarget(InstanceData.TargetCacheHandle, Target))
 	{
-		InstanceData.bValidTarget = FVector::Distance(InstanceData.NPC->GetActorLocation(), InstanceData.TargetPlayer->GetActorLocation()) < InstanceData.RangeMax;
+		// set the player pawn as the target, if it's close enough
+		InstanceData.TargetPlayer = Target.Pawn;
+		InstanceData.bValidTarget = Target.Distance < InstanceData.RangeMax;
 	}
 
 	return EStateTreeRunStatus::Running;
@@ -36,10 +36,13 @@ struct FStateTreeGetPlayerInstanceData
 	/** Max distance to be considered a valid target */
 	UPROPERTY(EditAnywhere, Category="Parameter", meta = (ClampMin = 0, ClampMax = 10000, Units = "cm"))
 	float RangeMax = 1000.0f;
+
+	/** Handle for batched queries on the target cache */
+	int32 TargetCacheHandle = INDEX_NONE;
 };
 
 /**
- *  StateTree task to get the player-controlled character
+ *  StateTree task to get the player-controlled character closest to the NPC
  */
 USTRUCT(meta=(DisplayName="Get Player", Category="Side Scrolling"))
 struct FStateTreeGetPlayerTask : public FStateTreeTaskCommonBase
@@ -50,6 +53,12 @@ struct FStateTreeGetPlayerTask : public FStateTreeTaskCommonBase
 	using FInstanceDataType = FStateTreeGetPlayerInstanceData;
 	virtual const UStruct* GetInstanceDataType() const override { return FInstanceDataType::StaticStruct(); }
 
+	/** Runs when the owning state is entered */
+	virtual EStateTreeRunStatus EnterState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
+	/** Runs when the owning state is ended */
+	virtual void ExitState(FStateTreeExecutionContext& Context, const FStateTreeTransitionResult& Transition) const override;
+
 	/** Runs while the owning state is active */
 	virtual EStateTreeRunStatus Tick(FStateTreeExecutionContext& Context, const float DeltaTime) const override;
 
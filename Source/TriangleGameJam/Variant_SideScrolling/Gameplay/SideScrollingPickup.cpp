@@ -12,6 +12,10 @@ ASideScrollingPickup::ASideScrollingPickup()
 {
 	PrimaryActorTick.bCanEverTick = false;
 
+	// replicate so clients see the pickup go away, but stay dormant until then
+	bReplicates = true;
+	NetDormancy = DORM_Initial;
+
 	// create the root comp
 	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
 
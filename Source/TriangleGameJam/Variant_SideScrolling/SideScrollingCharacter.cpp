@@ -5,6 +5,7 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Camera/CameraComponent.h"
+#include "GhostRecorderComponent.h"
 #include "Components/InputComponent.h"
 #include "InputActionValue.h"
 #include "EnhancedInputComponent.h"
@@ -24,6 +25,9 @@ ASideScrollingCharacter::ASideScrollingCharacter()
 
 	Camera->SetRelativeLocationAndRotation(FVector(0.0f, 300.0f, 0.0f), FRotator(0.0f, -90.0f, 0.0f));
 
+	// create the ghost recorder
+	GhostRecorder = CreateDefaultSubobject<UGhostRecorderComponent>(TEXT("GhostRecorder"));
+
 	// configure the collision capsule
 	GetCapsuleComponent()->SetCapsuleSize(35.0f, 90.0f);
 
@@ -348,3 +352,20 @@ bool ASideScrollingCharacter::HasWallJumped() const
 {
 	return bHasWallJumped;
 }
+
+EGhostAbilityFlags ASideScrollingCharacter::GetGhostAbilityFlags() const
+{
+	EGhostAbilityFlags Flags = EGhostAbilityFlags::None;
+
+	if (bHasDoubleJumped)
+	{
+		Flags |= EGhostAbilityFlags::DoubleJumped;
+	}
+
+	if (bHasWallJumped)
+	{
+		Flags |= EGhostAbilityFlags::WallJumped;
+	}
+
+	return Flags;
+}
@@ -4,9 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "GhostRecordable.h"
 #include "SideScrollingCharacter.generated.h"
 
 class UCameraComponent;
+class UGhostRecorderComponent;
 class UInputAction;
 struct FInputActionValue;
 
@@ -14,7 +16,7 @@ struct FInputActionValue;
  *  A player-controllable character side scrolling game
  */
 UCLASS(abstract)
-class ASideScrollingCharacter : public ACharacter
+class ASideScrollingCharacter : public ACharacter, public IGhostRecordable
 {
 	GENERATED_BODY()
 
@@ -22,6 +24,10 @@ class ASideScrollingCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category ="Camera", meta = (AllowPrivateAccess = "true"))
 	UCameraComponent* Camera;
 
+	/** Records time trial ghosts */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category ="Components", meta = (AllowPrivateAccess = "true"))
+	UGhostRecorderComponent* GhostRecorder;
+
 protected:
 
 	/** Move Input Action */
@@ -177,4 +183,7 @@ public:
 	/** Returns true if the character has just wall jumped */
 	UFUNCTION(BlueprintPure, Category="Side Scrolling")
 	bool HasWallJumped() const;
+
+	/** Returns the ability state to record into time trial ghosts */
+	virtual EGhostAbilityFlags GetGhostAbilityFlags() const override;
 };